@@ -0,0 +1,49 @@
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<uint64_t> allocations{0};
+
+auto Allocate(std::size_t size, std::align_val_t alignment = std::align_val_t{alignof(std::max_align_t)}) -> void * {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  const auto align = static_cast<std::size_t>(alignment);
+  if (align <= alignof(std::max_align_t)) return std::malloc(size != 0 ? size : 1);
+  // aligned_alloc wants a size that is a multiple of the alignment
+  return std::aligned_alloc(align, (size + align - 1) / align * align);
+}
+}  // namespace
+
+namespace alloc_counter {
+auto count() -> uint64_t { return allocations.load(std::memory_order_relaxed); }
+}  // namespace alloc_counter
+
+auto operator new(std::size_t size) -> void * {
+  if (void *ptr = Allocate(size)) return ptr;
+  throw std::bad_alloc{};
+}
+
+auto operator new[](std::size_t size) -> void * { return operator new(size); }
+
+auto operator new(std::size_t size, std::align_val_t alignment) -> void * {
+  if (void *ptr = Allocate(size, alignment)) return ptr;
+  throw std::bad_alloc{};
+}
+
+auto operator new[](std::size_t size, std::align_val_t alignment) -> void * { return operator new(size, alignment); }
+
+auto operator new(std::size_t size, const std::nothrow_t & /*unused*/) noexcept -> void * { return Allocate(size); }
+
+auto operator new[](std::size_t size, const std::nothrow_t & /*unused*/) noexcept -> void * { return Allocate(size); }
+
+auto operator delete(void *ptr) noexcept -> void { std::free(ptr); }
+auto operator delete[](void *ptr) noexcept -> void { std::free(ptr); }
+auto operator delete(void *ptr, std::size_t /*size*/) noexcept -> void { std::free(ptr); }
+auto operator delete[](void *ptr, std::size_t /*size*/) noexcept -> void { std::free(ptr); }
+auto operator delete(void *ptr, std::align_val_t /*alignment*/) noexcept -> void { std::free(ptr); }
+auto operator delete[](void *ptr, std::align_val_t /*alignment*/) noexcept -> void { std::free(ptr); }
+auto operator delete(void *ptr, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept -> void { std::free(ptr); }
+auto operator delete[](void *ptr, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept -> void { std::free(ptr); }
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+// counts every global operator new of the process
+// only linked into alloc_tests, replacing operator new everywhere else would tax the tools
+namespace alloc_counter {
+auto count() -> uint64_t;
+}
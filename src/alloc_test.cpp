@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "matcher.h"
+#include "objmatch.h"
+#include "synth.h"
+
+namespace {
+auto Planted() -> synth_case const & {
+  static const auto work = synth::planted_case(synth_options{.objects = 16, .functions_per_object = 4}, 0x40000);
+  return work;
+}
+
+// runs fn twice, the first run may grow the scratch buffers that later runs reuse
+template <typename F>
+auto SteadyAllocations(F &&fn) -> uint64_t {
+  fn();
+  const auto before = alloc_counter::count();
+  fn();
+  return alloc_counter::count() - before;
+}
+}  // namespace
+
+TEST_CASE("masked compares of every candidate do not allocate", "[alloc]") {
+  const auto &work = Planted();
+  const auto &b_info = work.b_info;
+
+  uint64_t matches = 0;
+  auto scan = [&work, &b_info, &matches] {
+    for (auto rom_offset : work.offsets) {
+      const std::span<const uint8_t> rom_span(&b_info.m_Binary[rom_offset], b_info.m_Binary.size() - rom_offset);
+      for (const auto &object : work.sigs) {
+        for (const auto &section : object.sections) {
+          matches += TestSection(section, rom_span) ? 1 : 0;
+          for (const auto &symbol : section.symbols) matches += TestSymbol(symbol, rom_span) ? 1 : 0;
+        }
+      }
+    }
+  };
+
+  REQUIRE(SteadyAllocations(scan) == 0);
+  REQUIRE(matches > 0);
+}
+
+TEST_CASE("section_compare does not allocate", "[alloc]") {
+  const auto &work = Planted();
+  auto archive = work.archive;
+  const auto patterns = archive_to_section_patterns(std::span{archive});
+  const std::span<const uint8_t> rom{work.rom.bytes};
+
+  uint64_t matches = 0;
+  auto scan = [&work, &patterns, rom, &matches] {
+    for (const auto &placement : work.rom.placements) {
+      for (const auto &pattern : patterns) matches += section_compare(pattern, rom.subspan(placement.text_start, pattern.size)) ? 1 : 0;
+    }
+  };
+
+  REQUIRE(SteadyAllocations(scan) == 0);
+  REQUIRE(matches >= work.rom.placements.size());
+}
+
+TEST_CASE("TestSignatureSymbol only allocates from its arena", "[alloc]") {
+  const auto &work = Planted();
+  const auto index = BuildSignatureIndex(work.sigs, work.strings);
+
+  alignas(std::max_align_t) static std::array<std::byte, 1 << 20> buffer;
+  uint64_t guesses = 0;
+  auto follow = [&work, &index, &guesses] {
+    // null upstream, running out of buffer throws instead of quietly using the heap
+    std::pmr::monotonic_buffer_resource arena{buffer.data(), buffer.size(), std::pmr::null_memory_resource()};
+    for (size_t object = 0; object < work.sigs.size(); object++) {
+      const auto &sig_obj = work.sigs[object];
+      const auto &text = *std::ranges::find(sig_obj.sections, ".text", &sig_section::name);
+      const auto text_start = static_cast<uint32_t>(work.rom.placements[object].text_start);
+      for (const auto &symbol : text.symbols) {
+        guesses += TestSignatureSymbol(symbol, text_start + symbol.offset, text, sig_obj, index.sym_map, work.b_info, &arena).size();
+      }
+    }
+  };
+
+  REQUIRE(SteadyAllocations(follow) == 0);
+  REQUIRE(guesses > 0);
+}
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "kernels.h"
+#include "matcher.h"
+#include "objmatch.h"
+#include "objsig.h"
+#include "section_pattern.h"
+#include "signature.h"
+#include "synth.h"
+
+// run with ./bench, or ./bench "[small]" for a quick pass
+// catch2 prints mean and deviation, --benchmark-samples and --reporter xml make runs comparable
+
+namespace {
+using workload = struct workload : synth_case {
+  std::vector<char> sig_yaml;
+};
+
+auto MakeWorkload(synth_options const &options, uint64_t rom_size) -> workload {
+  workload work{synth::planted_case(options, rom_size)};
+  work.sig_yaml = sig_yaml::serialize(work.sigs);
+
+  return work;
+}
+
+// 64 objects in 8MiB and 1024 objects in 32MiB, roughly a small game and a large one
+auto Small() -> workload const & {
+  static const auto work = MakeWorkload(synth_options{.objects = 64}, 0x800000);
+  return work;
+}
+
+auto Large() -> workload const & {
+  static const auto work = MakeWorkload(synth_options{.objects = 1024}, 0x2000000);
+  return work;
+}
+
+auto TextSection(sig_object const &object) -> sig_section const & {
+  return *std::ranges::find(object.sections, ".text", &sig_section::name);
+}
+
+auto Kernels(workload const &work) -> void {
+  const auto &text = TextSection(work.sigs[0]);
+  const auto &symbol = text.symbols[0];
+  const std::span<const uint8_t> rom{work.rom.bytes};
+  const auto at = work.rom.placements[0].text_start;
+
+  BENCHMARK("TestSymbol") { return TestSymbol(symbol, rom.subspan(at + symbol.offset)); };
+  BENCHMARK("TestSection") { return TestSection(text, rom.subspan(at)); };
+
+  const auto patterns = [&work] {
+    auto archive = work.archive;
+    return archive_to_section_patterns(std::span{archive});
+  }();
+  const auto &pattern = *std::ranges::find(patterns, ".text", &section_pattern::section);
+  BENCHMARK("section_compare") { return section_compare(pattern, rom.subspan(at)); };
+}
+
+// every instruction set the cpu has, objmatch -k picks one of them for a whole run
+auto RomKernels(workload const &work) -> void {
+  for (size_t isa = 0; isa < static_cast<size_t>(kernel_isa::count); isa++) {
+    const auto &set = kernels::get(static_cast<kernel_isa>(isa));
+    if (!kernels::supported(set.isa)) continue;
+
+    const auto name = std::string{kernels::name(set.isa)};
+    std::vector<uint64_t> jr_ra;
+    std::vector<uint64_t> addiu_sp;
+    BENCHMARK("scan_words " + name) {
+      jr_ra.clear();
+      addiu_sp.clear();
+      set.scan_words(target_arch::mips_be, work.rom.bytes, 0, jr_ra, addiu_sp);
+      return jr_ra.size() + addiu_sp.size();
+    };
+
+    auto bytes = work.rom.bytes;
+    BENCHMARK("swap32 " + name) { set.swap32(bytes); };
+  }
+}
+
+auto Pipeline(workload const &work) -> void {
+  BENCHMARK("LikelyFunctionOffsets") { return LikelyFunctionOffsets(work.b_info, {}); };
+
+  BENCHMARK_ADVANCED("sig_yaml::deserialize")(Catch::Benchmark::Chronometer meter) {
+    // deserialize parses in place, each run gets a fresh copy
+    std::vector<std::vector<char>> copies(meter.runs(), work.sig_yaml);
+    meter.measure([&copies](int run) { return sig_yaml::deserialize(copies[run]); });
+  };
+
+  BENCHMARK_ADVANCED("ProcessLibrary")(Catch::Benchmark::Chronometer meter) {
+    std::vector<std::vector<char>> copies(meter.runs(), work.archive);
+    meter.measure([&copies](int run) { return ProcessLibrary(std::span{copies[run]}); });
+  };
+
+  BENCHMARK("BuildSignatureIndex") { return BuildSignatureIndex(work.sigs, work.strings); };
+  BENCHMARK("ProcessSignatureFile") { return ProcessSignatureFile(work.sigs, work.strings, work.b_info, work.offsets); };
+
+  const auto splat = synth::bin_splat(work.rom);
+  const auto paths = synth::file_paths(work.library);
+  auto archive = work.archive;
+  const auto patterns = unique_section_patterns(archive_to_section_patterns(std::span{archive}));
+  const std::span<const char> rom{reinterpret_cast<const char *>(work.rom.bytes.data()), work.rom.bytes.size()};
+  BENCHMARK("matcher") { return matcher(splat, rom, patterns, paths, "synth"); };
+}
+}  // namespace
+
+TEST_CASE("kernels", "[small]") { Kernels(Small()); }
+
+TEST_CASE("rom kernels", "[small]") { RomKernels(Small()); }
+
+TEST_CASE("pipeline, 64 objects", "[small]") { Pipeline(Small()); }
+
+TEST_CASE("pipeline, 1024 objects", "[large]") { Pipeline(Large()); }
@@ -0,0 +1,283 @@
+#include "flirt.h"
+
+#include <algorithm>
+#include <map>
+#include <string_view>
+
+#include "objmatch.h"
+#include "run_stats.h"
+
+namespace {
+constexpr std::string_view hex_digits{"0123456789ABCDEF"};
+constexpr std::string_view wildcard_byte{".."};
+
+// trie format, little endian
+constexpr std::string_view trie_magic{"OMFT"};
+constexpr uint32_t trie_version = 1;
+
+using trie_writer = struct trie_writer {
+  std::vector<uint8_t> bytes;
+
+  auto put(uint64_t value, size_t size) -> void {
+    for (size_t byte = 0; byte < size; byte++) bytes.push_back(static_cast<uint8_t>(value >> (byte * 8)));
+  }
+};
+
+using trie_reader = struct trie_reader {
+  std::span<const uint8_t> bytes;
+  size_t pos{};
+  bool failed{};
+
+  auto get(size_t size) -> uint32_t {
+    if (pos + size > bytes.size()) {
+      failed = true;
+      return 0;
+    }
+    uint32_t value = 0;
+    for (size_t byte = 0; byte < size; byte++) value |= static_cast<uint32_t>(bytes[pos + byte]) << (byte * 8);
+    pos += size;
+    return value;
+  }
+};
+}  // namespace
+
+namespace flirt {
+auto pattern_byte(std::string_view pattern, size_t byte) -> std::optional<uint8_t> {
+  const auto text = pattern.substr(byte * 2, 2);
+  if (text == wildcard_byte) return std::nullopt;
+  return static_cast<uint8_t>(hex_digits.find(text[0]) << 4 | hex_digits.find(text[1]));
+}
+
+auto crc16(std::span<const uint8_t> bytes) -> uint16_t {
+  uint16_t crc = 0xFFFF;
+  for (auto byte : bytes) {
+    crc ^= byte;
+    for (int bit = 0; bit < 8; bit++) crc = (crc & 1) != 0 ? (crc >> 1) ^ 0x8408 : crc >> 1;
+  }
+  return static_cast<uint16_t>(~crc);
+}
+
+auto make_pattern(std::span<const uint8_t> masked, std::span<const scan_mask> masks) -> flirt_pattern {
+  std::vector<bool> variant(masked.size());
+  for (const auto &mask : masks) {
+    for (size_t byte = 0; byte < mask.keep.size() && mask.offset + byte < masked.size(); byte++) {
+      if (mask.keep[byte] != 0xFF) variant[mask.offset + byte] = true;
+    }
+  }
+
+  flirt_pattern result;
+  const auto prefix = std::min<size_t>(masked.size(), flirt_prefix);
+  for (size_t byte = 0; byte < prefix; byte++) {
+    if (variant[byte]) {
+      result.pattern += wildcard_byte;
+    } else {
+      result.pattern += hex_digits[masked[byte] >> 4];
+      result.pattern += hex_digits[masked[byte] & 0xF];
+    }
+  }
+
+  auto tail_end = prefix;
+  while (tail_end < masked.size() && !variant[tail_end] && tail_end - prefix < flirt_max_tail) tail_end++;
+  result.tail_size = static_cast<uint16_t>(tail_end - prefix);
+  result.crc16 = crc16(masked.subspan(prefix, result.tail_size));
+
+  return result;
+}
+
+auto has_patterns(std::vector<sig_object> const &sigFile) -> bool {
+  bool all = true;
+  for_each_signature(
+      sigFile, [&all](sig_section const &section, signature_hit) { all = all && (section.size == 0 || !section.pattern.empty()); },
+      [&all](sig_symbol const &symbol, signature_hit) { all = all && (symbol.size == 0 || !symbol.pattern.empty()); });
+  return all;
+}
+
+auto build(std::vector<sig_object> const &sigFile) -> flirt_trie {
+  const phase_timer timer{stat_phase::index_build};
+
+  // children keyed by byte, 0x100 for the wildcard so it sorts last
+  using build_node = struct build_node {
+    std::map<uint16_t, uint32_t> children;
+    std::vector<flirt_leaf> leaves;
+  };
+  std::vector<build_node> build_nodes(1);
+  auto insert = [&build_nodes](std::pmr::string const &pattern, flirt_leaf leaf) {
+    uint32_t node = 0;
+    for (size_t byte = 0; byte < pattern.size() / 2; byte++) {
+      const auto value = pattern_byte(pattern, byte);
+      const uint16_t key = value ? *value : 0x100;
+      const auto found = build_nodes[node].children.find(key);
+      if (found != build_nodes[node].children.end()) {
+        node = found->second;
+        continue;
+      }
+      const auto child = static_cast<uint32_t>(build_nodes.size());
+      build_nodes[node].children.emplace(key, child);
+      build_nodes.emplace_back();
+      node = child;
+    }
+    build_nodes[node].leaves.push_back(leaf);
+  };
+
+  for_each_signature(
+      sigFile,
+      [&insert](sig_section const &section, signature_hit hit) {
+        insert(section.pattern, flirt_leaf{.hit = hit, .section = true, .tail_size = section.tail_size, .crc16 = section.crc16});
+      },
+      [&insert](sig_symbol const &symbol, signature_hit hit) {
+        insert(symbol.pattern, flirt_leaf{.hit = hit, .tail_size = symbol.tail_size, .crc16 = symbol.crc16});
+      });
+
+  // breadth first, so the children of a node are next to each other
+  flirt_trie trie;
+  trie.nodes.reserve(build_nodes.size());
+  trie.nodes.emplace_back();
+  std::vector<uint32_t> order{0};
+  for (size_t node = 0; node < order.size(); node++) {
+    const auto &source = build_nodes[order[node]];
+    trie.nodes[node].leaf_begin = static_cast<uint32_t>(trie.leaves.size());
+    trie.leaves.insert(trie.leaves.end(), source.leaves.begin(), source.leaves.end());
+    trie.nodes[node].leaf_end = static_cast<uint32_t>(trie.leaves.size());
+
+    trie.nodes[node].child_begin = static_cast<uint32_t>(trie.nodes.size());
+    for (const auto &[key, child] : source.children) {
+      trie.nodes.push_back(flirt_node{.byte = static_cast<uint8_t>(key & 0xFF), .wildcard = key == 0x100});
+      order.push_back(child);
+    }
+    trie.nodes[node].child_end = static_cast<uint32_t>(trie.nodes.size());
+  }
+
+  return trie;
+}
+
+auto serialize(flirt_trie const &trie) -> std::vector<uint8_t> {
+  trie_writer writer;
+  writer.bytes.assign(trie_magic.begin(), trie_magic.end());
+  writer.put(trie_version, 4);
+  writer.put(trie.nodes.size(), 4);
+  writer.put(trie.leaves.size(), 4);
+  for (const auto &node : trie.nodes) {
+    writer.put(node.byte, 1);
+    writer.put(node.wildcard ? 1 : 0, 1);
+    writer.put(node.child_begin, 4);
+    writer.put(node.child_end, 4);
+    writer.put(node.leaf_begin, 4);
+    writer.put(node.leaf_end, 4);
+  }
+  for (const auto &leaf : trie.leaves) {
+    writer.put(leaf.hit.object, 4);
+    writer.put(leaf.hit.section, 4);
+    writer.put(leaf.hit.symbol, 4);
+    writer.put(leaf.section ? 1 : 0, 1);
+    writer.put(leaf.tail_size, 2);
+    writer.put(leaf.crc16, 2);
+  }
+
+  return std::move(writer.bytes);
+}
+
+auto deserialize(std::span<const uint8_t> bytes, std::vector<sig_object> const &sigFile) -> std::optional<flirt_trie> {
+  if (bytes.size() < trie_magic.size() || !std::ranges::equal(bytes.first(trie_magic.size()), trie_magic)) return std::nullopt;
+
+  trie_reader reader{.bytes = bytes, .pos = trie_magic.size()};
+  if (reader.get(4) != trie_version) return std::nullopt;
+  const auto node_count = reader.get(4);
+  const auto leaf_count = reader.get(4);
+  // 18 and 15 bytes a record, a count the rest can't hold is corrupt
+  if (reader.failed || node_count == 0 || bytes.size() - reader.pos != uint64_t{node_count} * 18 + uint64_t{leaf_count} * 15) return std::nullopt;
+
+  flirt_trie trie;
+  trie.nodes.resize(node_count);
+  uint64_t children = 0;
+  for (uint32_t index = 0; index < node_count; index++) {
+    auto &node = trie.nodes[index];
+    node.byte = static_cast<uint8_t>(reader.get(1));
+    node.wildcard = reader.get(1) != 0;
+    node.child_begin = reader.get(4);
+    node.child_end = reader.get(4);
+    node.leaf_begin = reader.get(4);
+    node.leaf_end = reader.get(4);
+    // written breadth first, children come after their parent so a walk can't loop
+    if (node.child_begin <= index || node.child_begin > node.child_end || node.child_end > node_count || node.leaf_begin > node.leaf_end ||
+        node.leaf_end > leaf_count) {
+      return std::nullopt;
+    }
+    children += node.child_end - node.child_begin;
+  }
+  // every node but the root is the child of one other
+  if (children + 1 != node_count) return std::nullopt;
+
+  trie.leaves.resize(leaf_count);
+  for (auto &leaf : trie.leaves) {
+    leaf.hit.object = reader.get(4);
+    leaf.hit.section = reader.get(4);
+    leaf.hit.symbol = reader.get(4);
+    leaf.section = reader.get(1) != 0;
+    leaf.tail_size = static_cast<uint16_t>(reader.get(2));
+    leaf.crc16 = static_cast<uint16_t>(reader.get(2));
+
+    // a trie compiled for other signatures
+    if (leaf.hit.object >= sigFile.size() || leaf.hit.section >= sigFile[leaf.hit.object].sections.size()) return std::nullopt;
+    if (!leaf.section && leaf.hit.symbol >= sigFile[leaf.hit.object].sections[leaf.hit.section].symbols.size()) return std::nullopt;
+  }
+
+  return trie;
+}
+
+auto find_hits(flirt_trie const &trie, std::vector<sig_object> const &sigFile, std::span<const uint8_t> rom, std::set<uint32_t> const &offsets)
+    -> std::pair<std::vector<signature_hit>, std::vector<signature_hit>> {
+  const phase_timer timer{stat_phase::section_match};
+  uint64_t leaves_reached = 0;
+  uint64_t crc16_hits = 0;
+  std::vector<signature_hit> section_hits;
+  std::vector<signature_hit> symbol_hits;
+
+  // (node, depth), depth is also the number of rom bytes the path matched
+  std::vector<std::pair<uint32_t, uint32_t>> stack;
+  for (auto rom_offset : offsets) {
+    if (rom_offset >= rom.size()) continue;
+    const auto rom_span = rom.subspan(rom_offset);
+
+    stack.clear();
+    stack.emplace_back(0, 0);
+    while (!stack.empty()) {
+      const auto [node_index, depth] = stack.back();
+      stack.pop_back();
+      const auto &node = trie.nodes[node_index];
+
+      for (auto leaf_index = node.leaf_begin; leaf_index < node.leaf_end; leaf_index++) {
+        const auto &leaf = trie.leaves[leaf_index];
+        leaves_reached++;
+        if (depth + leaf.tail_size > rom_span.size() || crc16(rom_span.subspan(depth, leaf.tail_size)) != leaf.crc16) continue;
+        crc16_hits++;
+
+        const auto &sig_obj = sigFile[leaf.hit.object];
+        const auto &sig_section = sig_obj.sections[leaf.hit.section];
+        auto hit = leaf.hit;
+        hit.rom_offset = rom_offset;
+        if (leaf.section) {
+          if (TestSection(sig_section, rom_span, sig_obj.arch)) section_hits.push_back(hit);
+        } else if (TestSymbol(sig_section.symbols[leaf.hit.symbol], rom_span, sig_obj.arch)) {
+          symbol_hits.push_back(hit);
+        }
+      }
+
+      if (depth >= rom_span.size() || node.child_begin == node.child_end) continue;
+
+      auto exact_end = node.child_end;
+      if (trie.nodes[exact_end - 1].wildcard) stack.emplace_back(--exact_end, depth + 1);
+
+      const auto first = trie.nodes.begin() + node.child_begin;
+      const auto last = trie.nodes.begin() + exact_end;
+      const auto child = std::ranges::lower_bound(first, last, rom_span[depth], {}, &flirt_node::byte);
+      if (child != last && child->byte == rom_span[depth]) stack.emplace_back(static_cast<uint32_t>(child - trie.nodes.begin()), depth + 1);
+    }
+  }
+
+  run_stats::add(stat_counter::trie_leaves, leaves_reached);
+  run_stats::add(stat_counter::crc16_hits, crc16_hits);
+  run_stats::add(stat_counter::section_hits, section_hits.size());
+  run_stats::add(stat_counter::symbol_hits, symbol_hits.size());
+  return {std::move(section_hits), std::move(symbol_hits)};
+}
+}  // namespace flirt
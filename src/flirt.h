@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "scan_table.h"
+#include "signature.h"
+#include "signature_hit.h"
+
+// flirt style matching, every unique .text section and symbol in one prefix trie
+// a candidate offset walks the trie once instead of looking up each signature group
+//
+// objsig records a pattern per signature, like the lines of a flirt .pat file:
+// the first flirt_prefix masked bytes as hex with .. where a relocation sits,
+// then a crc16 of the tail_size bytes after them, up to the next relocation
+// trie edges are the pattern bytes, a leaf checks the crc16 and then the full masked compare
+constexpr uint32_t flirt_prefix = 32;
+// flirt limits the crc16 to what fits in a byte
+constexpr uint32_t flirt_max_tail = 0xFF;
+
+using flirt_pattern = struct flirt_pattern {
+  std::string pattern;
+  uint16_t tail_size{};
+  uint16_t crc16{};
+};
+
+using flirt_node = struct flirt_node {
+  // edge from the parent, a wildcard edge matches any byte
+  uint8_t byte{};
+  bool wildcard{};
+  // children are nodes[child_begin, child_end), exact bytes in order then at most one wildcard
+  uint32_t child_begin{};
+  uint32_t child_end{};
+  // signatures whose pattern ends here
+  uint32_t leaf_begin{};
+  uint32_t leaf_end{};
+
+  auto operator==(const flirt_node &x) const -> bool = default;
+};
+
+using flirt_leaf = struct flirt_leaf {
+  // rom_offset unset, symbol unused for sections
+  signature_hit hit;
+  bool section{};
+  uint16_t tail_size{};
+  uint16_t crc16{};
+
+  auto operator==(const flirt_leaf &x) const -> bool = default;
+};
+
+// nodes[0] is the root
+using flirt_trie = struct flirt_trie {
+  std::vector<flirt_node> nodes;
+  std::vector<flirt_leaf> leaves;
+
+  auto operator==(const flirt_trie &x) const -> bool = default;
+};
+
+namespace flirt {
+// the signatures the index scans, unique .text sections and symbols
+template <typename Section, typename Symbol>
+auto for_each_signature(std::vector<sig_object> const &sigFile, Section &&on_section, Symbol &&on_symbol) -> void {
+  for (uint32_t object = 0; object < sigFile.size(); object++) {
+    const auto &sig_obj = sigFile[object];
+    for (uint32_t section = 0; section < sig_obj.sections.size(); section++) {
+      const auto &sig_section = sig_obj.sections[section];
+      if (sig_section.name != ".text") continue;
+
+      if (sig_section.crc_all != 0 && !sig_section.duplicate_crc) on_section(sig_section, signature_hit{.object = object, .section = section});
+      for (uint32_t symbol = 0; symbol < sig_section.symbols.size(); symbol++) {
+        const auto &sig_sym = sig_section.symbols[symbol];
+        if (!sig_sym.duplicate_crc) on_symbol(sig_sym, signature_hit{.object = object, .section = section, .symbol = symbol});
+      }
+    }
+  }
+}
+
+// byte of a pattern, nullopt for a wildcard
+auto pattern_byte(std::string_view pattern, size_t byte) -> std::optional<uint8_t>;
+
+// crc-16/x-25, the crc16 flirt uses
+auto crc16(std::span<const uint8_t> bytes) -> uint16_t;
+
+// masked are the signature's bytes with relocations zeroed, masks says which bytes those are
+auto make_pattern(std::span<const uint8_t> masked, std::span<const scan_mask> masks) -> flirt_pattern;
+
+// false for signatures written before objsig recorded patterns
+auto has_patterns(std::vector<sig_object> const &sigFile) -> bool;
+
+// same sections and symbols the signature index holds
+auto build(std::vector<sig_object> const &sigFile) -> flirt_trie;
+
+// the form objsig -F embeds in a .sig
+auto serialize(flirt_trie const &trie) -> std::vector<uint8_t>;
+// nullopt if bytes are not a trie, or it points at signatures sigFile does not have
+auto deserialize(std::span<const uint8_t> bytes, std::vector<sig_object> const &sigFile) -> std::optional<flirt_trie>;
+
+// section and symbol hits at every offset, what FindSectionHits and FindSymbolHits find without skipping
+auto find_hits(flirt_trie const &trie, std::vector<sig_object> const &sigFile, std::span<const uint8_t> rom, std::set<uint32_t> const &offsets)
+    -> std::pair<std::vector<signature_hit>, std::vector<signature_hit>>;
+}  // namespace flirt
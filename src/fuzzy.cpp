@@ -0,0 +1,147 @@
+#include "fuzzy.h"
+
+#include <crc32c/crc32c.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <span>
+#include <tuple>
+
+#include "kernels.h"
+#include "run_stats.h"
+#include "scan_table.h"
+
+namespace {
+// [start, end) rom regions already taken, merged so they never overlap
+using region_set = std::map<uint64_t, uint64_t>;
+
+auto Take(region_set &taken, uint64_t start, uint64_t end) -> void {
+  auto next = taken.upper_bound(start);
+  if (next != taken.begin() && std::prev(next)->second >= start) {
+    next = std::prev(next);
+    start = next->first;
+  }
+  while (next != taken.end() && next->first <= end) {
+    end = std::max(end, next->second);
+    next = taken.erase(next);
+  }
+  taken[start] = end;
+}
+
+auto Overlaps(region_set const &taken, uint64_t start, uint64_t end) -> bool {
+  auto next = taken.upper_bound(start);
+  if (next != taken.end() && next->first < end) return true;
+  return next != taken.begin() && std::prev(next)->second > start;
+}
+
+auto SymbolOf(std::vector<sig_object> const &sigFile, signature_hit const &hit) -> sig_symbol const & {
+  return sigFile[hit.object].sections[hit.section].symbols[hit.symbol];
+}
+}  // namespace
+
+namespace fuzzy {
+auto has_words(std::vector<sig_object> const &sigFile) -> bool {
+  for (const auto &sig_obj : sigFile) {
+    for (const auto &sig_section : sig_obj.sections) {
+      if (std::ranges::any_of(sig_section.symbols, [](const sig_symbol &symbol) { return !symbol.words.empty(); })) return true;
+    }
+  }
+  return false;
+}
+
+auto keep_masks(sig_symbol const &symbol, target_arch arch) -> std::vector<uint32_t> {
+  std::vector<uint32_t> keep(symbol.size / sizeof(uint32_t), 0xFFFFFFFF);
+  for (const auto &mask : scan_tables::symbol_masks(symbol, arch)) {
+    for (uint32_t byte = 0; byte < mask.keep.size(); byte++) {
+      const auto at = mask.offset + byte;
+      if (at / sizeof(uint32_t) >= keep.size()) continue;
+      const auto shift = (3 - at % sizeof(uint32_t)) * 8;
+      keep[at / sizeof(uint32_t)] &= ~(uint32_t{0xFF} << shift) | static_cast<uint32_t>(mask.keep[byte]) << shift;
+    }
+  }
+
+  return keep;
+}
+
+auto find_hits(signature_index const &index, std::vector<sig_object> const &sigFile, binary_info const &b_info,
+               const std::set<uint32_t> &m_LikelyFunctionOffsets, std::set<std::pair<uint32_t, uint32_t>> const &skip_sections,
+               std::vector<signature_hit> const &exact_hits, uint32_t max_percent) -> std::vector<fuzzy_hit> {
+  const phase_timer timer{stat_phase::symbol_match};
+  const auto &active = kernels::active();
+  uint64_t checks = 0;
+
+  std::set<std::tuple<uint32_t, uint32_t, uint32_t>> exact;
+  for (const auto &hit : exact_hits) exact.insert({hit.object, hit.section, hit.symbol});
+  // keep masks are only built for symbols that get scored
+  std::map<sig_symbol const *, std::vector<uint32_t>> keeps;
+
+  std::vector<fuzzy_hit> hits;
+  for (auto rom_offset : m_LikelyFunctionOffsets) {
+    const std::span<const uint8_t> rom_span(&b_info.m_Binary[rom_offset], b_info.m_Binary.size() - rom_offset);
+
+    for (const auto &[placement, table] : index.anchors) {
+      const auto &[anchor_offset, anchor_size] = placement;
+      if (anchor_offset + anchor_size > rom_span.size()) continue;
+
+      const auto key = crc32c::Crc32c(&rom_span[anchor_offset], anchor_size);
+      if (!table.filter.may_contain(key)) continue;
+
+      const auto [first, last] = table.equal_range(key);
+      for (auto row = first; row < last; row++) {
+        auto hit = table.hits[row];
+        if (skip_sections.contains({hit.object, hit.section}) || exact.contains({hit.object, hit.section, hit.symbol})) continue;
+
+        const auto &symbol = SymbolOf(sigFile, hit);
+        const auto words = static_cast<uint32_t>(symbol.words.size());
+        if (words == 0 || words != symbol.size / sizeof(uint32_t) || rom_span.size() < symbol.size) continue;
+        if (table.test(row, rom_span)) continue;
+
+        auto keep = keeps.find(&symbol);
+        if (keep == keeps.end()) keep = keeps.emplace(&symbol, keep_masks(symbol, sigFile[hit.object].arch)).first;
+
+        checks++;
+        const auto mismatches = static_cast<uint32_t>(active.mismatched_words(rom_span, symbol.words, keep->second));
+        if (uint64_t{mismatches} * 100 > uint64_t{max_percent} * words) continue;
+
+        hit.rom_offset = rom_offset;
+        hits.push_back(fuzzy_hit{.hit = hit, .mismatches = mismatches, .words = words});
+      }
+    }
+  }
+
+  run_stats::add(stat_counter::fuzzy_checks, checks);
+  run_stats::add(stat_counter::fuzzy_hits, hits.size());
+  return hits;
+}
+
+auto best(std::vector<fuzzy_hit> hits, std::vector<sig_object> const &sigFile, std::vector<signature_hit> const &section_hits,
+          std::vector<signature_hit> const &symbol_hits) -> std::vector<fuzzy_hit> {
+  // exact matches keep their regions
+  region_set taken;
+  for (const auto &hit : section_hits) Take(taken, hit.rom_offset, hit.rom_offset + sigFile[hit.object].sections[hit.section].size);
+  for (const auto &hit : symbol_hits) Take(taken, hit.rom_offset, hit.rom_offset + SymbolOf(sigFile, hit).size);
+
+  // lowest share of differing words first, then rom order so ties are stable
+  std::ranges::sort(hits, [](fuzzy_hit const &a, fuzzy_hit const &b) {
+    const auto a_share = uint64_t{a.mismatches} * b.words;
+    const auto b_share = uint64_t{b.mismatches} * a.words;
+    return std::tie(a_share, a.hit.rom_offset) < std::tie(b_share, b.hit.rom_offset);
+  });
+
+  std::set<std::tuple<uint32_t, uint32_t, uint32_t>> placed;
+  std::vector<fuzzy_hit> result;
+  for (const auto &hit : hits) {
+    const auto start = uint64_t{hit.hit.rom_offset};
+    const auto end = start + SymbolOf(sigFile, hit.hit).size;
+    if (placed.contains({hit.hit.object, hit.hit.section, hit.hit.symbol}) || Overlaps(taken, start, end)) continue;
+
+    placed.insert({hit.hit.object, hit.hit.section, hit.hit.symbol});
+    Take(taken, start, end);
+    result.push_back(hit);
+  }
+
+  std::ranges::sort(result, {}, [](fuzzy_hit const &hit) { return hit.hit.rom_offset; });
+  return result;
+}
+}  // namespace fuzzy
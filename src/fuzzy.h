@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "objmatch.h"
+#include "signature.h"
+#include "signature_hit.h"
+
+// approximate symbol matching, for library revisions that change a few instructions of a function
+// candidates still come from the exact anchor index, a symbol whose anchor window matched but whose
+// full compare failed is scored by how many of its masked words differ from the rom
+using fuzzy_hit = struct fuzzy_hit {
+  signature_hit hit;
+  uint32_t mismatches{};
+  uint32_t words{};
+
+  auto operator==(const fuzzy_hit &x) const -> bool = default;
+};
+
+namespace fuzzy {
+// false for signatures written without objsig -W
+auto has_words(std::vector<sig_object> const &sigFile) -> bool;
+
+// per word keep masks of a symbol, all ones except the relocated bits
+auto keep_masks(sig_symbol const &symbol, target_arch arch = target_arch::mips_be) -> std::vector<uint32_t>;
+
+// hits with at most max_percent of their words differing
+// symbols without recorded words, of skip_sections, or found exactly in exact_hits are not scored
+auto find_hits(signature_index const &index, std::vector<sig_object> const &sigFile, binary_info const &b_info,
+               const std::set<uint32_t> &m_LikelyFunctionOffsets, std::set<std::pair<uint32_t, uint32_t>> const &skip_sections,
+               std::vector<signature_hit> const &exact_hits, uint32_t max_percent) -> std::vector<fuzzy_hit>;
+
+// the best scoring hit of every rom region, one per symbol, none overlapping the exact section and symbol hits
+auto best(std::vector<fuzzy_hit> hits, std::vector<sig_object> const &sigFile, std::vector<signature_hit> const &section_hits,
+          std::vector<signature_hit> const &symbol_hits) -> std::vector<fuzzy_hit>;
+}  // namespace fuzzy
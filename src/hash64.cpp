@@ -0,0 +1,64 @@
+#include "hash64.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace {
+// crc-64/xz, reflected ecma-182
+constexpr uint64_t crc64_poly = 0xC96C5795D7870F42ULL;
+
+// slicing by 8, table[k][b] is the crc of byte b followed by k zero bytes
+constexpr auto crc64_tables = [] {
+  std::array<std::array<uint64_t, 256>, 8> tables{};
+  for (uint64_t byte = 0; byte < 256; byte++) {
+    uint64_t crc = byte;
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ ((crc & 1) != 0 ? crc64_poly : 0);
+    tables[0][byte] = crc;
+  }
+  for (size_t k = 1; k < tables.size(); k++) {
+    for (size_t byte = 0; byte < 256; byte++) tables[k][byte] = (tables[k - 1][byte] >> 8) ^ tables[0][tables[k - 1][byte] & 0xFF];
+  }
+  return tables;
+}();
+
+auto Crc64Extend(uint64_t crc, const uint8_t *data, size_t size) -> uint64_t {
+  const auto &t = crc64_tables;
+  crc = ~crc;
+  // a loaded word has the stream's first byte lowest only on little endian hosts, the others go bytewise
+  if constexpr (std::endian::native == std::endian::little) {
+    for (; size >= 8; data += 8, size -= 8) {
+      uint64_t word{};
+      std::memcpy(&word, data, sizeof(word));
+      crc ^= word;
+      crc = t[7][crc & 0xFF] ^ t[6][(crc >> 8) & 0xFF] ^ t[5][(crc >> 16) & 0xFF] ^ t[4][(crc >> 24) & 0xFF] ^
+            t[3][(crc >> 32) & 0xFF] ^ t[2][(crc >> 40) & 0xFF] ^ t[1][(crc >> 48) & 0xFF] ^ t[0][crc >> 56];
+    }
+  }
+  for (; size > 0; data++, size--) crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+
+  return ~crc;
+}
+
+constexpr std::array<std::string_view, static_cast<size_t>(sig_hash::count)> names{"none", "crc64"};
+}  // namespace
+
+namespace hash64 {
+auto extend(sig_hash kind, uint64_t state, const uint8_t *data, size_t size) -> uint64_t {
+  switch (kind) {
+    case sig_hash::crc64: return Crc64Extend(state, data, size);
+    case sig_hash::none:
+    case sig_hash::count: return 0;
+  }
+  return 0;
+}
+
+auto name(sig_hash kind) -> std::string_view { return names.at(static_cast<size_t>(kind)); }
+
+auto parse(std::string_view name) -> std::optional<sig_hash> {
+  const auto found = std::ranges::find(names, name);
+  if (found == names.end()) return std::nullopt;
+  return static_cast<sig_hash>(found - names.begin());
+}
+}  // namespace hash64
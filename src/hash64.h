@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// 64 bit hashes recorded next to crc_all, over the same masked bytes
+// crc_all stays the fast check, the 64 bit hash is only computed once it matched
+// so two symbols that merely share a crc32c are neither duplicates nor each other's match
+enum class sig_hash : uint8_t { none, crc64, count };
+
+namespace hash64 {
+// continues state over size more bytes, like crc32c::Extend, so masked bytes can be hashed piecewise
+// a hash starts from 0, none always returns 0
+auto extend(sig_hash kind, uint64_t state, const uint8_t *data, size_t size) -> uint64_t;
+
+auto name(sig_hash kind) -> std::string_view;
+auto parse(std::string_view name) -> std::optional<sig_hash>;
+}  // namespace hash64
@@ -0,0 +1,192 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstring>
+
+namespace {
+// the bodies are written once and inlined into a copy per target, the compiler vectorizes each copy
+// for its instruction set, anything they call out of line (vector growth) stays baseline
+#define KERNEL_INLINE [[gnu::always_inline]] inline
+
+KERNEL_INLINE auto Swap16(std::span<uint8_t> bytes) -> void {
+  for (size_t i = 0; i + sizeof(uint16_t) <= bytes.size(); i += sizeof(uint16_t)) {
+    uint16_t half{};
+    std::memcpy(&half, &bytes[i], sizeof(half));
+    half = std::byteswap(half);
+    std::memcpy(&bytes[i], &half, sizeof(half));
+  }
+}
+
+KERNEL_INLINE auto Swap32(std::span<uint8_t> bytes) -> void {
+  for (size_t i = 0; i + sizeof(uint32_t) <= bytes.size(); i += sizeof(uint32_t)) {
+    uint32_t word{};
+    std::memcpy(&word, &bytes[i], sizeof(word));
+    word = std::byteswap(word);
+    std::memcpy(&bytes[i], &word, sizeof(word));
+  }
+}
+
+// 64 words are compared branch free into bit masks, hits are rare so only the masks are walked
+// targets with halfword instructions get a second pair of masks for the upper halves
+template <typename Target>
+KERNEL_INLINE auto ScanWords(std::span<const uint8_t> bytes, uint64_t base, std::vector<uint64_t> &returns, std::vector<uint64_t> &frame_setups)
+    -> void {
+  constexpr size_t block = 64;
+  const size_t words = bytes.size() / sizeof(uint32_t);
+  auto append = [base](std::vector<uint64_t> &offsets, uint64_t mask, size_t first, uint64_t half) {
+    for (; mask != 0; mask &= mask - 1) offsets.push_back(base + (first + std::countr_zero(mask)) * sizeof(uint32_t) + half);
+  };
+  for (size_t first = 0; first < words; first += block) {
+    const size_t count = std::min(block, words - first);
+    uint64_t return_mask = 0;
+    uint64_t frame_setup_mask = 0;
+    uint64_t upper_return_mask = 0;
+    uint64_t upper_frame_setup_mask = 0;
+    for (size_t w = 0; w < count; w++) {
+      const auto word = Target::load(&bytes[(first + w) * sizeof(uint32_t)]);
+      const auto found_returns = Target::returns(word);
+      const auto found_frame_setups = Target::frame_setups(word);
+      return_mask |= static_cast<uint64_t>(found_returns & 1) << w;
+      frame_setup_mask |= static_cast<uint64_t>(found_frame_setups & 1) << w;
+      if constexpr (Target::halfwords) {
+        upper_return_mask |= static_cast<uint64_t>(found_returns >> 1 & 1) << w;
+        upper_frame_setup_mask |= static_cast<uint64_t>(found_frame_setups >> 1 & 1) << w;
+      }
+    }
+
+    append(returns, return_mask, first, 0);
+    append(frame_setups, frame_setup_mask, first, 0);
+    if constexpr (Target::halfwords) {
+      append(returns, upper_return_mask, first, 2);
+      append(frame_setups, upper_frame_setup_mask, first, 2);
+    }
+  }
+}
+
+// a lambda would not inherit the target attribute, so the switch is written out and inlined into every set
+KERNEL_INLINE auto ScanWordsOf(target_arch arch, std::span<const uint8_t> bytes, uint64_t base, std::vector<uint64_t> &returns,
+                               std::vector<uint64_t> &frame_setups) -> void {
+  switch (arch) {
+    case target_arch::mips_le: ScanWords<mips_le_target>(bytes, base, returns, frame_setups); return;
+    case target_arch::arm: ScanWords<arm_target>(bytes, base, returns, frame_setups); return;
+    case target_arch::mips_be:
+    case target_arch::count: break;
+  }
+  ScanWords<mips_be_target>(bytes, base, returns, frame_setups);
+}
+
+// differing words set bits of a 64 word mask, a popcount per block instead of a branch per word
+KERNEL_INLINE auto MismatchedWords(std::span<const uint8_t> bytes, std::span<const uint32_t> words, std::span<const uint32_t> keep) -> uint64_t {
+  constexpr size_t block = 64;
+  uint64_t mismatches = 0;
+  for (size_t first = 0; first < words.size(); first += block) {
+    const size_t count = std::min(block, words.size() - first);
+    uint64_t differ_mask = 0;
+    for (size_t w = 0; w < count; w++) {
+      uint32_t word{};
+      std::memcpy(&word, &bytes[(first + w) * sizeof(uint32_t)], sizeof(word));
+      word = std::byteswap(word);
+      differ_mask |= static_cast<uint64_t>(((word ^ words[first + w]) & keep[first + w]) != 0) << w;
+    }
+    mismatches += std::popcount(differ_mask);
+  }
+  return mismatches;
+}
+
+#define KERNEL_SET(suffix, features)                                                                              \
+  [[gnu::target(features)]] auto Swap16_##suffix(std::span<uint8_t> bytes) -> void { Swap16(bytes); }             \
+  [[gnu::target(features)]] auto Swap32_##suffix(std::span<uint8_t> bytes) -> void { Swap32(bytes); }             \
+  [[gnu::target(features)]] auto ScanWords_##suffix(target_arch arch, std::span<const uint8_t> bytes, uint64_t base, \
+                                                    std::vector<uint64_t> &returns,                                  \
+                                                    std::vector<uint64_t> &frame_setups) -> void {                   \
+    ScanWordsOf(arch, bytes, base, returns, frame_setups);                                                            \
+  }                                                                                                                   \
+  [[gnu::target(features)]] auto MismatchedWords_##suffix(std::span<const uint8_t> bytes,                         \
+                                                          std::span<const uint32_t> words,                        \
+                                                          std::span<const uint32_t> keep) -> uint64_t {           \
+    return MismatchedWords(bytes, words, keep);                                                                   \
+  }
+
+auto Swap16_baseline(std::span<uint8_t> bytes) -> void { Swap16(bytes); }
+auto Swap32_baseline(std::span<uint8_t> bytes) -> void { Swap32(bytes); }
+auto ScanWords_baseline(target_arch arch, std::span<const uint8_t> bytes, uint64_t base, std::vector<uint64_t> &returns,
+                        std::vector<uint64_t> &frame_setups) -> void {
+  ScanWordsOf(arch, bytes, base, returns, frame_setups);
+}
+auto MismatchedWords_baseline(std::span<const uint8_t> bytes, std::span<const uint32_t> words, std::span<const uint32_t> keep) -> uint64_t {
+  return MismatchedWords(bytes, words, keep);
+}
+
+#if defined(__x86_64__)
+KERNEL_SET(sse42, "sse4.2,popcnt")
+KERNEL_SET(avx2, "avx2,bmi,bmi2,popcnt")
+KERNEL_SET(avx512, "avx512f,avx512bw,avx512vl,avx2,bmi,bmi2,popcnt")
+#define KERNEL_SET_ENTRY(isa, suffix) kernel_set{kernel_isa::isa, Swap16_##suffix, Swap32_##suffix, ScanWords_##suffix, MismatchedWords_##suffix}
+#else
+// other hosts only get the portable build
+#define KERNEL_SET_ENTRY(isa, suffix) kernel_set{kernel_isa::isa, Swap16_baseline, Swap32_baseline, ScanWords_baseline, MismatchedWords_baseline}
+#endif
+
+const std::array<kernel_set, static_cast<size_t>(kernel_isa::count)> sets{
+    kernel_set{kernel_isa::baseline, Swap16_baseline, Swap32_baseline, ScanWords_baseline, MismatchedWords_baseline},
+    KERNEL_SET_ENTRY(sse42, sse42),
+    KERNEL_SET_ENTRY(avx2, avx2),
+    KERNEL_SET_ENTRY(avx512, avx512),
+};
+
+constexpr std::array<std::string_view, static_cast<size_t>(kernel_isa::count)> names{"baseline", "sse4.2", "avx2", "avx512"};
+
+auto Widest() -> kernel_isa {
+  for (auto isa : {kernel_isa::avx512, kernel_isa::avx2, kernel_isa::sse42}) {
+    if (kernels::supported(isa)) return isa;
+  }
+  return kernel_isa::baseline;
+}
+
+// set once at startup or by -k, read by every scan
+auto Selected() -> std::atomic<kernel_set const *> & {
+  static std::atomic<kernel_set const *> selected{&kernels::get(Widest())};
+  return selected;
+}
+}  // namespace
+
+namespace kernels {
+auto active() -> kernel_set const & { return *Selected().load(std::memory_order_relaxed); }
+
+auto get(kernel_isa isa) -> kernel_set const & { return sets.at(static_cast<size_t>(isa)); }
+
+auto supported(kernel_isa isa) -> bool {
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  switch (isa) {
+    case kernel_isa::baseline: return true;
+    case kernel_isa::sse42: return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+    case kernel_isa::avx2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2");
+    case kernel_isa::avx512:
+      return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl") &&
+             __builtin_cpu_supports("bmi2");
+    case kernel_isa::count: return false;
+  }
+  return false;
+#else
+  return isa == kernel_isa::baseline;
+#endif
+}
+
+auto select(kernel_isa isa) -> bool {
+  if (!supported(isa)) return false;
+  Selected().store(&get(isa), std::memory_order_relaxed);
+  return true;
+}
+
+auto name(kernel_isa isa) -> std::string_view { return names.at(static_cast<size_t>(isa)); }
+
+auto parse(std::string_view name) -> std::optional<kernel_isa> {
+  const auto found = std::ranges::find(names, name);
+  if (found == names.end()) return std::nullopt;
+  return static_cast<kernel_isa>(found - names.begin());
+}
+}  // namespace kernels
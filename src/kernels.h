@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "target.h"
+
+// the loops over whole roms, built once per instruction set and picked at startup
+// so one portable binary runs the widest version the cpu has
+// crc32c is not here, the crc32c library already checks for sse4.2 and arm crc at runtime
+enum class kernel_isa : uint8_t { baseline, sse42, avx2, avx512, count };
+
+using kernel_set = struct kernel_set {
+  kernel_isa isa;
+  // swaps every 16 or 32 bit word in place, a trailing partial word is left alone
+  void (*swap16)(std::span<uint8_t> bytes);
+  void (*swap32)(std::span<uint8_t> bytes);
+  // appends base + offset of every return (jr ra, bx lr) and frame setup (addiu sp, sp, -n, push {.., lr}) of arch, bytes is word aligned
+  // thumb instructions are also found in the upper half of a word, those offsets follow the others of their block
+  // each arch has its own copy of the loop, arch only picks which one runs
+  void (*scan_words)(target_arch arch, std::span<const uint8_t> bytes, uint64_t base, std::vector<uint64_t> &returns,
+                     std::vector<uint64_t> &frame_setups);
+  // number of big endian words of bytes that differ from words in a bit keep selects, bytes holds at least words.size() words
+  uint64_t (*mismatched_words)(std::span<const uint8_t> bytes, std::span<const uint32_t> words, std::span<const uint32_t> keep);
+};
+
+namespace kernels {
+// the selected set, the widest supported one unless select was called
+auto active() -> kernel_set const &;
+auto get(kernel_isa isa) -> kernel_set const &;
+auto supported(kernel_isa isa) -> bool;
+// false, and nothing changes, if the cpu does not support isa
+auto select(kernel_isa isa) -> bool;
+
+auto name(kernel_isa isa) -> std::string_view;
+auto parse(std::string_view name) -> std::optional<kernel_isa>;
+}  // namespace kernels
@@ -0,0 +1,192 @@
+#include "keyword_scan.h"
+
+#include <algorithm>
+#include <map>
+
+#include "flirt.h"
+#include "objmatch.h"
+#include "run_stats.h"
+
+namespace {
+auto ReadWord(std::span<const uint8_t> rom, uint64_t pos) -> uint32_t {
+  return static_cast<uint32_t>(rom[pos]) << 24 | static_cast<uint32_t>(rom[pos + 1]) << 16 | static_cast<uint32_t>(rom[pos + 2]) << 8 |
+         static_cast<uint32_t>(rom[pos + 3]);
+}
+
+// goto, following fail links until a state has an edge for word
+auto Step(keyword_automaton const &automaton, uint32_t state, uint32_t word) -> uint32_t {
+  while (true) {
+    if (state == 0 && !automaton.first_words.may_contain(word)) return 0;
+
+    const auto &current = automaton.states[state];
+    const auto first = automaton.edges.begin() + current.edge_begin;
+    const auto last = automaton.edges.begin() + current.edge_end;
+    const auto edge = std::ranges::lower_bound(first, last, word, {}, &keyword_edge::word);
+    if (edge != last && edge->word == word) return edge->next;
+    if (state == 0) return 0;
+    state = current.fail;
+  }
+}
+
+auto Confirm(keyword_output const &output, std::vector<sig_object> const &sigFile, std::span<const uint8_t> rom, uint64_t rom_offset,
+             std::vector<signature_hit> &section_hits, std::vector<signature_hit> &symbol_hits) -> void {
+  const auto &sig_obj = sigFile[output.hit.object];
+  const auto &sig_section = sig_obj.sections[output.hit.section];
+  auto hit = output.hit;
+  hit.rom_offset = static_cast<uint32_t>(rom_offset);
+  if (output.section) {
+    if (TestSection(sig_section, rom.subspan(rom_offset), sig_obj.arch)) section_hits.push_back(hit);
+  } else if (TestSymbol(sig_section.symbols[output.hit.symbol], rom.subspan(rom_offset), sig_obj.arch)) {
+    symbol_hits.push_back(hit);
+  }
+}
+}  // namespace
+
+namespace keyword_scan {
+auto keyword(std::string_view pattern) -> std::optional<keyword_run> {
+  std::optional<keyword_run> best;
+  keyword_run current;
+  const auto words = static_cast<uint32_t>(pattern.size() / 8);
+  for (uint32_t word = 0; word < words; word++) {
+    const bool plain = std::ranges::none_of(pattern.substr(word * 8, 8), [](char digit) { return digit == '.'; });
+    if (!plain) {
+      current = keyword_run{.first_word = word + 1};
+      continue;
+    }
+    current.words++;
+    if (current.words >= keyword_min_words && (!best || current.words > best->words)) best = current;
+    if (current.words == keyword_max_words) break;
+  }
+
+  return best;
+}
+
+auto build(std::vector<sig_object> const &sigFile) -> keyword_automaton {
+  const phase_timer timer{stat_phase::index_build};
+
+  using build_state = struct build_state {
+    std::map<uint32_t, uint32_t> children;
+    std::vector<keyword_output> outputs;
+    uint32_t fail{};
+  };
+  std::vector<build_state> build_states(1);
+  std::vector<uint32_t> first_words;
+  keyword_automaton automaton;
+
+  auto insert = [&build_states, &first_words, &automaton](std::pmr::string const &pattern, keyword_output output) {
+    const auto run = keyword(pattern);
+    if (!run) {
+      automaton.unanchored.push_back(output);
+      return;
+    }
+
+    uint32_t state = 0;
+    for (auto word = run->first_word; word < run->first_word + run->words; word++) {
+      uint32_t value = 0;
+      for (size_t byte = 0; byte < 4; byte++) value = value << 8 | *flirt::pattern_byte(pattern, word * 4 + byte);
+      if (word == run->first_word) first_words.push_back(value);
+
+      const auto found = build_states[state].children.find(value);
+      if (found != build_states[state].children.end()) {
+        state = found->second;
+        continue;
+      }
+      const auto child = static_cast<uint32_t>(build_states.size());
+      build_states[state].children.emplace(value, child);
+      build_states.emplace_back();
+      state = child;
+    }
+    output.end_offset = (run->first_word + run->words) * 4;
+    build_states[state].outputs.push_back(output);
+  };
+
+  flirt::for_each_signature(
+      sigFile, [&insert](sig_section const &section, signature_hit hit) { insert(section.pattern, keyword_output{.hit = hit, .section = true}); },
+      [&insert](sig_symbol const &symbol, signature_hit hit) { insert(symbol.pattern, keyword_output{.hit = hit}); });
+
+  // breadth first, a fail link points at a shallower state whose outputs are already complete
+  std::vector<uint32_t> order{0};
+  for (size_t index = 0; index < order.size(); index++) {
+    const auto state = order[index];
+    for (const auto &[word, child] : build_states[state].children) {
+      order.push_back(child);
+      if (state == 0) continue;
+
+      auto fail = build_states[state].fail;
+      while (true) {
+        const auto found = build_states[fail].children.find(word);
+        if (found != build_states[fail].children.end()) {
+          build_states[child].fail = found->second;
+          break;
+        }
+        if (fail == 0) break;
+        fail = build_states[fail].fail;
+      }
+    }
+    if (state != 0) {
+      const auto &inherited = build_states[build_states[state].fail].outputs;
+      build_states[state].outputs.insert(build_states[state].outputs.end(), inherited.begin(), inherited.end());
+    }
+  }
+
+  automaton.states.reserve(build_states.size());
+  for (const auto &source : build_states) {
+    keyword_state state{.fail = source.fail};
+    state.edge_begin = static_cast<uint32_t>(automaton.edges.size());
+    for (const auto &[word, child] : source.children) automaton.edges.push_back(keyword_edge{.word = word, .next = child});
+    state.edge_end = static_cast<uint32_t>(automaton.edges.size());
+    state.output_begin = static_cast<uint32_t>(automaton.outputs.size());
+    automaton.outputs.insert(automaton.outputs.end(), source.outputs.begin(), source.outputs.end());
+    state.output_end = static_cast<uint32_t>(automaton.outputs.size());
+    automaton.states.push_back(state);
+  }
+
+  automaton.first_words = prefilter{first_words.size()};
+  for (auto word : first_words) automaton.first_words.insert(word);
+
+  return automaton;
+}
+
+auto find_hits(keyword_automaton const &automaton, std::vector<sig_object> const &sigFile, std::span<const uint8_t> rom,
+               std::vector<rom_range> const &ranges, std::set<uint32_t> const &offsets) -> std::pair<std::vector<signature_hit>, std::vector<signature_hit>> {
+  const phase_timer timer{stat_phase::section_match};
+  uint64_t candidates = 0;
+  std::vector<signature_hit> section_hits;
+  std::vector<signature_hit> symbol_hits;
+
+  const auto scan_ranges = ranges.empty() ? std::vector<rom_range>{rom_range{.start = 0, .end = rom.size()}} : ranges;
+  // thumb functions start on halfwords, so their keywords sit between the rom's words
+  const bool halfwords = std::ranges::any_of(sigFile, [](const sig_object &sig_obj) { return targets::halfwords(sig_obj.arch); });
+  for (const auto &range : scan_ranges) {
+    // a signature starting in the range can have its keyword just past the end
+    const auto scan_end = std::min<uint64_t>(rom.size(), range.end + flirt_prefix);
+    for (uint64_t phase = 0; phase < (halfwords ? 4 : 2); phase += 2) {
+      uint32_t state = 0;
+      for (auto pos = ((range.start + 3) & ~uint64_t{3}) + phase; pos + 4 <= scan_end; pos += 4) {
+        state = Step(automaton, state, ReadWord(rom, pos));
+
+        const auto &current = automaton.states[state];
+        for (auto output = current.output_begin; output < current.output_end; output++) {
+          const auto &found = automaton.outputs[output];
+          if (pos + 4 < found.end_offset) continue;
+          const auto start = pos + 4 - found.end_offset;
+          if (start < range.start || start >= range.end) continue;
+
+          candidates++;
+          Confirm(found, sigFile, rom, start, section_hits, symbol_hits);
+        }
+      }
+    }
+  }
+
+  for (auto rom_offset : offsets) {
+    if (rom_offset >= rom.size()) continue;
+    for (const auto &output : automaton.unanchored) Confirm(output, sigFile, rom, rom_offset, section_hits, symbol_hits);
+  }
+
+  run_stats::add(stat_counter::keyword_candidates, candidates);
+  run_stats::add(stat_counter::section_hits, section_hits.size());
+  run_stats::add(stat_counter::symbol_hits, symbol_hits.size());
+  return {std::move(section_hits), std::move(symbol_hits)};
+}
+}  // namespace keyword_scan
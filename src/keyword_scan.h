@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "prefilter.h"
+#include "rom_range.h"
+#include "signature.h"
+#include "signature_hit.h"
+
+// exhaustive candidate stage, no jr ra or addiu sp heuristics
+// every signature contributes one keyword, the longest relocation free word run in its flirt pattern,
+// and an aho-corasick automaton over rom words finds all keywords in one pass over every aligned word
+// a keyword match implies where the signature starts, which is confirmed with the full masked compare
+constexpr uint32_t keyword_min_words = 2;
+// longer keywords only add states, two words already rarely match outside their function
+constexpr uint32_t keyword_max_words = 4;
+
+// words of the signature's pattern a keyword covers
+using keyword_run = struct keyword_run {
+  uint32_t first_word{};
+  uint32_t words{};
+
+  auto operator==(const keyword_run &x) const -> bool = default;
+};
+
+using keyword_output = struct keyword_output {
+  // rom_offset unset, symbol unused for sections
+  signature_hit hit;
+  bool section{};
+  // bytes from the signature start to the end of its keyword
+  uint32_t end_offset{};
+};
+
+using keyword_edge = struct keyword_edge {
+  uint32_t word{};
+  uint32_t next{};
+};
+
+using keyword_state = struct keyword_state {
+  // goto edges are edges[edge_begin, edge_end), sorted by word
+  uint32_t edge_begin{};
+  uint32_t edge_end{};
+  // longest proper suffix of this state that is also a state
+  uint32_t fail{};
+  // keywords ending here, those of the fail chain included
+  uint32_t output_begin{};
+  uint32_t output_end{};
+};
+
+// states[0] is the root
+using keyword_automaton = struct keyword_automaton {
+  std::vector<keyword_state> states;
+  std::vector<keyword_edge> edges;
+  std::vector<keyword_output> outputs;
+  // first word of every keyword, most rom words leave the root without a lookup
+  prefilter first_words;
+  // signatures without a keyword_min_words run, only tried at the heuristic offsets
+  std::vector<keyword_output> unanchored;
+};
+
+namespace keyword_scan {
+// longest word aligned run of pattern without a wildcard, earliest on ties, capped at keyword_max_words
+auto keyword(std::string_view pattern) -> std::optional<keyword_run>;
+
+// the signatures flirt::build takes, they need patterns
+auto build(std::vector<sig_object> const &sigFile) -> keyword_automaton;
+
+// section and symbol hits at every word aligned offset of ranges, an empty range list scans the whole rom
+// with signatures of a target that has halfword instructions, the offsets between words are scanned too
+// offsets are the heuristic candidates, only used for the unanchored signatures
+auto find_hits(keyword_automaton const &automaton, std::vector<sig_object> const &sigFile, std::span<const uint8_t> rom,
+               std::vector<rom_range> const &ranges, std::set<uint32_t> const &offsets) -> std::pair<std::vector<signature_hit>, std::vector<signature_hit>>;
+}  // namespace keyword_scan
@@ -0,0 +1,215 @@
+#include "libobjmatch.h"
+
+#include <exception>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "matcher.h"
+#include "objmatch.h"
+#include "objsig.h"
+#include "section_pattern.h"
+#include "signature.h"
+#include "splat_out.h"
+#include "string_table.h"
+
+struct objmatch_signatures {
+  // declared first so it is destroyed last
+  sig_arena arena;
+  std::vector<sig_object> sigs;
+  string_table strings;
+  signature_index index;
+};
+
+struct objmatch_splat_list {
+  std::vector<splat_out> splat;
+  std::vector<objmatch_splat_entry> entries;
+};
+
+struct objmatch_pattern_list {
+  std::vector<section_pattern> patterns;
+  std::vector<std::vector<objmatch_relocation>> relocations;
+  std::vector<objmatch_section_pattern> entries;
+};
+
+namespace {
+thread_local std::string last_error;
+
+// nothing may unwind through the c interface
+template <typename F>
+auto Guarded(F &&fn) -> decltype(fn()) {
+  last_error.clear();
+  try {
+    return fn();
+  } catch (const std::exception &e) {
+    last_error = e.what();
+  } catch (...) {
+    last_error = "unknown error";
+  }
+
+  return nullptr;
+}
+
+// libelf may convert an elf_memory image in place, so it gets its own copy
+auto CopyBytes(const void *data, size_t size) -> std::vector<char> {
+  const auto *bytes = static_cast<const char *>(data);
+  return {bytes, bytes + size};
+}
+
+auto ToSplat(const objmatch_splat_entry *splat, size_t splat_count) -> std::vector<splat_out> {
+  std::vector<splat_out> entries;
+  entries.reserve(splat_count);
+  for (const auto &entry : std::span{splat, splat_count}) {
+    entries.push_back(splat_out{.start = entry.start,
+                                .vram = entry.vram,
+                                .type = entry.type != nullptr ? entry.type : "",
+                                .name = entry.name != nullptr ? entry.name : ""});
+  }
+
+  return entries;
+}
+
+// c callers may pass any int as the enum
+auto ToRomKind(objmatch_rom_kind kind) -> rom_kind {
+  switch (kind) {
+    case OBJMATCH_ROM_RAW: return rom_kind::raw;
+    case OBJMATCH_ROM_Z64: return rom_kind::z64;
+    case OBJMATCH_ROM_N64: return rom_kind::n64;
+    case OBJMATCH_ROM_V64: return rom_kind::v64;
+    case OBJMATCH_ROM_GBA: return rom_kind::gba;
+    case OBJMATCH_ROM_NDS: return rom_kind::nds;
+  }
+
+  throw std::invalid_argument{"unknown rom kind"};
+}
+
+auto ToSplatList(std::vector<splat_out> splat) -> objmatch_splat_list * {
+  auto *list = new objmatch_splat_list{.splat = std::move(splat)};
+  list->entries.reserve(list->splat.size());
+  for (const auto &entry : list->splat) {
+    list->entries.push_back(objmatch_splat_entry{.start = entry.start, .vram = entry.vram, .type = entry.type.c_str(), .name = entry.name.c_str()});
+  }
+
+  return list;
+}
+
+// load fills the signatures from their arena
+template <typename F>
+auto BuildSignatures(F &&load) -> objmatch_signatures * {
+  auto signatures = std::make_unique<objmatch_signatures>();
+  signatures->sigs = load(&signatures->arena);
+  signatures->strings = InternSignatures(signatures->sigs);
+  signatures->index = BuildSignatureIndex(signatures->sigs, signatures->strings);
+
+  return signatures.release();
+}
+}  // namespace
+
+extern "C" {
+uint32_t objmatch_api_version(void) { return OBJMATCH_API_VERSION; }
+
+const char *objmatch_last_error(void) { return last_error.c_str(); }
+
+size_t objmatch_splat_list_size(const objmatch_splat_list *list) { return list != nullptr ? list->entries.size() : 0; }
+
+const objmatch_splat_entry *objmatch_splat_list_data(const objmatch_splat_list *list) { return list != nullptr ? list->entries.data() : nullptr; }
+
+void objmatch_splat_list_free(objmatch_splat_list *list) { delete list; }
+
+size_t objmatch_pattern_list_size(const objmatch_pattern_list *list) { return list != nullptr ? list->entries.size() : 0; }
+
+const objmatch_section_pattern *objmatch_pattern_list_data(const objmatch_pattern_list *list) { return list != nullptr ? list->entries.data() : nullptr; }
+
+void objmatch_pattern_list_free(objmatch_pattern_list *list) { delete list; }
+
+objmatch_signatures *objmatch_signatures_from_archive(const void *archive, size_t archive_size) {
+  return Guarded([&]() -> objmatch_signatures * {
+    auto bytes = CopyBytes(archive, archive_size);
+    return BuildSignatures([&bytes](sig_arena *arena) { return ProcessLibrary(std::span{bytes}, arena); });
+  });
+}
+
+objmatch_signatures *objmatch_signatures_from_sig(const char *sig, size_t sig_size) {
+  return Guarded([&]() -> objmatch_signatures * {
+    // deserialize parses in place
+    auto bytes = CopyBytes(sig, sig_size);
+    return BuildSignatures([&bytes](sig_arena *arena) { return sig_yaml::deserialize(bytes, arena); });
+  });
+}
+
+size_t objmatch_signatures_object_count(const objmatch_signatures *signatures) { return signatures != nullptr ? signatures->sigs.size() : 0; }
+
+void objmatch_signatures_free(objmatch_signatures *signatures) { delete signatures; }
+
+objmatch_splat_list *objmatch_scan(const objmatch_signatures *signatures, const void *rom, size_t rom_size, objmatch_rom_kind kind,
+                                   const objmatch_splat_entry *splat, size_t splat_count, const objmatch_range *ranges, size_t range_count) {
+  return Guarded([&]() -> objmatch_splat_list * {
+    if (signatures == nullptr) {
+      last_error = "no signatures";
+      return nullptr;
+    }
+
+    const auto *rom_bytes = static_cast<const uint8_t *>(rom);
+    const auto b_info = LoadBinary(std::vector<uint8_t>{rom_bytes, rom_bytes + rom_size}, ToRomKind(kind));
+
+    std::vector<rom_range> scan_ranges;
+    for (const auto &range : std::span{ranges, range_count}) scan_ranges.push_back(rom_range{.start = range.start, .end = range.end});
+
+    // same narrowing as ResolveRanges, with the splat config already in memory
+    if (splat != nullptr) {
+      auto unresolved = UnresolvedRanges(ToSplat(splat, splat_count), b_info.m_Binary.size());
+      scan_ranges = scan_ranges.empty() ? unresolved : IntersectRanges(unresolved, scan_ranges);
+      // everything is already identified
+      if (scan_ranges.empty()) return ToSplatList({});
+    }
+
+    const auto offsets = LikelyFunctionOffsets(b_info, scan_ranges, signatures->index.arch);
+    return ToSplatList(ProcessSignatureIndex(signatures->sigs, signatures->strings, signatures->index, b_info, offsets));
+  });
+}
+
+objmatch_pattern_list *objmatch_section_patterns(const void *archive, size_t archive_size) {
+  return Guarded([&]() -> objmatch_pattern_list * {
+    auto bytes = CopyBytes(archive, archive_size);
+    auto *list = new objmatch_pattern_list{.patterns = archive_to_section_patterns(std::span{bytes})};
+
+    list->relocations.reserve(list->patterns.size());
+    list->entries.reserve(list->patterns.size());
+    for (const auto &pattern : list->patterns) {
+      auto &relocations = list->relocations.emplace_back();
+      for (const auto &rel : pattern.relocations) relocations.push_back(objmatch_relocation{.type = rel.type, .offset = rel.offset, .addend = rel.addend});
+
+      list->entries.push_back(objmatch_section_pattern{.object = pattern.object.c_str(),
+                                                       .section = pattern.section.c_str(),
+                                                       .size = pattern.size,
+                                                       .crc_8 = pattern.crc_8,
+                                                       .crc_all = pattern.crc_all,
+                                                       .relocations = relocations.data(),
+                                                       .relocation_count = relocations.size()});
+    }
+
+    return list;
+  });
+}
+
+objmatch_splat_list *objmatch_match(const objmatch_splat_entry *splat, size_t splat_count, const void *rom, size_t rom_size,
+                                    const void *archive, size_t archive_size, const objmatch_file_path *paths, size_t path_count,
+                                    const char *prefix) {
+  return Guarded([&]() -> objmatch_splat_list * {
+    auto bytes = CopyBytes(archive, archive_size);
+    const auto sec_patterns = unique_section_patterns(archive_to_section_patterns(std::span{bytes}));
+
+    std::vector<file_path> file_paths;
+    file_paths.reserve(path_count);
+    for (const auto &path : std::span{paths, path_count}) {
+      file_paths.push_back(file_path{.file = path.file != nullptr ? path.file : "", .path = path.path != nullptr ? path.path : ""});
+    }
+
+    const std::span<const char> rom_bytes{static_cast<const char *>(rom), rom_size};
+    return ToSplatList(matcher(ToSplat(splat, splat_count), rom_bytes, sec_patterns, std::move(file_paths), prefix != nullptr ? prefix : ""));
+  });
+}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+/* c interface to objsig, objmatch and matcher for in process callers (ctypes, cffi)
+ * inputs are plain buffers, results are arrays owned by a handle that the caller frees
+ * functions returning a pointer return NULL on failure, objmatch_last_error says why
+ * calls share scratch buffers, so use the library from one thread at a time */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(OBJMATCH_BUILDING_LIBRARY)
+#define OBJMATCH_API __attribute__((visibility("default")))
+#else
+#define OBJMATCH_API
+#endif
+
+/* bumped whenever a declaration below changes incompatibly */
+#define OBJMATCH_API_VERSION 2
+
+OBJMATCH_API uint32_t objmatch_api_version(void);
+
+/* message for the last failed call on this thread, empty if none */
+OBJMATCH_API const char *objmatch_last_error(void);
+
+/* what a rom buffer holds, the file extension objmatch would go by
+ * n64 kinds byteswap .n64/.v64 layouts and read the header size from the ipl3,
+ * gba and nds kinds use the address their code runs at, raw roms are mapped at 0 */
+typedef enum objmatch_rom_kind {
+  OBJMATCH_ROM_RAW,
+  OBJMATCH_ROM_Z64,
+  OBJMATCH_ROM_N64,
+  OBJMATCH_ROM_V64,
+  OBJMATCH_ROM_GBA,
+  OBJMATCH_ROM_NDS,
+} objmatch_rom_kind;
+
+/* half open [start, end) window of rom offsets */
+typedef struct objmatch_range {
+  uint64_t start;
+  uint64_t end;
+} objmatch_range;
+
+/* one splat segment, type is "bin", "c", ".data", ... */
+typedef struct objmatch_splat_entry {
+  uint64_t start;
+  uint64_t vram;
+  const char *type;
+  const char *name;
+} objmatch_splat_entry;
+
+/* object file name and the directory it belongs to in the source tree */
+typedef struct objmatch_file_path {
+  const char *file;
+  const char *path;
+} objmatch_file_path;
+
+typedef struct objmatch_relocation {
+  uint64_t type;
+  uint64_t offset;
+  uint32_t addend;
+} objmatch_relocation;
+
+typedef struct objmatch_section_pattern {
+  const char *object;
+  const char *section;
+  uint64_t size;
+  uint32_t crc_8;
+  uint32_t crc_all;
+  const objmatch_relocation *relocations;
+  size_t relocation_count;
+} objmatch_section_pattern;
+
+/* result arrays, entries and their strings live until the list is freed */
+typedef struct objmatch_splat_list objmatch_splat_list;
+OBJMATCH_API size_t objmatch_splat_list_size(const objmatch_splat_list *list);
+OBJMATCH_API const objmatch_splat_entry *objmatch_splat_list_data(const objmatch_splat_list *list);
+OBJMATCH_API void objmatch_splat_list_free(objmatch_splat_list *list);
+
+typedef struct objmatch_pattern_list objmatch_pattern_list;
+OBJMATCH_API size_t objmatch_pattern_list_size(const objmatch_pattern_list *list);
+OBJMATCH_API const objmatch_section_pattern *objmatch_pattern_list_data(const objmatch_pattern_list *list);
+OBJMATCH_API void objmatch_pattern_list_free(objmatch_pattern_list *list);
+
+/* parsed and indexed signatures, build once and scan any number of roms */
+typedef struct objmatch_signatures objmatch_signatures;
+
+/* what objsig computes for an ar archive of elf objects */
+OBJMATCH_API objmatch_signatures *objmatch_signatures_from_archive(const void *archive, size_t archive_size);
+/* a .sig file written by objsig */
+OBJMATCH_API objmatch_signatures *objmatch_signatures_from_sig(const char *sig, size_t sig_size);
+OBJMATCH_API size_t objmatch_signatures_object_count(const objmatch_signatures *signatures);
+OBJMATCH_API void objmatch_signatures_free(objmatch_signatures *signatures);
+
+/* objmatch, finds signature sections in a rom of the given kind
+ * splat entries (may be NULL) limit the scan to their bin entries, ranges (may be NULL) limit it further */
+OBJMATCH_API objmatch_splat_list *objmatch_scan(const objmatch_signatures *signatures, const void *rom, size_t rom_size, objmatch_rom_kind kind,
+                                                const objmatch_splat_entry *splat, size_t splat_count, const objmatch_range *ranges,
+                                                size_t range_count);
+
+/* matcher, the sections of an archive as crc patterns */
+OBJMATCH_API objmatch_pattern_list *objmatch_section_patterns(const void *archive, size_t archive_size);
+
+/* matcher, names the splat entries whose bytes match a unique archive section */
+OBJMATCH_API objmatch_splat_list *objmatch_match(const objmatch_splat_entry *splat, size_t splat_count, const void *rom, size_t rom_size,
+                                                 const void *archive, size_t archive_size, const objmatch_file_path *paths, size_t path_count,
+                                                 const char *prefix);
+
+#ifdef __cplusplus
+}
+#endif
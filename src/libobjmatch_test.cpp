@@ -0,0 +1,77 @@
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "libobjmatch.h"
+
+namespace {
+auto read_file(const std::filesystem::path &path) -> std::vector<char> {
+  std::vector<char> bytes(std::filesystem::file_size(path));
+  std::ifstream file{path, std::ios::binary};
+  file.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  return bytes;
+}
+}  // namespace
+
+TEST_CASE("objmatch_section_patterns from an in memory archive", "[libobjmatch]") {
+  auto archive = read_file("src/object_test_src/out/libexample.a");
+
+  auto *list = objmatch_section_patterns(archive.data(), archive.size());
+
+  REQUIRE(list != nullptr);
+  REQUIRE(objmatch_pattern_list_size(list) == 3);
+  const auto *patterns = objmatch_pattern_list_data(list);
+  REQUIRE(patterns[0].object == std::string{"example.o"});
+  REQUIRE(patterns[0].section == std::string{".text"});
+  REQUIRE(patterns[2].section == std::string{".rodata"});
+
+  objmatch_pattern_list_free(list);
+}
+
+TEST_CASE("objmatch_signatures_from_archive matches the archive objects", "[libobjmatch]") {
+  auto archive = read_file("src/object_test_src/out/libexample.a");
+
+  auto *signatures = objmatch_signatures_from_archive(archive.data(), archive.size());
+
+  REQUIRE(signatures != nullptr);
+  REQUIRE(objmatch_signatures_object_count(signatures) == 1);
+
+  objmatch_signatures_free(signatures);
+}
+
+TEST_CASE("objmatch_scan skips a rom that is already identified", "[libobjmatch]") {
+  const std::string sig{"[]"};
+  auto *signatures = objmatch_signatures_from_sig(sig.data(), sig.size());
+  REQUIRE(signatures != nullptr);
+
+  const std::vector<char> rom(0x100);
+  const objmatch_splat_entry splat[]{{.start = 0, .vram = 0x80000000, .type = "c", .name = "main"}};
+
+  auto *list = objmatch_scan(signatures, rom.data(), rom.size(), OBJMATCH_ROM_RAW, splat, 1, nullptr, 0);
+
+  REQUIRE(list != nullptr);
+  REQUIRE(objmatch_splat_list_size(list) == 0);
+
+  objmatch_splat_list_free(list);
+  objmatch_signatures_free(signatures);
+}
+
+TEST_CASE("objmatch_scan reports missing signatures", "[libobjmatch]") {
+  const std::vector<char> rom(0x100);
+
+  REQUIRE(objmatch_scan(nullptr, rom.data(), rom.size(), OBJMATCH_ROM_RAW, nullptr, 0, nullptr, 0) == nullptr);
+  REQUIRE(std::string{objmatch_last_error()} == "no signatures");
+}
+
+TEST_CASE("objmatch_scan rejects an unknown rom kind", "[libobjmatch]") {
+  const std::string sig{"[]"};
+  auto *signatures = objmatch_signatures_from_sig(sig.data(), sig.size());
+  const std::vector<char> rom(0x100);
+
+  REQUIRE(objmatch_scan(signatures, rom.data(), rom.size(), static_cast<objmatch_rom_kind>(42), nullptr, 0, nullptr, 0) == nullptr);
+  REQUIRE(std::string{objmatch_last_error()} == "unknown rom kind");
+
+  objmatch_signatures_free(signatures);
+}
@@ -1,11 +1,11 @@
 #include <algorithm>
 #include <array>
-#include <bit>
 #include <crc32c/crc32c.h>
 #include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <optional>
 #include <elf.h>
 #include <fcntl.h>
 #include <png.h>
@@ -21,6 +21,9 @@
 #include "splat_out.h"
 #include "signature.h"
 #include "matcher.h"
+#include "prefilter.h"
+#include "run_stats.h"
+#include "target.h"
 
 
 namespace {
@@ -30,13 +33,6 @@ auto vector_reserved(uint64_t size) -> std::vector<T> {
   vec.reserve(size);
   return vec;
 }
-
-auto readswap32(const std::span<const uint8_t, 4> &buf) -> uint32_t {
-  uint32_t word{};
-  std::memcpy(&word, buf.data(), 4);
-
-  return std::byteswap(word);
-}
 }
 
 auto load(const std::filesystem::path &path) -> std::vector<char> {
@@ -52,33 +48,60 @@ auto load(const std::filesystem::path &path) -> std::vector<char> {
 auto matcher(const std::vector<splat_out> &yaml, const std::vector<char> &rom, int archive_file_descriptor, std::vector<file_path> paths, std::string prefix) -> std::vector<splat_out> {
   if(elf_version(EV_CURRENT) == EV_NONE) std::print("version out of date");
 
-  auto sec_patterns = no_dup_archive_to_section_patterns(archive_file_descriptor);
+  return matcher(yaml, rom, no_dup_archive_to_section_patterns(archive_file_descriptor), std::move(paths), std::move(prefix));
+}
+
+auto matcher(const std::vector<splat_out> &yaml, std::span<const char> rom, const std::vector<section_pattern> &sec_patterns, std::vector<file_path> paths, std::string prefix) -> std::vector<splat_out> {
+  const phase_timer timer{stat_phase::section_match};
 
+  // patterns are referenced, not copied, nothing in the compare loop allocates
   using start_pattern = struct start_pattern {
     uint64_t start {};
-    section_pattern pattern {};
+    const section_pattern *pattern {};
   };
 
+  // a pattern whose first 8 bytes are not relocated can only match where the raw rom bytes hash to its crc_8
+  // an entry whose prefix none of them has only needs the patterns relocated within their first 8 bytes
+  prefilter filter{sec_patterns.size()};
+  std::vector<const section_pattern *> relocated_prefix{};
+  for(const auto &pattern : sec_patterns) {
+    const bool keyed = pattern.size >= 8 && std::ranges::none_of(pattern.relocations, [](const auto &reloc) { return reloc.offset < 8; });
+    if (keyed) filter.insert(pattern.crc_8);
+    else relocated_prefix.push_back(&pattern);
+  }
+
+  uint64_t rejections = 0;
   std::vector<start_pattern> matched_patterns{};
-  for(auto entry : yaml) {
-    auto maybe_pattern = std::ranges::find_if(sec_patterns, [entry, rom](const auto &pattern) {
+  matched_patterns.reserve(yaml.size());
+  for(const auto &entry : yaml) {
+    const auto compare = [&entry, rom](const section_pattern &pattern) {
       auto data = std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(&rom[entry.start]), std::min(static_cast<uint64_t>(rom.size()), static_cast<uint64_t>(pattern.size)));
       return section_compare(pattern, data);
-    });
+    };
 
-    if (maybe_pattern != sec_patterns.end()) {
-      const auto &pattern = *maybe_pattern;
+    const section_pattern *found = nullptr;
+    if (entry.start + 8 > rom.size() || filter.may_contain(crc32c::Crc32c(reinterpret_cast<const uint8_t *>(&rom[entry.start]), 8))) {
+      auto maybe_pattern = std::ranges::find_if(sec_patterns, compare);
+      if (maybe_pattern != sec_patterns.end()) found = &*maybe_pattern;
+    } else {
+      // patterns keep their order, so the first match is the same one the full search finds
+      rejections++;
+      auto maybe_pattern = std::ranges::find_if(relocated_prefix, [&compare](const auto *pattern) { return compare(*pattern); });
+      if (maybe_pattern != relocated_prefix.end()) found = *maybe_pattern;
+    }
 
+    if (found != nullptr) {
       matched_patterns.push_back(start_pattern{
         .start = entry.start,
-        .pattern = pattern
+        .pattern = found
       });
     }
   }
+  run_stats::add(stat_counter::prefilter_rejections, rejections);
 
   //problem: sometimes the same pattern matches multiple places in the yaml
   std::ranges::sort(matched_patterns, [](start_pattern const &a, start_pattern const &b) {
-    auto crc_cmp = a.pattern.crc_all <=> b.pattern.crc_all;
+    auto crc_cmp = a.pattern->crc_all <=> b.pattern->crc_all;
     return crc_cmp < 0;
   });
 
@@ -87,22 +110,23 @@ auto matcher(const std::vector<splat_out> &yaml, const std::vector<char> &rom, i
   //nor can I understand the error messages
   auto patterns_unique_only = matched_patterns
     | std::views::chunk_by([](start_pattern const &a, start_pattern const &b) {
-      return a.pattern.crc_all == b.pattern.crc_all;
+      return a.pattern->crc_all == b.pattern->crc_all;
     })
     | std::views::filter(([](auto r) { return std::ranges::size(r) == 1; }) )
     | std::views::join
     | std::ranges::to<std::vector>();
+  run_stats::add(stat_counter::ambiguous_rejections, matched_patterns.size() - patterns_unique_only.size());
 
   std::vector<splat_out> output{};
   for(auto i = 0; i < yaml.size(); i+=1) {
     const auto &entry = yaml[i];
 
-    auto maybe_pattern = std::ranges::find_if(patterns_unique_only, [entry](const auto &pattern_match) {
+    auto maybe_pattern = std::ranges::find_if(patterns_unique_only, [&entry](const auto &pattern_match) {
       return entry.start == pattern_match.start;
     });
 
     if (maybe_pattern != patterns_unique_only.end()) {
-      const auto &pattern = maybe_pattern->pattern;
+      const auto &pattern = *maybe_pattern->pattern;
       auto obj_name = std::filesystem::path {pattern.object};
       auto type = std::string{
         pattern.section == ".text" ? "c" :
@@ -110,7 +134,7 @@ auto matcher(const std::vector<splat_out> &yaml, const std::vector<char> &rom, i
         pattern.section == ".rodata" ? ".rodata" :
         "bin"};
 
-      const auto preee = std::ranges::find_if(paths, [obj_name](const auto &x) {
+      const auto preee = std::ranges::find_if(paths, [&obj_name](const auto &x) {
         return x.file == obj_name;
       });
 
@@ -122,6 +146,7 @@ auto matcher(const std::vector<splat_out> &yaml, const std::vector<char> &rom, i
       }
       const auto &mypth = *preee;
 
+      run_stats::add(stat_counter::confirmed_matches);
       output.push_back(splat_out{
         .start = entry.start,
         .vram = entry.vram,
@@ -263,8 +288,10 @@ auto object_processing(Elf *object_file_elf) -> std::tuple<obj_ctx_status, objec
 }
 
 auto no_dup_archive_to_section_patterns(int archive_file_descriptor) -> std::vector<section_pattern> {
-  auto sec_patterns = archive_to_section_patterns(archive_file_descriptor);
+  return unique_section_patterns(archive_to_section_patterns(archive_file_descriptor));
+}
 
+auto unique_section_patterns(std::vector<section_pattern> sec_patterns) -> std::vector<section_pattern> {
   std::ranges::sort(sec_patterns, [](section_pattern const &a, section_pattern const &b) {
     auto size_cmp = a.size <=> b.size;
     if (size_cmp != 0) return size_cmp < 0;
@@ -288,12 +315,34 @@ auto no_dup_archive_to_section_patterns(int archive_file_descriptor) -> std::vec
     | std::views::join
     | std::ranges::to<std::vector>();
 
+  run_stats::add(stat_counter::duplicate_rejections, sec_patterns.size() - patterns_unique_only.size());
   return patterns_unique_only;
 }
 
 auto archive_to_section_patterns(int archive_file_descriptor) -> std::vector<section_pattern> {
   auto archive_elf = elf_begin(archive_file_descriptor, ELF_C_READ, nullptr);  // null check
 
+  auto section_patterns = archive_to_section_patterns(archive_file_descriptor, archive_elf);
+
+  elf_end(archive_elf);
+  return section_patterns;
+}
+
+auto archive_to_section_patterns(std::span<char> archive) -> std::vector<section_pattern> {
+  if(elf_version(EV_CURRENT) == EV_NONE) std::print("version out of date");
+
+  auto archive_elf = elf_memory(archive.data(), archive.size());
+  if (archive_elf == nullptr) return {};
+
+  // members of an in memory archive have no descriptor
+  auto section_patterns = archive_to_section_patterns(-1, archive_elf);
+
+  elf_end(archive_elf);
+  return section_patterns;
+}
+
+auto archive_to_section_patterns(int archive_file_descriptor, Elf *archive_elf) -> std::vector<section_pattern> {
+  const phase_timer timer{stat_phase::archive_parse};
   std::vector<section_pattern> section_patterns{};
 
   Elf_Cmd elf_command = ELF_C_READ;
@@ -307,6 +356,18 @@ auto archive_to_section_patterns(int archive_file_descriptor) -> std::vector<sec
       continue;
     }
 
+    // relocations are decoded and masked the way the object's target lays them out
+    GElf_Ehdr elf_header;
+    const auto arch = gelf_getehdr(object_file_elf, &elf_header) == nullptr
+                          ? std::nullopt
+                          : targets::detect(elf_header.e_machine, elf_header.e_ident[EI_DATA]);
+    if (!arch) {
+      std::println(stderr, "Skipping {}, not a mips or little endian arm object", obj_ctx.object_name);
+      elf_command = elf_next(object_file_elf);
+      elf_end(object_file_elf);
+      continue;
+    }
+
     section_patterns.reserve(obj_ctx.sections.size());
 
     for (auto sec_rec : obj_ctx.sections) {
@@ -356,6 +417,7 @@ auto archive_to_section_patterns(int archive_file_descriptor) -> std::vector<sec
       section_pattern sec_pat {
         .object = std::string(obj_ctx.object_name),
         .section = std::string(section_ctx.section_name),
+        .arch = *arch,
         .size = section_ctx.section_data->d_size
       };
 
@@ -386,47 +448,38 @@ auto archive_to_section_patterns(int archive_file_descriptor) -> std::vector<sec
         // but only STB_LOCAL seems to ever have an addend that is not 0
         // perhaps this is because most globals, like function refs, will have an addend of 0?
 
-        // possibly could use libelf for this conversion using ELF_T_WORD or something?
-        // the transformation to do here, depends the platform of the elf file
-        // But not the platform I'm running on, right? because IN REGISTER, things will be in the expected order
-        // probably should add comment explaining why alternatives are bad, alignment issues, host platform issues
-        auto opcodeBE = readswap32(opcode);
+        // the transformation to do here depends on the target of the elf file, not the host
+        // bytes are assembled one at a time, so alignment and host byte order do not matter
+        auto word = targets::load(*arch, opcode.data());
 
-        if (relocation_type == R_MIPS_HI16) {
-          addend = (opcodeBE & 0xFFFF) << 16;
+        if (targets::high_half(*arch, relocation_type)) {
+          addend = (word & 0xFFFF) << 16;
           GElf_Rel relocation2;
           // note, index + 1
           gelf_getrel(section_ctx.relocation_data, relocation_index + 1, &relocation2);  // todo guard
 
           // next relocation must be LO16
           auto relocation2_type = GELF_R_TYPE(relocation2.r_info);
-          if (relocation2_type != R_MIPS_LO16) {
+          if (!targets::low_half(*arch, relocation2_type)) {
             //error
           }
 
           const std::span<uint8_t, 4> opcode2(&sec_buff[relocation2.r_offset], 4);
-          auto opcode2BE = readswap32(opcode2);
+          auto word2 = targets::load(*arch, opcode2.data());
 
-          addend += static_cast<int16_t>(opcode2BE & 0xFFFF);
+          addend += static_cast<int16_t>(word2 & 0xFFFF);
           lastHi16Addend = addend;
 
-        } else if (relocation_type == R_MIPS_LO16) {
+        } else if (targets::low_half(*arch, relocation_type)) {
           addend = lastHi16Addend;
-        } else if (relocation_type == R_MIPS_26) {
-          addend = (opcodeBE & 0x03FFFFFF) << 2;
+        } else {
+          addend = targets::addend(*arch, relocation_type, word);
         }
 
-        if (relocation_type == R_MIPS_HI16 || relocation_type == R_MIPS_LO16) {
-          opcode[2] = 0x00;
-          opcode[3] = 0x00;
-        } else if (relocation_type == R_MIPS_26) {
-          opcode[0] &= 0xFC;
-          opcode[1] = 0x00;
-          opcode[2] = 0x00;
-          opcode[3] = 0x00;
-        } else {
+        if (!targets::strip(*arch, opcode.data(), relocation_type)) {
           // Need to log more context
           // printf("# warning unhandled relocation type\n");
+          run_stats::add(stat_counter::unmasked_relocations);
           continue;
           // printf("unk rel %d\n", relType);
           // exit(0);
@@ -456,24 +509,15 @@ std::vector<uint8_t> data_buf{};
 
 auto section_compare(const section_pattern &pattern, std::span<const uint8_t> data) -> bool {
   if (pattern.size != data.size()) return false;
+  run_stats::add(stat_counter::crc_all_checks);
 
   data_buf.resize(pattern.size);
   data_buf.reserve(pattern.size);
   std::ranges::copy(data, data_buf.begin());
 
-  for (const auto &reloc : pattern.relocations) {
-    if (reloc.type == 4) {
-      //R_MIPS_26
-      data_buf[reloc.offset + 0] &= 0xFC;
-      data_buf[reloc.offset + 1] = 0x00;
-      data_buf[reloc.offset + 2] = 0x00;
-      data_buf[reloc.offset + 3] = 0x00;
-    } else if (reloc.type == 5 || reloc.type == 6) {
-      //R_MIPS_HI16 || R_MIPS_LO16
-      data_buf[reloc.offset + 2] = 0x00;
-      data_buf[reloc.offset + 3] = 0x00;
-    }
-  }
+  targets::visit(pattern.arch, [&pattern](auto target) {
+    for (const auto &reloc : pattern.relocations) targets::strip_relocation<decltype(target)>(&data_buf[reloc.offset], reloc.type);
+  });
 
   const auto crcA = crc32c::Crc32c(data_buf.data(), std::min(pattern.size, static_cast<uint64_t>(8)));
 
@@ -46,8 +46,15 @@ enum class obj_ctx_status : std::uint8_t { ok, not_object, no_symtab };
 
 auto object_processing(Elf *object_file_elf) -> std::tuple<obj_ctx_status, object_context>;
 auto archive_to_section_patterns(int archive_file_descriptor) -> std::vector<section_pattern>;
+// archive already in memory, it is not copied and must outlive the call
+auto archive_to_section_patterns(std::span<char> archive) -> std::vector<section_pattern>;
+// archive_file_descriptor is -1 for elf_memory archives
+auto archive_to_section_patterns(int archive_file_descriptor, Elf *archive_elf) -> std::vector<section_pattern>;
 auto no_dup_archive_to_section_patterns(int archive_file_descriptor) -> std::vector<section_pattern>;
+// drops patterns whose crc_all is shared, they can not tell their objects apart
+auto unique_section_patterns(std::vector<section_pattern> sec_patterns) -> std::vector<section_pattern>;
 auto section_compare(const section_pattern &pattern, std::span<const uint8_t> data) -> bool;
 auto load(const std::filesystem::path &path) -> std::vector<char>;
 auto matcher(const std::vector<splat_out> &splat, const std::vector<char> &rom, int archive_file_descriptor, std::vector<file_path> paths, std::string prefix) -> std::vector<splat_out>;
+auto matcher(const std::vector<splat_out> &splat, std::span<const char> rom, const std::vector<section_pattern> &sec_patterns, std::vector<file_path> paths, std::string prefix) -> std::vector<splat_out>;
 auto analyze(int archive_file_descriptor) -> void;
@@ -1,11 +1,38 @@
+#include <optional>
 #include <print>
+#include <string_view>
+#include <vector>
 #include "matcher.h"
+#include "result_cache.h"
+#include "run_stats.h"
+#include "trace.h"
 #include "splat_out.h"
 #include "files_to_mapping.h"
 #include "file_path_yaml.h"
 
 auto main(int argc, const char* argv[]) -> int {
-  const std::span<const char *> args = {argv, static_cast<size_t>(argc)};
+  // -t <text|json> and -T <trace path> may appear anywhere, the other arguments are positional
+  std::vector<const char *> positional;
+  std::optional<stats_format> stats;
+  for (int argi = 0; argi < argc; argi++) {
+    if (std::string_view{argv[argi]} == "-t" && argi + 1 < argc) {
+      stats = run_stats::parse_format(argv[argi + 1]);
+      if (!stats) {
+        std::println("Error: Stats format '{}' is not text or json", argv[argi + 1]);
+        return 1;
+      }
+      perf_counters::enable();
+      argi++;
+      continue;
+    }
+    if (std::string_view{argv[argi]} == "-T" && argi + 1 < argc) {
+      trace::start(argv[argi + 1]);
+      argi++;
+      continue;
+    }
+    positional.push_back(argv[argi]);
+  }
+  const std::span<const char *> args = positional;
 
   if (*args[1] != 'f') {
     auto dir_path = std::filesystem::path {args[2]};
@@ -22,29 +49,50 @@ auto main(int argc, const char* argv[]) -> int {
   }
 
   auto file_path = std::filesystem::path {args[2]};
+  auto rom_path = std::filesystem::path {args[3]};
 
+  std::optional<phase_timer> load_timer{std::in_place, stat_phase::rom_load};
   auto yaml_data = load(file_path);
-  auto yaml = splat_yaml::deserialize(yaml_data);
-
-  auto rom_path = std::filesystem::path {args[3]};
   auto rom = load(rom_path);
+  load_timer.reset();
 
   auto archive_path = std::filesystem::path {args[4]};
-  auto archive_file_descriptor = open(archive_path.c_str(), O_RDONLY | O_CLOEXEC);
 
   auto dir_path = std::string {args[5]};
   auto result = files_to_mapping(dir_path);
 
   auto prefix = std::string {args[6]};
 
+  // optional cache directory, a repeat run with the same inputs skips matching
+  const auto cache_dir = args.size() > 7 ? std::optional<std::filesystem::path>{args[7]} : std::nullopt;
+  std::string result_key;
+  if (cache_dir) {
+    // keyed before the yaml is parsed, parsing happens in place
+    result_key = result_cache::key({yaml_data, rom, load(archive_path), file_path_yaml::serialize(result), prefix});
+    if (auto cached = result_cache::load(*cache_dir, result_key)) {
+      std::println("{}", std::string_view(cached->data(), cached->size()));
+      if (stats) std::print(stderr, "{}", run_stats::report(*stats));
+      return trace::finish() ? 0 : 1;
+    }
+  }
+
+  auto yaml = splat_yaml::deserialize(yaml_data);
+
+  auto archive_file_descriptor = open(archive_path.c_str(), O_RDONLY | O_CLOEXEC);
+
   // move to main or static?
   auto output = matcher(yaml, rom, archive_file_descriptor, result, prefix);
 
   close(archive_file_descriptor);
 
-  auto blah = splat_yaml::serialize(output);
+  {
+    const phase_timer timer{stat_phase::emit};
+    auto blah = splat_yaml::serialize(output);
+    if (cache_dir) result_cache::store(*cache_dir, result_key, blah);
 
-  std::println("{}", std::string_view(blah));
+    std::println("{}", std::string_view(blah));
+  }
 
-  return 0;
+  if (stats) std::print(stderr, "{}", run_stats::report(*stats));
+  return trace::finish() ? 0 : 1;
 }
@@ -1,4 +1,5 @@
 #include <catch2/catch_test_macros.hpp>
+#include <crc32c/crc32c.h>
 #include <format>
 #include <vector>
 #include "signature.h"
@@ -157,6 +158,33 @@ TEST_CASE("find_section_in_bin", "[matcher]") {
   REQUIRE(match);
 }
 
+TEST_CASE("section_compare masks relocations the way the pattern's target lays them out", "[matcher]") {
+  // addiu sp, jal, nop, lui, addiu, jr ra, each word stored little endian as on the ps1
+  std::vector<uint8_t> data{0xE0, 0xFF, 0xBD, 0x27, 0x56, 0x34, 0x12, 0x0C, 0x00, 0x00, 0x00, 0x00,
+                            0x10, 0x80, 0x01, 0x3C, 0x34, 0x12, 0x21, 0x24, 0x08, 0x00, 0xE0, 0x03};
+  auto masked = data;
+  masked[4] = masked[5] = masked[6] = 0;
+  masked[7] &= 0xFC;
+  masked[12] = masked[13] = masked[16] = masked[17] = 0;
+
+  section_pattern pattern{.object = "a.o",
+                          .section = ".text",
+                          .arch = target_arch::mips_le,
+                          .size = data.size(),
+                          .crc_8 = crc32c::Crc32c(masked.data(), 8),
+                          .crc_all = crc32c::Crc32c(masked.data(), masked.size()),
+                          .relocations = {sec_relocation{.type = R_MIPS_26, .offset = 4}, sec_relocation{.type = R_MIPS_HI16, .offset = 12},
+                                          sec_relocation{.type = R_MIPS_LO16, .offset = 16}}};
+
+  // relinked, the jal target and the lo16 change
+  data[4] = 0x99;
+  data[16] = 0x78;
+  REQUIRE(section_compare(pattern, data));
+
+  pattern.arch = target_arch::mips_be;
+  REQUIRE_FALSE(section_compare(pattern, data));
+}
+
 TEST_CASE("matcher", "[matcher]") {
   auto start = std::filesystem::path {"src/object_test_src/out/start"};
   auto start_descriptor = open(start.c_str(), O_RDONLY | O_CLOEXEC);
@@ -13,10 +13,21 @@
 #include <filesystem>
 #include <format>
 #include <fstream>
+#include <future>
 #include <map>
+#include <memory_resource>
 #include <print>
 #include <set>
-
+#include <tuple>
+#include <utility>
+
+#include "flirt.h"
+#include "fuzzy.h"
+#include "kernels.h"
+#include "objsig.h"
+#include "result_cache.h"
+#include "run_stats.h"
+#include "trace.h"
 #include "splat_out.h"
 
 std::vector<uint8_t> func_buf{};
@@ -35,76 +46,122 @@ auto read32(const std::span<const uint8_t, 4> &buf) -> uint32_t {
 
   return word;
 }
+}  // namespace
+
+auto RomKind(const std::filesystem::path &path) -> rom_kind {
+  const auto extension = path.extension();
+  if (extension == ".z64") return rom_kind::z64;
+  if (extension == ".n64") return rom_kind::n64;
+  if (extension == ".v64") return rom_kind::v64;
+  if (extension == ".gba") return rom_kind::gba;
+  if (extension == ".nds") return rom_kind::nds;
+  return rom_kind::raw;
+}
 
-auto readswap16(const std::span<const uint8_t, 2> &buf) -> uint16_t {
-  uint16_t word{};
-  std::memcpy(&word, buf.data(), 2);
+auto LoadBinary(const char *binPath) -> binary_info {
+  std::vector<uint8_t> bytes;
+  {
+    const phase_timer timer{stat_phase::rom_load};
+    std::ifstream file{binPath, std::ios::binary};
+
+    const auto file_size = std::filesystem::file_size(binPath);
+    bytes.resize(file_size);
+    file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(file_size));
+  }
 
-  return std::byteswap(word);
+  return LoadBinary(std::move(bytes), RomKind(binPath));
 }
 
-auto LoadBinary(const char *binPath) -> binary_info {
+auto LoadBinary(std::vector<uint8_t> bytes, rom_kind kind) -> binary_info {
   binary_info b_info;
 
-  std::ifstream file{binPath, std::ios::binary};
+  b_info.m_BinarySize = bytes.size();
+  b_info.m_Binary = std::move(bytes);
+
+  switch (kind) {
+    case rom_kind::z64:
+    case rom_kind::n64:
+    case rom_kind::v64:
+      // the header checks below read the whole ipl3
+      if (b_info.m_BinarySize >= 0x1000) {
+        const phase_timer timer{stat_phase::byte_swap};
+        uint32_t const endianCheck = readswap32(std::span<const uint8_t, 4>{b_info.m_Binary.data(), 4});
+
+        if (endianCheck == 0x40123780) {
+          kernels::active().swap32(b_info.m_Binary);
+        } else if (endianCheck == 0x37804012) {
+          kernels::active().swap16(b_info.m_Binary);
+        }
 
-  b_info.m_BinarySize = std::filesystem::file_size(binPath);
-  b_info.m_Binary = std::vector<uint8_t>(b_info.m_BinarySize);
+        boost::crc_32_type result;
+        result.process_bytes(&b_info.m_Binary[0x40], 0xFC0);
+        auto const bootCheck = result.checksum();
 
-  b_info.m_Binary.reserve(b_info.m_BinarySize);
-  file.read(reinterpret_cast<char*>(b_info.m_Binary.data()), b_info.m_BinarySize);
+        const auto entryPointOff = bootCheck == 0x0B050EE0 ? 0x100000 : // 6103
+          bootCheck == 0xACC8580A ? 0x200000 : // 6106
+          0;
 
-  const std::filesystem::path fs_path{binPath};
-  if ((fs_path.extension() == ".z64" || fs_path.extension() == ".n64" || fs_path.extension() == ".v64") /*&& !m_bOverrideHeaderSize*/) {
-    uint32_t const endianCheck = readswap32(std::span<const uint8_t, 4>{b_info.m_Binary.data(), 4});
+        const uint32_t entryPoint = readswap32(std::span<const uint8_t, 4>{&b_info.m_Binary[0x08], 4});
 
-    if (endianCheck == 0x40123780) {
-      for (size_t i = 0; i < b_info.m_BinarySize; i += sizeof(uint32_t)) {
-        uint32_t const data = readswap32(std::span<const uint8_t, 4>{&b_info.m_Binary[i], 4});
-        std::memcpy(&b_info.m_Binary[i], &data, 4);
+        b_info.m_HeaderSize = entryPoint - entryPointOff - 0x1000;
       }
-    } else if (endianCheck == 0x37804012) {
-      for (size_t i = 0; i < b_info.m_BinarySize; i += sizeof(uint16_t)) {
-        uint16_t const data = readswap16(std::span<const uint8_t, 2>{&b_info.m_Binary[i], 2});
-        std::memcpy(&b_info.m_Binary[i], &data, 2);
+      break;
+    // gba carts are mapped at 0x08000000
+    case rom_kind::gba:
+      b_info.m_HeaderSize = 0x08000000;
+      break;
+    // nds arm9 code is copied from its rom offset to its ram address
+    case rom_kind::nds:
+      if (b_info.m_BinarySize >= 0x2C) {
+        const auto arm9_rom_offset = arm_target::load(&b_info.m_Binary[0x20]);
+        const auto arm9_ram_address = arm_target::load(&b_info.m_Binary[0x28]);
+        b_info.m_HeaderSize = arm9_ram_address - arm9_rom_offset;
       }
-    }
-
-    boost::crc_32_type result;
-    result.process_bytes(&b_info.m_Binary[0x40], 0xFC0);
-    auto const bootCheck = result.checksum();
-
-    const auto entryPointOff = bootCheck == 0x0B050EE0 ? 0x100000 : // 6103
-      bootCheck == 0xACC8580A ? 0x200000 : // 6106
-      0;
+      break;
+    case rom_kind::raw:
+      break;
+  }
 
-    const uint32_t entryPoint = readswap32(std::span<const uint8_t, 4>{&b_info.m_Binary[0x08], 4});
+  return b_info;
+}
 
-    b_info.m_HeaderSize = entryPoint - entryPointOff - 0x1000;
+namespace {
+// candidates are traced in batches of one result cache chunk, a span per offset would dwarf the work
+using trace_batch = struct trace_batch {
+  explicit trace_batch(std::string_view name) : name{name}, tracing{trace::enabled()} {}
+
+  auto next(uint64_t rom_offset) -> void {
+    if (!tracing || rom_offset / result_cache::chunk_size == chunk) return;
+    chunk = rom_offset / result_cache::chunk_size;
+    span.reset();
+    span.emplace("objmatch", name, chunk * result_cache::chunk_size);
   }
 
-  return b_info;
+ private:
+  std::string_view name;
+  bool tracing{};
+  uint64_t chunk{UINT64_MAX};
+  std::optional<trace_span> span;
+};
+
+// crc_all matched, a different 64 bit hash means a crc32c collision rather than the same bytes
+auto HashMatches(sig_hash hash, uint64_t hash_all, std::span<const uint8_t> bytes) -> bool {
+  if (hash == sig_hash::none || hash64::extend(hash, 0, bytes.data(), bytes.size()) == hash_all) return true;
+  run_stats::add(stat_counter::hash_rejections);
+  return false;
 }
 }
 
-auto TestSymbol(sig_symbol const &symbol, const std::span<const uint8_t> &buffer) -> bool {
+auto TestSymbol(sig_symbol const &symbol, const std::span<const uint8_t> &buffer, target_arch arch) -> bool {
+  if (buffer.size() < symbol.size) return false;
+
   func_buf.resize(symbol.size);
   func_buf.reserve(symbol.size);
   std::memcpy(func_buf.data(), buffer.data(), symbol.size);
 
-  for (const auto &reloc : symbol.relocations) {
-    if (reloc.type == 4) {
-      //R_MIPS_26
-      func_buf[0] &= 0xFC;
-      func_buf[1] = 0x00;
-      func_buf[2] = 0x00;
-      func_buf[3] = 0x00;
-    } else if (reloc.type == 5 || reloc.type == 6) {
-      //R_MIPS_HI16 || R_MIPS_LO16
-      func_buf[2] = 0x00;
-      func_buf[3] = 0x00;
-    }
-  }
+  targets::visit(arch, [&symbol](auto target) {
+    for (const auto &reloc : symbol.relocations) targets::strip_relocation<decltype(target)>(&func_buf[reloc.offset], reloc.type);
+  });
 
   const auto crcA = crc32c::Crc32c(func_buf.data(), std::min(symbol.size, static_cast<uint64_t>(8)));
 
@@ -112,133 +169,632 @@ auto TestSymbol(sig_symbol const &symbol, const std::span<const uint8_t> &buffer
 
   const auto crcB = crc32c::Crc32c(func_buf.data(), symbol.size);
 
-  return symbol.crc_all == crcB;
+  return symbol.crc_all == crcB && HashMatches(symbol.hash, symbol.hash_all, std::span{func_buf}.first(symbol.size));
 }
 
-auto ObjMatchBloop(const char *binPath, const char *libPath) -> bool {
-  auto b_info = LoadBinary(binPath);
+auto TestSection(sig_section const &section, const std::span<const uint8_t> &buffer, target_arch arch) -> bool {
+  if (section.size == 0 || buffer.size() < section.size) return false;
 
-  if (b_info.m_Binary.empty()) return false;
+  func_buf.resize(section.size);
+  std::memcpy(func_buf.data(), buffer.data(), section.size);
 
-  std::set<uint32_t> m_LikelyFunctionOffsets;
+  // objsig only masks relocations that fall inside a symbol
+  targets::visit(arch, [&section](auto target) {
+    for (const auto &symbol : section.symbols) {
+      for (const auto &reloc : symbol.relocations) targets::strip_relocation<decltype(target)>(&func_buf[symbol.offset + reloc.offset], reloc.type);
+    }
+  });
 
-  for (size_t i = 0; i < b_info.m_BinarySize; i += sizeof(uint32_t)) {
-    uint32_t const word = readswap32(std::span<const uint8_t, 4>{&b_info.m_Binary[i], 4});
+  const auto crcA = crc32c::Crc32c(func_buf.data(), std::min(section.size, static_cast<uint64_t>(8)));
 
-    // JR RA (+ 8)
-    if (word == 0x03E00008) {
-      if (read32(std::span<const uint8_t, 4>{&b_info.m_Binary[i + 8], 4}) != 0x00000000) {
-        m_LikelyFunctionOffsets.insert(i + 8);
-      }
+  if (section.crc_8 != crcA) return false;
+
+  const auto crcB = crc32c::Crc32c(func_buf.data(), section.size);
+
+  return section.crc_all == crcB && HashMatches(section.hash, section.hash_all, std::span{func_buf}.first(section.size));
+}
+
+auto UnresolvedRanges(std::vector<splat_out> const &splat, uint64_t rom_size) -> std::vector<rom_range> {
+  std::vector<rom_range> ranges;
+  for (auto entry = splat.begin(); entry != splat.end(); ++entry) {
+    if (entry->type != "bin") continue;
+    const auto end = entry + 1 != splat.end() ? entry[1].start : rom_size;
+    if (entry->start >= end) continue;
+
+    // neighbouring bin entries are one range
+    if (!ranges.empty() && ranges.back().end == entry->start) {
+      ranges.back().end = end;
+    } else {
+      ranges.push_back(rom_range{.start = entry->start, .end = end});
     }
+  }
 
-    // ADDIU SP, SP, -n
-    if ((word & 0xFFFF0000) == 0x27BD0000 && static_cast<int16_t>(word & 0xFFFF) < 0) {
-      m_LikelyFunctionOffsets.insert(i);
+  return ranges;
+}
+
+auto IntersectRanges(std::vector<rom_range> const &a, std::vector<rom_range> const &b) -> std::vector<rom_range> {
+  std::vector<rom_range> ranges;
+  for (const auto &x : a) {
+    for (const auto &y : b) {
+      const auto start = std::max(x.start, y.start);
+      const auto end = std::min(x.end, y.end);
+      if (start < end) ranges.push_back(rom_range{.start = start, .end = end});
+    }
+  }
+  std::ranges::sort(ranges, {}, &rom_range::start);
+
+  return ranges;
+}
+
+auto LikelyFunctionOffsets(binary_info const &b_info, std::vector<rom_range> const &ranges, target_arch arch) -> std::set<uint32_t> {
+  const phase_timer timer{stat_phase::candidate_scan};
+  const auto whole_rom = std::vector{rom_range{.start = 0, .end = b_info.m_Binary.size()}};
+
+  uint64_t jr_ra_candidates = 0;
+  uint64_t addiu_sp_candidates = 0;
+  std::set<uint32_t> m_LikelyFunctionOffsets;
+  std::vector<uint64_t> jr_ra;
+  std::vector<uint64_t> addiu_sp;
+  const auto &scan = kernels::active();
+  for (const auto &range : ranges.empty() ? whole_rom : ranges) {
+    const auto end = std::min(range.end, static_cast<uint64_t>(b_info.m_Binary.size()));
+    // rom words are aligned, ranges from splat should be too
+    const auto start = range.start & ~uint64_t{3};
+    if (start >= end) continue;
+
+    jr_ra.clear();
+    addiu_sp.clear();
+    scan.scan_words(arch, std::span{b_info.m_Binary}.subspan(start, end - start), start, jr_ra, addiu_sp);
+
+    // JR RA (+ 8), BX LR (+ 4, or + 2 in thumb)
+    targets::visit(arch, [&b_info, &jr_ra, &m_LikelyFunctionOffsets, &jr_ra_candidates, end](auto target) {
+      for (auto i : jr_ra) {
+        const auto next = i + decltype(target)::after_return(&b_info.m_Binary[i]);
+        if (next + 4 <= end && read32(std::span<const uint8_t, 4>{&b_info.m_Binary[next], 4}) != 0x00000000) {
+          m_LikelyFunctionOffsets.insert(next);
+          jr_ra_candidates++;
+        }
+      }
+    });
+
+    // ADDIU SP, SP, -n, PUSH {.., LR}
+    for (auto i : addiu_sp) {
+      if (i >= range.start) {
+        m_LikelyFunctionOffsets.insert(i);
+        addiu_sp_candidates++;
+      }
     }
 
     // todo JALs?
   }
 
-  const std::filesystem::path fs_path{libPath};
-  if (fs_path.extension() == ".sig") {
-    std::ifstream file {fs_path, std::ios::binary};
-  
-    const auto file_size {std::filesystem::file_size(fs_path)};
-    std::vector<char> yaml_data(file_size);
-    yaml_data.reserve(file_size);
+  run_stats::add(stat_counter::jr_ra_candidates, jr_ra_candidates);
+  run_stats::add(stat_counter::addiu_sp_candidates, addiu_sp_candidates);
+  return m_LikelyFunctionOffsets;
+}
+
+auto ResolveRanges(binary_info const &b_info, objmatch_options const &options) -> std::optional<std::vector<rom_range>> {
+  const phase_timer timer{stat_phase::range_resolve};
+  if (options.splat_path == nullptr) return options.ranges;
 
-    file.read(yaml_data.data(), file_size);
+  // an existing splat config limits the scan to what is still unidentified
+  const std::filesystem::path splat_path{options.splat_path};
+  std::ifstream splat_file{splat_path, std::ios::binary};
+  std::vector<char> splat_data(std::filesystem::file_size(splat_path));
+  splat_file.read(splat_data.data(), static_cast<std::streamsize>(splat_data.size()));
 
-    auto sigs = sig_yaml::deserialize(yaml_data);
+  auto unresolved = UnresolvedRanges(splat_yaml::deserialize(splat_data), b_info.m_Binary.size());
+  auto ranges = options.ranges.empty() ? unresolved : IntersectRanges(unresolved, options.ranges);
+  if (ranges.empty()) return std::nullopt;
 
-    auto temp = ProcessSignatureFile(sigs, b_info, m_LikelyFunctionOffsets);
+  return ranges;
+}
 
-    const auto output = splat_yaml::serialize(temp);
+auto ObjMatchBloop(const char *binPath, const char *libPath, objmatch_options const &options) -> bool {
+  // an archive is turned into signatures in memory instead of read from a .sig
+  const bool from_archive = options.archive_path != nullptr;
+  const std::filesystem::path fs_path{from_archive ? options.archive_path : libPath};
+  if (!from_archive && fs_path.extension() != ".sig") return true;
+
+  std::ifstream file {fs_path, std::ios::binary};
+
+  const auto file_size {std::filesystem::file_size(fs_path)};
+  std::vector<char> lib_data(file_size);
+
+  file.read(lib_data.data(), static_cast<std::streamsize>(file_size));
+
+  // libelf parses the archive while the rom is loaded and its ranges resolved
+  // with a cache the parse waits for the lookup, a hit needs no signatures
+  // declared first, the signatures and a still running parse must not outlive it
+  sig_arena arena;
+  std::future<std::vector<sig_object>> library;
+  auto parse_library = [&library, &lib_data, &arena]() {
+    library = std::async(std::launch::async, [&lib_data, &arena]() {
+      const phase_timer timer{stat_phase::signature_load};
+      return ProcessLibrary(std::span{lib_data}, &arena);
+    });
+  };
+  if (from_archive && options.cache_dir == nullptr) parse_library();
 
-    std::println("{}", std::string_view(output));
+  auto b_info = LoadBinary(binPath);
+
+  if (b_info.m_Binary.empty()) return false;
+
+  const auto resolved = ResolveRanges(b_info, options);
+  // everything is already identified
+  if (!resolved) return true;
+  const auto &ranges = *resolved;
+
+  // keys are taken before parsing, deserialize parses in place
+  // they hash the whole rom and library, so uncached runs skip them
+  std::string result_key;
+  std::string hits_key;
+  if (options.cache_dir != nullptr) {
+    const std::span<const char> rom_bytes{reinterpret_cast<const char *>(b_info.m_Binary.data()), b_info.m_Binary.size()};
+    const std::span<const char> range_bytes{reinterpret_cast<const char *>(ranges.data()), ranges.size() * sizeof(rom_range)};
+    result_key = result_cache::key({rom_bytes, lib_data, range_bytes});
+    hits_key = result_cache::key({lib_data, range_bytes, std::string_view{"chunk_hits"}});
+
+    if (auto cached = result_cache::load(options.cache_dir, result_key)) {
+      std::println("{}", std::string_view(cached->data(), cached->size()));
+      return true;
+    }
+    if (from_archive) parse_library();
   }
 
+  std::vector<uint8_t> compiled_trie;
+  auto sigs = from_archive ? library.get() : [&lib_data, &arena, &compiled_trie]() {
+    const phase_timer timer{stat_phase::signature_load};
+    return sig_yaml::deserialize(lib_data, &arena, &compiled_trie);
+  }();
+  const auto strings = InternSignatures(sigs);
+
+  // the rom has no header, the signatures say which instructions the candidates are found by
+  const auto arch = SignatureTarget(sigs);
+  if (!arch) {
+    std::println(stderr, "Error: Signatures mix targets, build them from one architecture and byte order");
+    return false;
+  }
+  const auto m_LikelyFunctionOffsets = LikelyFunctionOffsets(b_info, ranges, *arch);
+
+  // a trie compiled in by objsig -F, or -F here, switches to the flirt engine
+  // the result cache keeps hits of the index engine, so a cached run stays on that
+  // the exhaustive scan keys on the same patterns and takes precedence
+  const bool exhaustive = options.exhaustive && options.cache_dir == nullptr && flirt::has_patterns(sigs);
+  if (options.exhaustive && !exhaustive) std::println(stderr, "Signatures have no flirt patterns or a cache is used, scanning likely function offsets only");
+  std::optional<flirt_trie> trie;
+  if (!exhaustive && options.cache_dir == nullptr && !compiled_trie.empty()) trie = flirt::deserialize(compiled_trie, sigs);
+  if (!exhaustive && options.cache_dir == nullptr && !trie && options.flirt && flirt::has_patterns(sigs)) trie = flirt::build(sigs);
+  if (options.flirt && !exhaustive && !trie) std::println(stderr, "Signatures have no flirt patterns or a cache is used, matching with the signature index");
+
+  // fuzzy scoring runs on the index engine's anchor hits
+  if (options.fuzzy_percent != 0 && (exhaustive || trie || options.cache_dir != nullptr)) {
+    std::println(stderr, "Fuzzy matching only runs with the signature index and without a cache, matching exactly");
+  }
+  if (options.fuzzy_percent != 0 && !fuzzy::has_words(sigs)) std::println(stderr, "Signatures have no words to score, write them with objsig -W");
+
+  std::vector<splat_out> temp;
+  if (exhaustive) {
+    temp = ProcessSignatureScan(sigs, strings, keyword_scan::build(sigs), b_info, ranges, m_LikelyFunctionOffsets);
+  } else if (trie) {
+    temp = ProcessSignatureTrie(sigs, strings, *trie, b_info, m_LikelyFunctionOffsets);
+  } else {
+    const auto index = BuildSignatureIndex(sigs, strings);
+    if (options.cache_dir != nullptr) {
+      temp = ProcessSignatureFileCached(sigs, strings, index, b_info, m_LikelyFunctionOffsets, options.cache_dir, hits_key);
+    } else if (options.fuzzy_percent != 0) {
+      temp = ProcessSignatureFuzzy(sigs, strings, index, b_info, m_LikelyFunctionOffsets, options.fuzzy_percent);
+    } else {
+      temp = ProcessSignatureIndex(sigs, strings, index, b_info, m_LikelyFunctionOffsets);
+    }
+  }
+
+  const phase_timer emit_timer{stat_phase::emit};
+  const auto output = splat_yaml::serialize(temp);
+  if (options.cache_dir != nullptr) result_cache::store(options.cache_dir, result_key, output);
+
+  std::println("{}", std::string_view(output));
+
   return true;
 }
 
-auto ProcessSignatureFile(std::vector<sig_object> const &sigFile, binary_info const &b_info, const std::set<uint32_t> &m_LikelyFunctionOffsets)
-    -> std::vector<splat_out> {
-  std::unordered_map<std::string, sig_obj_sec_sym> sym_map;
-  for (auto const &sig_obj : sigFile) {
-    for (auto const &sig_section : sig_obj.sections) {
+auto InternSignatures(std::vector<sig_object> &sigFile) -> string_table {
+  const phase_timer timer{stat_phase::index_build};
+  string_table strings;
+  for (auto &sig_obj : sigFile) {
+    sig_obj.file_id = strings.intern(sig_obj.file);
+    for (auto &sig_section : sig_obj.sections) {
+      sig_section.name_id = strings.intern(sig_section.name);
+      for (auto &sig_sym : sig_section.symbols) {
+        sig_sym.symbol_id = strings.intern(sig_sym.symbol);
+        for (auto &sig_rel : sig_sym.relocations) {
+          sig_rel.name_id = strings.intern(sig_rel.name);
+        }
+      }
+    }
+  }
+
+  return strings;
+}
+
+auto ProcessSignatureFile(std::vector<sig_object> const &sigFile, string_table const &strings, binary_info const &b_info,
+                          const std::set<uint32_t> &m_LikelyFunctionOffsets) -> std::vector<splat_out> {
+  return ProcessSignatureIndex(sigFile, strings, BuildSignatureIndex(sigFile, strings), b_info, m_LikelyFunctionOffsets);
+}
+
+auto ProcessSignatureIndex(std::vector<sig_object> const &sigFile, string_table const &strings, signature_index const &index, binary_info const &b_info,
+                           const std::set<uint32_t> &m_LikelyFunctionOffsets) -> std::vector<splat_out> {
+  auto section_hits = FindSectionHits(index, b_info, m_LikelyFunctionOffsets);
+  auto symbol_hits = FindSymbolHits(index, b_info, m_LikelyFunctionOffsets, MatchedSections(section_hits));
+
+  return GuessSections(sigFile, strings, index, b_info, section_hits, symbol_hits);
+}
+
+auto ProcessSignatureFuzzy(std::vector<sig_object> const &sigFile, string_table const &strings, signature_index const &index, binary_info const &b_info,
+                           const std::set<uint32_t> &m_LikelyFunctionOffsets, uint32_t max_percent) -> std::vector<splat_out> {
+  const auto section_hits = FindSectionHits(index, b_info, m_LikelyFunctionOffsets);
+  const auto matched_sections = MatchedSections(section_hits);
+  auto symbol_hits = FindSymbolHits(index, b_info, m_LikelyFunctionOffsets, matched_sections);
+
+  const auto fuzzy_hits =
+      fuzzy::best(fuzzy::find_hits(index, sigFile, b_info, m_LikelyFunctionOffsets, matched_sections, symbol_hits, max_percent), sigFile, section_hits,
+                  symbol_hits);
+  for (const auto &fuzzy_hit : fuzzy_hits) {
+    const auto &hit = fuzzy_hit.hit;
+    std::println(stderr, "Fuzzy match of {} in {} at 0x{:x}, {} of {} words differ", sigFile[hit.object].sections[hit.section].symbols[hit.symbol].symbol,
+                 sigFile[hit.object].file, hit.rom_offset, fuzzy_hit.mismatches, fuzzy_hit.words);
+    symbol_hits.push_back(hit);
+  }
+
+  return GuessSections(sigFile, strings, index, b_info, section_hits, symbol_hits);
+}
+
+auto ProcessSignatureTrie(std::vector<sig_object> const &sigFile, string_table const &strings, flirt_trie const &trie, binary_info const &b_info,
+                          const std::set<uint32_t> &m_LikelyFunctionOffsets) -> std::vector<splat_out> {
+  const auto [section_hits, symbol_hits] = flirt::find_hits(trie, sigFile, b_info.m_Binary, m_LikelyFunctionOffsets);
+  const signature_index index{.sym_map = SymbolMap(sigFile)};
+
+  return GuessSections(sigFile, strings, index, b_info, section_hits, symbol_hits);
+}
+
+auto ProcessSignatureScan(std::vector<sig_object> const &sigFile, string_table const &strings, keyword_automaton const &automaton, binary_info const &b_info,
+                          std::vector<rom_range> const &ranges, const std::set<uint32_t> &m_LikelyFunctionOffsets) -> std::vector<splat_out> {
+  const auto [section_hits, symbol_hits] = keyword_scan::find_hits(automaton, sigFile, b_info.m_Binary, ranges, m_LikelyFunctionOffsets);
+  const signature_index index{.sym_map = SymbolMap(sigFile)};
+
+  return GuessSections(sigFile, strings, index, b_info, section_hits, symbol_hits);
+}
+
+auto SignatureTarget(std::vector<sig_object> const &sigFile) -> std::optional<target_arch> {
+  if (sigFile.empty()) return target_arch::mips_be;
+  const auto arch = sigFile.front().arch;
+  if (std::ranges::any_of(sigFile, [arch](const sig_object &sig_obj) { return sig_obj.arch != arch; })) return std::nullopt;
+
+  return arch;
+}
+
+auto SymbolMap(std::vector<sig_object> const &sigFile) -> std::unordered_map<string_id, sig_obj_sec_sym> {
+  std::unordered_map<string_id, sig_obj_sec_sym> sym_map;
+  for (const auto &sig_obj : sigFile) {
+    for (const auto &sig_section : sig_obj.sections) {
       for (auto const &sig_sym : sig_section.symbols) {
         // should not be any repeats because of ODR
-        sym_map[sig_sym.symbol] = sig_obj_sec_sym{.symbol_name = sig_sym.symbol,
-                                                  .section_name = sig_section.name,
-                                                  .object_name = sig_obj.file,
-                                                  .symbol_offset = sig_sym.offset,
-                                                  .section_size = sig_section.size};
+        sym_map[sig_sym.symbol_id] = sig_obj_sec_sym{.symbol_name = sig_sym.symbol_id,
+                                                     .section_name = sig_section.name_id,
+                                                     .object_name = sig_obj.file_id,
+                                                     .symbol_offset = sig_sym.offset,
+                                                     .section_size = sig_section.size};
       }
     }
   }
 
-  std::vector<section_guess> results;
-  for (auto const &sig_obj : sigFile) {
-    for (auto const &sig_section : sig_obj.sections) {
-      if (sig_section.name != ".text") continue;
-      for (auto const &sig_sym : sig_section.symbols) {
+  return sym_map;
+}
+
+// whole .text sections are tried first
+// one hit places every symbol of the section, so none of them need to be scanned for
+// sections whose first 8 bytes have no relocation are indexed by crc_8 over the raw rom bytes
+//
+// symbols of sections that did not match whole, for example because of link time differences,
+// are indexed by their anchor window
+// each candidate offset then hashes one window per distinct anchor placement
+// and only runs the full masked compare for symbols whose anchor matched
+//
+// every group is compiled into a scan_table, so the candidate loop reads dense arrays instead of sig_* objects
+auto BuildSignatureIndex(std::vector<sig_object> const &sigFile, string_table const &strings) -> signature_index {
+  const phase_timer timer{stat_phase::index_build};
+  const auto text_id = strings.find(".text");
+
+  uint64_t duplicates = 0;
+  signature_index index{.sym_map = SymbolMap(sigFile), .arch = SignatureTarget(sigFile).value_or(target_arch::mips_be)};
+  std::vector<scan_row> sections;
+  std::vector<scan_row> unindexed_sections;
+  std::map<std::pair<uint64_t, uint64_t>, std::vector<scan_row>> anchors;
+  std::vector<scan_row> unanchored;
+  for (uint32_t object = 0; object < sigFile.size(); object++) {
+    const auto &sig_obj = sigFile[object];
+    for (uint32_t section = 0; section < sig_obj.sections.size(); section++) {
+      const auto &sig_section = sig_obj.sections[section];
+
+      if (sig_section.name_id != text_id) continue;
+
+      if (sig_section.duplicate_crc) duplicates++;
+      if (sig_section.crc_all != 0 && !sig_section.duplicate_crc) {
+        auto prefix_relocated = std::ranges::any_of(sig_section.symbols, [](const sig_symbol &sig_sym) {
+          return std::ranges::any_of(sig_sym.relocations, [&sig_sym](const sig_relocation &rel) { return sig_sym.offset + rel.offset < 8; });
+        });
+        const auto hit = signature_hit{.object = object, .section = section};
+        if (sig_section.size < 8 || prefix_relocated) {
+          unindexed_sections.push_back(scan_tables::section_row(sig_section, 0, hit, sig_obj.arch));
+        } else {
+          sections.push_back(scan_tables::section_row(sig_section, sig_section.crc_8, hit, sig_obj.arch));
+        }
+      }
+
+      for (uint32_t symbol = 0; symbol < sig_section.symbols.size(); symbol++) {
+        const auto &sig_sym = sig_section.symbols[symbol];
         // multiple functions with the same crc can't be distinguished
-        if (sig_sym.duplicate_crc) continue;
-        std::vector<uint32_t> candidates;
-        std::ranges::copy_if(m_LikelyFunctionOffsets, std::back_inserter(candidates),
-                     [&sig_obj, &sig_section, &sig_sym, &b_info](uint32_t rom_offset) {
-                       const std::span<const uint8_t> blah(&b_info.m_Binary[rom_offset], b_info.m_Binary.size() - rom_offset);
-                       return TestSymbol(sig_sym, blah);
-                     });
-        // crc could match random code in game rom
-        // if there are multiple matches, impossible to tell which is legit.
-        // If no results, also done.
-        if (candidates.size() != 1) continue;
-        auto rom_offset = candidates[0];
-        // should have a condition on the offset loop, so finding
-        // result stops search? symbol could theoretically have been linked in more than once
-        auto guesses = TestSignatureSymbol(sig_sym, rom_offset, sig_section, sig_obj, sym_map, b_info);
-        results.insert(results.end(), guesses.begin(), guesses.end());
+        if (sig_sym.duplicate_crc) {
+          duplicates++;
+          continue;
+        }
+        const auto hit = signature_hit{.object = object, .section = section, .symbol = symbol};
+        if (sig_sym.anchor_size == 0) {
+          unanchored.push_back(scan_tables::symbol_row(sig_sym, 0, hit, sig_obj.arch));
+        } else {
+          anchors[{sig_sym.anchor_offset, sig_sym.anchor_size}].push_back(scan_tables::symbol_row(sig_sym, sig_sym.crc_anchor, hit, sig_obj.arch));
+        }
       }
     }
   }
 
-  std::ranges::sort(results, [](section_guess const &a, section_guess const &b) {
-    auto obj_name_cmp = a.object_name <=> b.object_name;
-    if (obj_name_cmp != 0) return obj_name_cmp < 0;
-    auto sec_name_cmp = a.section_name <=> b.section_name;
-    if (sec_name_cmp != 0) return sec_name_cmp < 0;
-    auto rel_cmp = a.rel <=> b.rel;
-    if (rel_cmp != 0) return rel_cmp < 0;
-    auto sig_offset_cmp = a.symbol_offset <=> b.symbol_offset;
-    return sig_offset_cmp < 0;
-  });
+  index.sections = scan_tables::compile(std::move(sections));
+  index.unindexed_sections = scan_tables::compile(std::move(unindexed_sections));
+  for (auto &[placement, rows] : anchors) index.anchors[placement] = scan_tables::compile(std::move(rows));
+  index.unanchored = scan_tables::compile(std::move(unanchored));
+
+  run_stats::add(stat_counter::duplicate_rejections, duplicates);
+  return index;
+}
+
+// rom chunks that are unchanged since the last run keep their hits, only the others are scanned
+// every .text symbol is scanned, not just those of sections that missed whole,
+// so a chunk's hits stay complete whatever other chunks hold
+auto ProcessSignatureFileCached(std::vector<sig_object> const &sigFile, string_table const &strings, signature_index const &index, binary_info const &b_info,
+                                const std::set<uint32_t> &m_LikelyFunctionOffsets, std::filesystem::path const &cache_dir,
+                                std::string const &hits_key) -> std::vector<splat_out> {
+  constexpr auto chunk_size = result_cache::chunk_size;
+
+  std::vector<chunk_hits> cached;
+  if (auto bytes = result_cache::load(cache_dir, hits_key)) cached = chunk_hits_yaml::deserialize(*bytes);
+
+  const auto chunk_count = (b_info.m_Binary.size() + chunk_size - 1) / chunk_size;
+  std::vector<chunk_hits> chunks(chunk_count);
+  std::vector<bool> dirty(chunk_count);
+  for (uint64_t chunk = 0; chunk < chunk_count; chunk++) {
+    const auto start = chunk * chunk_size;
+    chunks[chunk].start = start;
+    const auto key_start = start < result_cache::chunk_lead_in ? 0 : start - result_cache::chunk_lead_in;
+    const auto end = std::min(start + chunk_size, static_cast<uint64_t>(b_info.m_Binary.size()));
+    chunks[chunk].crc = crc32c::Crc32c(&b_info.m_Binary[key_start], end - key_start);
+
+    if (chunk < cached.size() && cached[chunk].start == start && cached[chunk].crc == chunks[chunk].crc) {
+      chunks[chunk].section_hits = std::move(cached[chunk].section_hits);
+      chunks[chunk].symbol_hits = std::move(cached[chunk].symbol_hits);
+    } else {
+      dirty[chunk] = true;
+      // a function starting in the previous chunk can run into this one
+      if (chunk > 0) dirty[chunk - 1] = true;
+    }
+  }
+
+  std::set<uint32_t> dirty_offsets;
+  for (auto rom_offset : m_LikelyFunctionOffsets) {
+    if (dirty[rom_offset / chunk_size]) dirty_offsets.insert(rom_offset);
+  }
+
+  for (uint64_t chunk = 0; chunk < chunk_count; chunk++) {
+    if (dirty[chunk]) {
+      chunks[chunk].section_hits.clear();
+      chunks[chunk].symbol_hits.clear();
+      continue;
+    }
+
+    // functions longer than a chunk can still reach changed bytes
+    std::erase_if(chunks[chunk].section_hits, [&sigFile, &b_info](const signature_hit &hit) {
+      const std::span<const uint8_t> rom_span(&b_info.m_Binary[hit.rom_offset], b_info.m_Binary.size() - hit.rom_offset);
+      return !TestSection(sigFile[hit.object].sections[hit.section], rom_span, sigFile[hit.object].arch);
+    });
+    std::erase_if(chunks[chunk].symbol_hits, [&sigFile, &b_info](const signature_hit &hit) {
+      const std::span<const uint8_t> rom_span(&b_info.m_Binary[hit.rom_offset], b_info.m_Binary.size() - hit.rom_offset);
+      return !TestSymbol(sigFile[hit.object].sections[hit.section].symbols[hit.symbol], rom_span, sigFile[hit.object].arch);
+    });
+  }
+
+  for (const auto &hit : FindSectionHits(index, b_info, dirty_offsets)) chunks[hit.rom_offset / chunk_size].section_hits.push_back(hit);
+  for (const auto &hit : FindSymbolHits(index, b_info, dirty_offsets, {})) chunks[hit.rom_offset / chunk_size].symbol_hits.push_back(hit);
+
+  result_cache::store(cache_dir, hits_key, chunk_hits_yaml::serialize(chunks));
+
+  std::vector<signature_hit> section_hits;
+  std::vector<signature_hit> symbol_hits;
+  for (const auto &chunk : chunks) {
+    section_hits.insert(section_hits.end(), chunk.section_hits.begin(), chunk.section_hits.end());
+    symbol_hits.insert(symbol_hits.end(), chunk.symbol_hits.begin(), chunk.symbol_hits.end());
+  }
+
+  return GuessSections(sigFile, strings, index, b_info, section_hits, symbol_hits);
+}
+
+auto FindSectionHits(signature_index const &index, binary_info const &b_info, const std::set<uint32_t> &m_LikelyFunctionOffsets)
+    -> std::vector<signature_hit> {
+  const phase_timer timer{stat_phase::section_match};
+  uint64_t rejections = 0;
+  uint64_t crc_8_hits = 0;
+  uint64_t checks = 0;
+  trace_batch batch{"section batch"};
+  std::vector<signature_hit> hits;
+  for (auto rom_offset : m_LikelyFunctionOffsets) {
+    batch.next(rom_offset);
+    const std::span<const uint8_t> rom_span(&b_info.m_Binary[rom_offset], b_info.m_Binary.size() - rom_offset);
+
+    auto test = [&rom_span, &hits, &checks, rom_offset](scan_table const &table, uint32_t row) {
+      checks++;
+      if (!table.test(row, rom_span)) return;
+      auto hit = table.hits[row];
+      hit.rom_offset = rom_offset;
+      hits.push_back(hit);
+    };
+
+    if (rom_span.size() >= 8) {
+      const auto key = crc32c::Crc32c(rom_span.data(), 8);
+      if (index.sections.filter.may_contain(key)) {
+        const auto [first, last] = index.sections.equal_range(key);
+        crc_8_hits += last - first;
+        for (auto row = first; row < last; row++) test(index.sections, row);
+      } else {
+        rejections++;
+      }
+    }
+
+    for (uint32_t row = 0; row < index.unindexed_sections.size(); row++) test(index.unindexed_sections, row);
+  }
+
+  run_stats::add(stat_counter::prefilter_rejections, rejections);
+  run_stats::add(stat_counter::crc_8_hits, crc_8_hits);
+  run_stats::add(stat_counter::crc_all_checks, checks);
+  run_stats::add(stat_counter::section_hits, hits.size());
+  return hits;
+}
+
+auto MatchedSections(std::vector<signature_hit> const &section_hits) -> std::set<std::pair<uint32_t, uint32_t>> {
+  std::map<std::pair<uint32_t, uint32_t>, int> counts;
+  for (const auto &hit : section_hits) counts[{hit.object, hit.section}] += 1;
+
+  // same rules as symbols, a section found more than once can't be placed
+  std::set<std::pair<uint32_t, uint32_t>> matched;
+  for (const auto &[section, count] : counts) {
+    if (count == 1) matched.insert(section);
+  }
+
+  return matched;
+}
+
+auto FindSymbolHits(signature_index const &index, binary_info const &b_info, const std::set<uint32_t> &m_LikelyFunctionOffsets,
+                    std::set<std::pair<uint32_t, uint32_t>> const &skip_sections) -> std::vector<signature_hit> {
+  const phase_timer timer{stat_phase::symbol_match};
+  uint64_t rejections = 0;
+  uint64_t anchor_hits = 0;
+  uint64_t checks = 0;
+  trace_batch batch{"symbol batch"};
+  std::vector<signature_hit> hits;
+  for (auto rom_offset : m_LikelyFunctionOffsets) {
+    batch.next(rom_offset);
+    const std::span<const uint8_t> rom_span(&b_info.m_Binary[rom_offset], b_info.m_Binary.size() - rom_offset);
+
+    auto test = [&skip_sections, &rom_span, &hits, &checks, rom_offset](scan_table const &table, uint32_t row) {
+      auto hit = table.hits[row];
+      if (!skip_sections.empty() && skip_sections.contains({hit.object, hit.section})) return;
+      checks++;
+      if (!table.test(row, rom_span)) return;
+      hit.rom_offset = rom_offset;
+      hits.push_back(hit);
+    };
+
+    for (const auto &[placement, table] : index.anchors) {
+      const auto &[anchor_offset, anchor_size] = placement;
+      if (anchor_offset + anchor_size > rom_span.size()) continue;
+
+      const auto key = crc32c::Crc32c(&rom_span[anchor_offset], anchor_size);
+      if (!table.filter.may_contain(key)) {
+        rejections++;
+        continue;
+      }
 
-  const auto [first, last] = std::ranges::unique(results,
-                          [](section_guess const &a, section_guess const &b) { return a.object_name == b.object_name && a.section_name == b.section_name; });
+      const auto [first, last] = table.equal_range(key);
+      anchor_hits += last - first;
+      for (auto row = first; row < last; row++) test(table, row);
+    }
 
-  results.erase(first, last);
+    for (uint32_t row = 0; row < index.unanchored.size(); row++) test(index.unanchored, row);
+  }
 
-  std::ranges::sort(results, [](section_guess const &a, section_guess const &b) { return a.section_offset < b.section_offset; });
+  run_stats::add(stat_counter::prefilter_rejections, rejections);
+  run_stats::add(stat_counter::anchor_hits, anchor_hits);
+  run_stats::add(stat_counter::symbol_checks, checks);
+  run_stats::add(stat_counter::symbol_hits, hits.size());
+  return hits;
+}
 
+auto GuessSections(std::vector<sig_object> const &sigFile, string_table const &strings, signature_index const &index, binary_info const &b_info,
+                   std::vector<signature_hit> const &section_hits, std::vector<signature_hit> const &symbol_hits) -> std::vector<splat_out> {
+  const phase_timer timer{stat_phase::guess_merge};
+  const auto &sym_map = index.sym_map;
+
+  // per hit scratch, released in one go when the guesses are merged
+  std::pmr::monotonic_buffer_resource arena;
+  std::vector<section_guess> results;
+
+  const auto matched_sections = MatchedSections(section_hits);
+  std::set<std::pair<uint32_t, uint32_t>> hit_sections;
+  for (const auto &hit : section_hits) hit_sections.insert({hit.object, hit.section});
+  run_stats::add(stat_counter::ambiguous_rejections, hit_sections.size() - matched_sections.size());
+  for (const auto &hit : section_hits) {
+    if (!matched_sections.contains({hit.object, hit.section})) continue;
+    const auto &sig_obj = sigFile[hit.object];
+    const auto &sig_section = sig_obj.sections[hit.section];
+
+    // symbols are still followed for their relocations, which place .data, .rodata and other objects
+    for (auto const &sig_sym : sig_section.symbols) {
+      auto guesses = TestSignatureSymbol(sig_sym, hit.rom_offset + sig_sym.offset, sig_section, sig_obj, sym_map, b_info, &arena);
+      results.insert(results.end(), guesses.begin(), guesses.end());
+    }
+  }
+
+  std::pmr::map<std::tuple<uint32_t, uint32_t, uint32_t>, std::pmr::vector<uint32_t>> symbol_candidates{&arena};
+  for (const auto &hit : symbol_hits) {
+    // symbols of a section placed whole have already been followed
+    if (matched_sections.contains({hit.object, hit.section})) continue;
+    symbol_candidates[{hit.object, hit.section, hit.symbol}].push_back(hit.rom_offset);
+  }
+
+  for (const auto &[symbol, candidates] : symbol_candidates) {
+    // crc could match random code in game rom
+    // if there are multiple matches, impossible to tell which is legit.
+    // If no results, also done.
+    if (candidates.size() != 1) {
+      run_stats::add(stat_counter::ambiguous_rejections);
+      continue;
+    }
+    const auto &[object, section, symbol_index] = symbol;
+    const auto &sig_obj = sigFile[object];
+    const auto &sig_section = sig_obj.sections[section];
+    // symbol could theoretically have been linked in more than once
+    auto guesses = TestSignatureSymbol(sig_section.symbols[symbol_index], candidates[0], sig_section, sig_obj, sym_map, b_info, &arena);
+    results.insert(results.end(), guesses.begin(), guesses.end());
+  }
+
+  results = AggregateGuesses(results, strings);
+  run_stats::add(stat_counter::confirmed_matches, results.size());
+  if (results.empty()) return {};
+
+  // names are only materialized again for the output
   std::vector<splat_out> blah;
-  // can crash if vector is empty it seems?
   for (auto section_guess = results.begin(); section_guess < results.end() - 1; ++section_guess) {
     auto off_comp = section_guess[0].section_offset + section_guess[0].section_size <=> section_guess[1].section_offset;
     if (off_comp == 0) {
       blah.push_back(splat_out{.start = section_guess[0].section_offset,
                                .vram = section_guess[0].section_vram,
-                               .type = section_guess[0].section_name,
-                               .name = section_guess[0].object_name});
+                               .type = strings[section_guess[0].section_name],
+                               .name = strings[section_guess[0].object_name]});
       // careful, potential issue if NEXT section is omitted due to overlap
       // the endpoint of THIS section is lost
     }
     if (off_comp < 0) {
       blah.push_back(splat_out{.start = section_guess[0].section_offset,
                                .vram = section_guess[0].section_vram,
-                               .type = section_guess[0].section_name,
-                               .name = section_guess[0].object_name});
+                               .type = strings[section_guess[0].section_name],
+                               .name = strings[section_guess[0].object_name]});
       blah.push_back(splat_out{.start = section_guess[0].section_offset + section_guess[0].section_size,
                                .vram = section_guess[0].section_vram + section_guess[0].section_size,
                                .type = "bin",
@@ -256,7 +812,7 @@ auto ProcessSignatureFile(std::vector<sig_object> const &sigFile, binary_info co
 
   auto final = results.back();
 
-  blah.push_back(splat_out{.start = final.section_offset, .vram = final.section_vram, .type = final.section_name, .name = final.object_name});
+  blah.push_back(splat_out{.start = final.section_offset, .vram = final.section_vram, .type = strings[final.section_name], .name = strings[final.object_name]});
   blah.push_back(splat_out{.start = final.section_offset + final.section_size,
                            .vram = final.section_vram + final.section_size,
                            .type = "bin",
@@ -265,84 +821,140 @@ auto ProcessSignatureFile(std::vector<sig_object> const &sigFile, binary_info co
   return blah;
 }
 
+// every guess is a vote for where its section starts
+// the offset with the most votes wins, ties go to the most direct evidence
+auto AggregateGuesses(std::vector<section_guess> const &guesses, string_table const &strings) -> std::vector<section_guess> {
+  using offset_votes = struct offset_votes {
+    uint64_t votes{};
+    section_guess guess{};
+  };
+
+  std::unordered_map<uint64_t, std::vector<offset_votes>> ballots;
+  for (const auto &guess : guesses) {
+    auto &candidates = ballots[static_cast<uint64_t>(guess.object_name) << 32 | guess.section_name];
+    auto candidate = std::ranges::find(candidates, guess.section_offset, [](const offset_votes &votes) { return votes.guess.section_offset; });
+    if (candidate == candidates.end()) {
+      candidates.push_back(offset_votes{.votes = 1, .guess = guess});
+      continue;
+    }
+    candidate->votes += 1;
+    // a symbol matched inside the section says more than a relocation pointing into it
+    if (guess.rel < candidate->guess.rel) candidate->guess = guess;
+  }
+
+  std::vector<section_guess> consensus;
+  consensus.reserve(ballots.size());
+  for (const auto &[key, candidates] : ballots) {
+    auto winner = std::ranges::max_element(candidates, [](const offset_votes &a, const offset_votes &b) {
+      return a.votes < b.votes || (a.votes == b.votes && a.guess.rel > b.guess.rel);
+    });
+
+    if (candidates.size() > 1) {
+      run_stats::add(stat_counter::conflicting_guesses);
+      const auto total = std::ranges::fold_left(candidates, uint64_t{}, [](uint64_t sum, const offset_votes &votes) { return sum + votes.votes; });
+      std::println(stderr, "Conflicting guesses for {} {}, using 0x{:x} with {} of {} votes", strings[winner->guess.object_name],
+                   strings[winner->guess.section_name], winner->guess.section_offset, winner->votes, total);
+      for (const auto &loser : candidates) {
+        if (&loser == &*winner) continue;
+        std::println(stderr, "  rejected 0x{:x} with {} votes", loser.guess.section_offset, loser.votes);
+      }
+    }
+
+    consensus.push_back(winner->guess);
+  }
+
+  std::ranges::sort(consensus, [](section_guess const &a, section_guess const &b) {
+    return std::tie(a.section_offset, a.object_name, a.section_name) < std::tie(b.section_offset, b.object_name, b.section_name);
+  });
+
+  return consensus;
+}
+
 auto TestSignatureSymbol(sig_symbol const &sig_sym, uint32_t rom_offset, sig_section const &sig_sec, sig_object const &sig_obj,
-                         std::unordered_map<std::string, sig_obj_sec_sym> const &sym_map, binary_info const &b_info) -> std::vector<section_guess> {
+                         std::unordered_map<string_id, sig_obj_sec_sym> const &sym_map, binary_info const &b_info,
+                         std::pmr::memory_resource *arena) -> std::pmr::vector<section_guess> {
   using test_t = struct test_t {
+    string_id name{};
+    uint32_t local_addend{};
     uint32_t address{};
-    sig_relocation relocation{};
+    sig_relocation const *relocation{};
     bool local{};
     bool hi16_set{};
     bool lo16_set{};
   };
-  std::map<std::string, test_t> relocMap;
+  // a function references few symbols, a linear search beats building a map per candidate
+  std::pmr::vector<test_t> relocMap{arena};
+  relocMap.reserve(sig_sym.relocations.size());
 
-  std::vector<section_guess> section_guesses;
+  std::pmr::vector<section_guess> section_guesses{arena};
+  section_guesses.reserve(sig_sym.relocations.size() + 1);
 
   // add results from relocations
-  for (const auto &rel : sig_sym.relocations) {
-    uint32_t const opcode = readswap32(std::span<const uint8_t, 4>{&b_info.m_Binary[rom_offset + rel.offset], 4});
-
-    auto relocation_name = rel.name;
-
-    if (rel.local) {
-      const std::filesystem::path fs_path{sig_obj.file};
-      relocation_name = std::format("{}_{}_{:04X}", fs_path.stem().string(), std::string_view{rel.name}.substr(1), rel.addend); 
-      relocMap[relocation_name].local = true;
-    }
+  targets::visit(sig_obj.arch, [&sig_sym, &relocMap, &b_info, rom_offset](auto target) {
+    using target_t = decltype(target);
+    for (const auto &rel : sig_sym.relocations) {
+      uint32_t const opcode = target_t::load(&b_info.m_Binary[rom_offset + rel.offset]);
+
+      // local relocations name their section, so the addend is what tells the referenced symbols apart
+      const auto local_addend = rel.local ? rel.addend : 0;
+      auto entry = std::ranges::find_if(relocMap, [&rel, local_addend](const test_t &test) {
+        return test.name == rel.name_id && test.local == rel.local && test.local_addend == local_addend;
+      });
+      if (entry == relocMap.end()) {
+        entry = relocMap.insert(relocMap.end(), test_t{.name = rel.name_id, .local_addend = local_addend, .local = rel.local});
+      }
 
-    switch (rel.type) {
-      case R_MIPS_HI16:
-        if (!relocMap[relocation_name].hi16_set) {
-          relocMap[relocation_name].address = (opcode & 0x0000FFFF) << 16;
-          relocMap[relocation_name].hi16_set = true;
-          relocMap[relocation_name].relocation = rel;
+      if (target_t::high_half(rel.type)) {
+        if (!entry->hi16_set) {
+          entry->address = (opcode & 0x0000FFFF) << 16;
+          entry->hi16_set = true;
+          entry->relocation = &rel;
         }
-        break;
-      case R_MIPS_LO16:
+      } else if (target_t::low_half(rel.type)) {
         // this is to prevent multiple references to the same symbol
         // from all adding their lo16 to the address
-        if (!relocMap[relocation_name].lo16_set) {
-          relocMap[relocation_name].address += static_cast<int16_t>(opcode & 0x0000FFFF);
-          relocMap[relocation_name].lo16_set = true;
-          relocMap[relocation_name].relocation = rel;
+        if (!entry->lo16_set) {
+          entry->address += static_cast<int16_t>(opcode & 0x0000FFFF);
+          entry->lo16_set = true;
+          entry->relocation = &rel;
         }
-        break;
-      case R_MIPS_26:
-        relocMap[relocation_name].address = (b_info.m_HeaderSize & 0xF0000000) + ((opcode & 0x03FFFFFF) << 2);
-        relocMap[relocation_name].relocation = rel;
-        break;
-      default:
-        break;
+      } else if (auto address = target_t::address(rel.type, opcode, static_cast<uint32_t>(b_info.m_HeaderSize + rom_offset + rel.offset))) {
+        entry->address = *address;
+        entry->relocation = &rel;
+      }
     }
-  }
+  });
 
   // Should I validate the .text ones by checking the sig_sym checksum
   // for the location?
   for (auto &i : relocMap) {
-    if (i.second.local) {
-      auto rel_target_section_name = i.second.relocation.name;
-      auto rel_target_section = std::ranges::find_if(sig_obj.sections, [rel_target_section_name](const sig_section &some_sec_from_obj) {
-        return some_sec_from_obj.name == rel_target_section_name;
+    if (i.relocation == nullptr) continue;
+
+    if (i.local) {
+      auto rel_target_section = std::ranges::find_if(sig_obj.sections, [&i](const sig_section &some_sec_from_obj) {
+        return some_sec_from_obj.name_id == i.relocation->name_id;
       });
+      if (rel_target_section == sig_obj.sections.end()) continue;
+
       auto eee = section_guess{
           .rom_offset = rom_offset,  // name better, rom_offset_searched
           .section_vram =
-              i.second.address - i.second.relocation.addend,  // address from ROM code, minus the addend from reloc, to get to start of local section
-          .symbol_offset = sig_sym.offset,                    // name better, symbol_searched_offset
-          .section_offset = i.second.address - i.second.relocation.addend - b_info.m_HeaderSize,  // need to do calculation based on address
+              i.address - i.relocation->addend,  // address from ROM code, minus the addend from reloc, to get to start of local section
+          .symbol_offset = sig_sym.offset,       // name better, symbol_searched_offset
+          .section_offset = i.address - i.relocation->addend - b_info.m_HeaderSize,  // need to do calculation based on address
           .section_size = rel_target_section->size,
           .rel = rel_info::local_rel,
-          .symbol_name = sig_sym.symbol,             // name better, symbol_name searched
-          .section_name = i.second.relocation.name,  // name is the correct section for LOCAL
-          .object_name = sig_obj.file                // object is correct for LOCAL
+          .symbol_name = sig_sym.symbol_id,          // name better, symbol_name searched
+          .section_name = i.relocation->name_id,     // name is the correct section for LOCAL
+          .object_name = sig_obj.file_id             // object is correct for LOCAL
       };
       section_guesses.push_back(eee);
     } else {
-      if (auto rel_symbol = sym_map.find(i.second.relocation.name); rel_symbol != sym_map.end()) {
+      if (auto rel_symbol = sym_map.find(i.relocation->name_id); rel_symbol != sym_map.end()) {
         auto blah = section_guess{.rom_offset = rom_offset,
-                                  .section_vram = i.second.address - i.second.relocation.addend - rel_symbol->second.symbol_offset,
+                                  .section_vram = i.address - i.relocation->addend - rel_symbol->second.symbol_offset,
                                   .symbol_offset = rel_symbol->second.symbol_offset,
-                                  .section_offset = i.second.address - i.second.relocation.addend - rel_symbol->second.symbol_offset - b_info.m_HeaderSize,
+                                  .section_offset = i.address - i.relocation->addend - rel_symbol->second.symbol_offset - b_info.m_HeaderSize,
                                   .section_size = rel_symbol->second.section_size,
                                   .rel = rel_info::global_rel,
                                   .symbol_name = rel_symbol->second.symbol_name,
@@ -362,9 +974,9 @@ auto TestSignatureSymbol(sig_symbol const &sig_sym, uint32_t rom_offset, sig_sec
                                           .section_offset = rom_offset - sig_sym.offset,
                                           .section_size = sig_sec.size,
                                           .rel = rel_info::not_rel,
-                                          .symbol_name = sig_sym.symbol,
-                                          .section_name = sig_sec.name,
-                                          .object_name = sig_obj.file});
+                                          .symbol_name = sig_sym.symbol_id,
+                                          .section_name = sig_sec.name_id,
+                                          .object_name = sig_obj.file_id});
 
   return section_guesses;
 }
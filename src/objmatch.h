@@ -3,13 +3,26 @@
 #include <array>
 #include <cstdarg>
 #include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <memory_resource>
+#include <optional>
 #include <set>
 #include <span>
+#include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "flirt.h"
+#include "keyword_scan.h"
+#include "rom_range.h"
+#include "scan_table.h"
 #include "signature.h"
+#include "signature_hit.h"
 #include "splat_out.h"
+#include "string_table.h"
+#include "target.h"
 
 using binary_info = struct binary_info {
   std::vector<uint8_t> m_Binary;
@@ -23,13 +36,44 @@ using bin_func_offsets = struct bin_func_offsets {
 };
 
 using sig_obj_sec_sym = struct sig_obj_sec_sym {
-  std::string symbol_name;
-  std::string section_name;
-  std::string object_name;
+  string_id symbol_name{};
+  string_id section_name{};
+  string_id object_name{};
   uint64_t symbol_offset{};
   uint64_t section_size{};
 };
 
+// lookup structures built once per signature file
+// a resident process keeps this between scans
+using signature_index = struct signature_index {
+  // unique .text sections with a relocation free first 8 bytes, keyed by crc_8
+  scan_table sections;
+  scan_table unindexed_sections;
+  // non duplicate .text symbols by (anchor_offset, anchor_size), keyed by crc_anchor
+  std::map<std::pair<uint64_t, uint64_t>, scan_table> anchors;
+  scan_table unanchored;
+  std::unordered_map<string_id, sig_obj_sec_sym> sym_map;
+  // what candidate offsets are scanned for, big endian mips when the signatures mix targets
+  target_arch arch{};
+};
+
+using objmatch_options = struct objmatch_options {
+  // existing splat config, only its bin entries are scanned
+  const char *splat_path{};
+  // explicit windows to scan, intersected with the bin entries when both are given
+  std::vector<rom_range> ranges;
+  // directory for cached results, caching is off when null
+  const char *cache_dir{};
+  // library archive to build signatures from in memory, replaces the .sig
+  const char *archive_path{};
+  // match with a flirt trie, built from the signature patterns when the .sig has none compiled in
+  bool flirt{};
+  // try every word aligned offset instead of only the likely function offsets, needs signature patterns
+  bool exhaustive{};
+  // also accept symbols with up to this percentage of their words changed, 0 matches exactly, needs objsig -W words
+  uint32_t fuzzy_percent{};
+};
+
 enum rel_info : uint8_t { not_rel, local_rel, global_rel };
 
 using section_guess = struct section_guess {
@@ -39,19 +83,96 @@ using section_guess = struct section_guess {
   uint64_t section_offset{};
   uint64_t section_size{};
   rel_info rel{};
-  std::string symbol_name;
-  std::string section_name;
-  std::string object_name;
+  string_id symbol_name{};
+  string_id section_name{};
+  string_id object_name{};
 };
 
+// what a rom file holds, decides how its header size is found
+enum class rom_kind : uint8_t { raw, z64, n64, v64, gba, nds };
+
+// from the file extension, raw for anything unknown
+auto RomKind(const std::filesystem::path &path) -> rom_kind;
+auto LoadBinary(const char *binPath) -> binary_info;
+// n64 kinds byteswap .n64/.v64 layouts to big endian and read the header size from the ipl3
+// .gba and .nds roms get the address their code runs at as header size, raw ones 0
+auto LoadBinary(std::vector<uint8_t> bytes, rom_kind kind) -> binary_info;
+
 auto ReadStrippedWord(const std::span<const uint8_t, 4> &src, uint64_t relType) -> std::array<uint8_t, 4>;
 
-auto TestSymbol(sig_symbol const &symbol, const std::span<const uint8_t> &buffer) -> bool;
+// arch is that of the signature's object, it picks how relocations are masked
+auto TestSymbol(sig_symbol const &symbol, const std::span<const uint8_t> &buffer, target_arch arch = target_arch::mips_be) -> bool;
+
+auto TestSection(sig_section const &section, const std::span<const uint8_t> &buffer, target_arch arch = target_arch::mips_be) -> bool;
+
+// bin entries of a splat config, merged where they touch
+auto UnresolvedRanges(std::vector<splat_out> const &splat, uint64_t rom_size) -> std::vector<rom_range>;
+
+auto IntersectRanges(std::vector<rom_range> const &a, std::vector<rom_range> const &b) -> std::vector<rom_range>;
+
+// ranges left to scan after applying the splat config and explicit ranges of the options
+// empty means the whole binary, nullopt means nothing is left
+auto ResolveRanges(binary_info const &b_info, objmatch_options const &options) -> std::optional<std::vector<rom_range>>;
+
+// candidate function starts, found by the prologues and returns of arch, an empty range list scans the whole binary
+auto LikelyFunctionOffsets(binary_info const &b_info, std::vector<rom_range> const &ranges, target_arch arch = target_arch::mips_be)
+    -> std::set<uint32_t>;
+
+auto ObjMatchBloop(const char *binPath, const char *libPath, objmatch_options const &options) -> bool;
+
+// loads libPath (.sig or .a) once and answers scan_requests on socketPath until accept fails
+auto ObjMatchServe(const char *socketPath, const char *libPath) -> bool;
+
+// fills the name ids of the signatures, the table is needed again to output names
+auto InternSignatures(std::vector<sig_object> &sigFile) -> string_table;
+
+// the target every object was built for, nullopt when they differ
+auto SignatureTarget(std::vector<sig_object> const &sigFile) -> std::optional<target_arch>;
+
+// symbol name to where it is defined, for following relocations
+auto SymbolMap(std::vector<sig_object> const &sigFile) -> std::unordered_map<string_id, sig_obj_sec_sym>;
+
+auto BuildSignatureIndex(std::vector<sig_object> const &sigFile, string_table const &strings) -> signature_index;
+
+auto ProcessSignatureFile(std::vector<sig_object> const &sigFile, string_table const &strings, binary_info const &b_info,
+                          const std::set<uint32_t> &m_LikelyFunctionOffsets) -> std::vector<splat_out>;
+
+auto ProcessSignatureIndex(std::vector<sig_object> const &sigFile, string_table const &strings, signature_index const &index, binary_info const &b_info,
+                           const std::set<uint32_t> &m_LikelyFunctionOffsets) -> std::vector<splat_out>;
+
+// same result as ProcessSignatureIndex, one walk of the flirt trie per candidate instead of the index lookups
+auto ProcessSignatureTrie(std::vector<sig_object> const &sigFile, string_table const &strings, flirt_trie const &trie, binary_info const &b_info,
+                          const std::set<uint32_t> &m_LikelyFunctionOffsets) -> std::vector<splat_out>;
+
+// same as ProcessSignatureIndex at the likely function offsets, also finds signatures at every other word aligned offset of ranges
+auto ProcessSignatureScan(std::vector<sig_object> const &sigFile, string_table const &strings, keyword_automaton const &automaton, binary_info const &b_info,
+                          std::vector<rom_range> const &ranges, const std::set<uint32_t> &m_LikelyFunctionOffsets) -> std::vector<splat_out>;
+
+// ProcessSignatureIndex, plus the best fuzzy hit of each region left over, which are reported on stderr
+auto ProcessSignatureFuzzy(std::vector<sig_object> const &sigFile, string_table const &strings, signature_index const &index, binary_info const &b_info,
+                           const std::set<uint32_t> &m_LikelyFunctionOffsets, uint32_t max_percent) -> std::vector<splat_out>;
+
+// same result as ProcessSignatureFile, reusing the hits of rom chunks that have not changed since the last run
+auto ProcessSignatureFileCached(std::vector<sig_object> const &sigFile, string_table const &strings, signature_index const &index, binary_info const &b_info,
+                                const std::set<uint32_t> &m_LikelyFunctionOffsets, std::filesystem::path const &cache_dir,
+                                std::string const &hits_key) -> std::vector<splat_out>;
+
+auto FindSectionHits(signature_index const &index, binary_info const &b_info, const std::set<uint32_t> &m_LikelyFunctionOffsets)
+    -> std::vector<signature_hit>;
+
+// (object, section) of every section hit exactly once
+auto MatchedSections(std::vector<signature_hit> const &section_hits) -> std::set<std::pair<uint32_t, uint32_t>>;
+
+auto FindSymbolHits(signature_index const &index, binary_info const &b_info, const std::set<uint32_t> &m_LikelyFunctionOffsets,
+                    std::set<std::pair<uint32_t, uint32_t>> const &skip_sections) -> std::vector<signature_hit>;
 
-auto ObjMatchBloop(const char *binPath, const char *libPath) -> bool;
+// turns hits into splat entries, hits may be unfiltered and in any order
+auto GuessSections(std::vector<sig_object> const &sigFile, string_table const &strings, signature_index const &index, binary_info const &b_info,
+                   std::vector<signature_hit> const &section_hits, std::vector<signature_hit> const &symbol_hits) -> std::vector<splat_out>;
 
-auto ProcessSignatureFile(std::vector<sig_object> const &sigFile, binary_info const &b_info, const std::set<uint32_t> &m_LikelyFunctionOffsets)
-    -> std::vector<splat_out>;
+auto AggregateGuesses(std::vector<section_guess> const &guesses, string_table const &strings) -> std::vector<section_guess>;
 
+// guesses and scratch live in arena, pass a scan scoped monotonic resource so hits don't each hit the heap
 auto TestSignatureSymbol(sig_symbol const &sig_sym, uint32_t rom_offset, sig_section const &sig_sec, sig_object const &sig_obj,
-                         std::unordered_map<std::string, sig_obj_sec_sym> const &sym_map, binary_info const &b_info) -> std::vector<section_guess>;
+                         std::unordered_map<string_id, sig_obj_sec_sym> const &sym_map, binary_info const &b_info,
+                         std::pmr::memory_resource *arena = std::pmr::get_default_resource()) -> std::pmr::vector<section_guess>;
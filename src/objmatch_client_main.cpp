@@ -0,0 +1,78 @@
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <print>
+#include <span>
+#include <string_view>
+
+#include "serve_protocol.h"
+
+auto main(int argc, const char* argv[]) -> int {
+  const std::span<const char *> args = {argv, static_cast<size_t>(argc)};
+
+  if (argc < 3) {
+    std::print(
+        "objmatch_client - scan a binary with a running objmatch -s\n\n"
+        "  Usage: objmatch_client <socket path> <binary path> [options]\n\n"
+        "  Options:\n"
+        "    -y <splat path>    only scan the bin entries of an existing splat yaml\n"
+        "    -r <start:end>     only scan rom offsets in [start, end), may be repeated\n");
+
+    return EXIT_FAILURE;
+  }
+
+  // the server may run in another directory
+  scan_request request{.rom_path = std::filesystem::absolute(args[2]).string()};
+  for (int argi = 3; argi < argc; argi++) {
+    const std::string_view option{args[argi]};
+    if (option != "-y" && option != "-r") {
+      std::println("Error: Invalid switch '{}'", option);
+      return EXIT_FAILURE;
+    }
+    if (argi + 1 >= argc) {
+      std::println("Error: No value specified for '{}'", option);
+      return EXIT_FAILURE;
+    }
+
+    if (option == "-y") {
+      request.splat_path = std::filesystem::absolute(args[argi + 1]).string();
+    } else {
+      const auto range = ParseRange(args[argi + 1]);
+      if (!range) {
+        std::println("Error: Range '{}' is not start:end", args[argi + 1]);
+        return EXIT_FAILURE;
+      }
+      request.ranges.push_back(*range);
+    }
+    argi++;
+  }
+
+  const int fd = serve_protocol::connect_socket(args[1]);
+  if (fd < 0) {
+    std::println(stderr, "Error: Could not connect to '{}': {}", args[1], std::strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  const auto response = serve_protocol::write_frame(fd, frame_status::ok, scan_request_yaml::serialize(request))
+                            ? serve_protocol::read_frame(fd)
+                            : std::nullopt;
+  ::close(fd);
+
+  if (!response) {
+    std::println(stderr, "Error: No response from '{}'", args[1]);
+    return EXIT_FAILURE;
+  }
+
+  const std::string_view payload{response->second.data(), response->second.size()};
+  if (response->first == frame_status::error) {
+    std::println(stderr, "Error: {}", payload);
+    return EXIT_FAILURE;
+  }
+
+  if (!payload.empty()) std::println("{}", payload);
+  return EXIT_SUCCESS;
+}
@@ -1,30 +1,53 @@
 #include <cstring>
 
+#include <charconv>
 #include <cstdio>
 #include <cstdlib>
+#include <optional>
 #include <print>
+#include <string_view>
 
+#include "kernels.h"
 #include "objmatch.h"
+#include "run_stats.h"
+#include "trace.h"
 
 auto main(int argc, const char* argv[]) -> int {
-  const std::span<const char *> args = {argv, 3};
+  const std::span<const char *> args = {argv, static_cast<size_t>(argc)};
   const char* binPath = nullptr;
 
   if (argc < 2) {
     std::print(
         "objmatch - Library object file section finder ()\n\n"
-        "  Usage: objmatch <binary path> [options]\n\n"
+        "  Usage: objmatch <binary path> [options]\n"
+        "         objmatch -s <socket path> -l <sig path> | -a <lib path>\n\n"
         "  Options:\n"
         "    -l <sig path>      scan for symbols from signature file(s)\n"
+        "    -a <lib path>      scan for symbols from a library archive, without a .sig\n"
+        "    -y <splat path>    only scan the bin entries of an existing splat yaml\n"
+        "    -r <start:end>     only scan rom offsets in [start, end), may be repeated\n"
+        "    -c <cache dir>     reuse results of earlier runs, rescanning only changed rom chunks\n"
+        "    -t <text|json>     print phase times, match and hardware counters to stderr\n"
+        "    -T <trace path>    write a chrome trace event json of the run\n"
+        "    -s <socket path>   keep the signatures loaded and serve scans from objmatch_client\n"
+        "    -k <kernel>        baseline, sse4.2, avx2 or avx512 instead of the widest the cpu supports\n"
+        "    -F                 match with a flirt trie built from the signature patterns\n"
+        "    -e                 try every word aligned offset, not only likely function starts\n"
+        "    -z <percent>       also match symbols with up to this share of words changed, needs objsig -W\n"
         "    -h <headersize>            set the headersize (default: 0x80000000)\n");
 
     return EXIT_FAILURE;
   }
 
-  binPath = args[1];
+  // serve mode takes no binary, the clients send one per scan
+  const int first_option = args[1][0] == '-' ? 1 : 2;
+  if (first_option == 2) binPath = args[1];
 
   const char * libPath = "";
-  for (int argi = 2; argi < argc; argi++) {
+  const char * socketPath = nullptr;
+  std::optional<stats_format> stats;
+  objmatch_options options{};
+  for (int argi = first_option; argi < argc; argi++) {
     if (args[argi][0] != '-') {
       std::println("Error: Unexpected '{}' in command line", args[argi]);
       return EXIT_FAILURE;
@@ -43,6 +66,111 @@ auto main(int argc, const char* argv[]) -> int {
         libPath = args[argi + 1];
         argi++;
         break;
+      case 'a':
+        if (argi + 1 >= argc) {
+          std::println("Error: No path specified for '-a'");
+          return EXIT_FAILURE;
+        }
+        options.archive_path = args[argi + 1];
+        argi++;
+        break;
+      case 'y':
+        if (argi + 1 >= argc) {
+          std::println("Error: No path specified for '-y'");
+          return EXIT_FAILURE;
+        }
+        options.splat_path = args[argi + 1];
+        argi++;
+        break;
+      case 'c':
+        if (argi + 1 >= argc) {
+          std::println("Error: No path specified for '-c'");
+          return EXIT_FAILURE;
+        }
+        options.cache_dir = args[argi + 1];
+        argi++;
+        break;
+      case 'r': {
+        if (argi + 1 >= argc) {
+          std::println("Error: No range specified for '-r'");
+          return EXIT_FAILURE;
+        }
+        const auto range = ParseRange(args[argi + 1]);
+        if (!range) {
+          std::println("Error: Range '{}' is not start:end", args[argi + 1]);
+          return EXIT_FAILURE;
+        }
+        options.ranges.push_back(*range);
+        argi++;
+        break;
+      }
+      case 's':
+        if (argi + 1 >= argc) {
+          std::println("Error: No path specified for '-s'");
+          return EXIT_FAILURE;
+        }
+        socketPath = args[argi + 1];
+        argi++;
+        break;
+      case 't': {
+        if (argi + 1 >= argc) {
+          std::println("Error: No format specified for '-t'");
+          return EXIT_FAILURE;
+        }
+        stats = run_stats::parse_format(args[argi + 1]);
+        if (!stats) {
+          std::println("Error: Stats format '{}' is not text or json", args[argi + 1]);
+          return EXIT_FAILURE;
+        }
+        perf_counters::enable();
+        argi++;
+        break;
+      }
+      case 'T':
+        if (argi + 1 >= argc) {
+          std::println("Error: No path specified for '-T'");
+          return EXIT_FAILURE;
+        }
+        trace::start(args[argi + 1]);
+        argi++;
+        break;
+      case 'k': {
+        if (argi + 1 >= argc) {
+          std::println("Error: No kernel specified for '-k'");
+          return EXIT_FAILURE;
+        }
+        const auto isa = kernels::parse(args[argi + 1]);
+        if (!isa) {
+          std::println("Error: Kernel '{}' is not baseline, sse4.2, avx2 or avx512", args[argi + 1]);
+          return EXIT_FAILURE;
+        }
+        if (!kernels::select(*isa)) {
+          std::println("Error: This cpu does not support the {} kernels", args[argi + 1]);
+          return EXIT_FAILURE;
+        }
+        argi++;
+        break;
+      }
+      case 'F':
+        options.flirt = true;
+        break;
+      case 'e':
+        options.exhaustive = true;
+        break;
+      case 'z': {
+        if (argi + 1 >= argc) {
+          std::println("Error: No percentage specified for '-z'");
+          return EXIT_FAILURE;
+        }
+        const std::string_view percent{args[argi + 1]};
+        const auto [end, error] = std::from_chars(percent.data(), percent.data() + percent.size(), options.fuzzy_percent);
+        if (error != std::errc{} || end != percent.data() + percent.size() || options.fuzzy_percent > 100) {
+          std::println("Error: Fuzzy threshold '{}' is not a percentage", args[argi + 1]);
+          return EXIT_FAILURE;
+        }
+        argi++;
+        break;
+      }
       case 'h':
         if (argi + 1 >= argc) {
           std::println("Error: No header size specified for '-h'");
@@ -56,9 +184,35 @@ auto main(int argc, const char* argv[]) -> int {
     }
   }
 
-  if (!ObjMatchBloop(binPath, libPath)) {
+  if (options.archive_path != nullptr && *libPath != '\0') {
+    std::println("Error: '-l' and '-a' can not be combined");
+    return EXIT_FAILURE;
+  }
+
+  if (socketPath != nullptr) {
+    if (binPath != nullptr || options.splat_path != nullptr || !options.ranges.empty() || options.cache_dir != nullptr) {
+      std::println("Error: '-s' only takes '-l' or '-a', scan options are sent by the client");
+      return EXIT_FAILURE;
+    }
+    // the server has no clean shutdown, nothing would report the stats or write the trace
+    if (options.flirt || options.exhaustive || options.fuzzy_percent != 0 || stats || trace::enabled()) {
+      std::println("Error: '-F', '-e', '-z', '-t' and '-T' are not supported with '-s'");
+      return EXIT_FAILURE;
+    }
+    return ObjMatchServe(socketPath, options.archive_path != nullptr ? options.archive_path : libPath) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (binPath == nullptr) {
+    std::println("Error: No binary path specified");
+    return EXIT_FAILURE;
+  }
+
+  const bool ok = ObjMatchBloop(binPath, libPath, options);
+  if (stats) std::print(stderr, "{}", run_stats::report(*stats));
+  if (!trace::finish()) {
+    std::println("Error: Could not write the trace");
     return EXIT_FAILURE;
   }
 
-  return EXIT_SUCCESS;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,109 @@
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "objmatch.h"
+#include "objsig.h"
+#include "serve_protocol.h"
+
+namespace {
+// clients are served one at a time, one that stalls mid frame is dropped instead of holding up the rest
+constexpr timeval client_timeout{.tv_sec = 30, .tv_usec = 0};
+
+// consecutive scans of the same rom skip reading and byteswapping it again
+using loaded_rom = struct loaded_rom {
+  std::string path;
+  std::filesystem::file_time_type mtime;
+  uintmax_t size{};
+  binary_info b_info;
+};
+
+auto LoadBinaryCached(loaded_rom &last, const std::string &path) -> binary_info const & {
+  const auto mtime = std::filesystem::last_write_time(path);
+  const auto size = std::filesystem::file_size(path);
+  if (last.path != path || last.mtime != mtime || last.size != size) {
+    last = loaded_rom{.path = path, .mtime = mtime, .size = size, .b_info = LoadBinary(path.c_str())};
+  }
+
+  return last.b_info;
+}
+
+auto ServeScan(std::vector<sig_object> const &sigs, string_table const &strings, signature_index const &index, loaded_rom &last,
+               scan_request const &request) -> std::vector<char> {
+  const auto &b_info = LoadBinaryCached(last, request.rom_path);
+  if (b_info.m_Binary.empty()) throw std::runtime_error{std::format("'{}' is empty", request.rom_path)};
+
+  const objmatch_options options{.splat_path = request.splat_path.empty() ? nullptr : request.splat_path.c_str(), .ranges = request.ranges};
+  const auto resolved = ResolveRanges(b_info, options);
+  // everything is already identified
+  if (!resolved) return {};
+
+  const auto offsets = LikelyFunctionOffsets(b_info, *resolved, index.arch);
+  return splat_yaml::serialize(ProcessSignatureIndex(sigs, strings, index, b_info, offsets));
+}
+}  // namespace
+
+auto ObjMatchServe(const char *socketPath, const char *libPath) -> bool {
+  const std::filesystem::path fs_path{libPath};
+  if (fs_path.extension() != ".sig" && fs_path.extension() != ".a") {
+    std::println(stderr, "Error: '{}' is not a .sig file or archive", libPath);
+    return false;
+  }
+
+  std::ifstream file{fs_path, std::ios::binary};
+  std::vector<char> lib_data(std::filesystem::file_size(fs_path));
+  file.read(lib_data.data(), static_cast<std::streamsize>(lib_data.size()));
+
+  // parsed, interned and indexed once, every request reuses them
+  sig_arena arena;
+  auto sigs = fs_path.extension() == ".a" ? ProcessLibrary(std::span{lib_data}, &arena) : sig_yaml::deserialize(lib_data, &arena);
+  const auto strings = InternSignatures(sigs);
+  const auto index = BuildSignatureIndex(sigs, strings);
+
+  const int listen_fd = serve_protocol::listen_socket(socketPath);
+  if (listen_fd < 0) {
+    std::println(stderr, "Error: Could not listen on '{}': {}", socketPath, std::strerror(errno));
+    return false;
+  }
+  std::println(stderr, "objmatch: serving {} objects on {}", sigs.size(), socketPath);
+
+  loaded_rom last;
+  // scans share func_buf and the last rom, so clients are served one at a time
+  for (;;) {
+    const int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      std::println(stderr, "Error: accept failed: {}", std::strerror(errno));
+      break;
+    }
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &client_timeout, sizeof(client_timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &client_timeout, sizeof(client_timeout));
+
+    if (auto frame = serve_protocol::read_frame(fd)) {
+      try {
+        const auto request = scan_request_yaml::deserialize(frame->second);
+        serve_protocol::write_frame(fd, frame_status::ok, ServeScan(sigs, strings, index, last, request));
+      } catch (const std::exception &e) {
+        // a bad request should not take the warm index down with it
+        last = {};
+        serve_protocol::write_frame(fd, frame_status::error, std::string_view{e.what()});
+      }
+    }
+    ::close(fd);
+  }
+
+  ::close(listen_fd);
+  ::unlink(socketPath);
+  return false;
+}
@@ -0,0 +1,528 @@
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <crc32c/crc32c.h>
+#include <filesystem>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "flirt.h"
+#include "fuzzy.h"
+#include "hash64.h"
+#include "kernels.h"
+#include "keyword_scan.h"
+#include "objmatch.h"
+#include "prefilter.h"
+#include "result_cache.h"
+#include "rom_range.h"
+#include "scan_table.h"
+#include "string_table.h"
+#include "synth.h"
+
+TEST_CASE("AggregateGuesses picks the offset with the most votes", "[objmatch]") {
+  string_table strings;
+  auto object = strings.intern("example.o");
+  auto text = strings.intern(".text");
+
+  std::vector<section_guess> guesses{
+      section_guess{.section_offset = 0x100, .section_size = 0x20, .rel = rel_info::global_rel, .section_name = text, .object_name = object},
+      section_guess{.section_offset = 0x200, .section_size = 0x20, .rel = rel_info::global_rel, .section_name = text, .object_name = object},
+      section_guess{.section_offset = 0x200, .section_size = 0x20, .rel = rel_info::not_rel, .section_name = text, .object_name = object},
+  };
+
+  auto result = AggregateGuesses(guesses, strings);
+
+  REQUIRE(result.size() == 1);
+  REQUIRE(result[0].section_offset == 0x200);
+  REQUIRE(result[0].rel == rel_info::not_rel);
+}
+
+TEST_CASE("AggregateGuesses keeps one guess per section in offset order", "[objmatch]") {
+  string_table strings;
+  auto object = strings.intern("example.o");
+  auto text = strings.intern(".text");
+  auto data = strings.intern(".data");
+
+  std::vector<section_guess> guesses{
+      section_guess{.section_offset = 0x300, .section_size = 0x10, .rel = rel_info::local_rel, .section_name = data, .object_name = object},
+      section_guess{.section_offset = 0x100, .section_size = 0x20, .rel = rel_info::not_rel, .section_name = text, .object_name = object},
+      section_guess{.section_offset = 0x100, .section_size = 0x20, .rel = rel_info::not_rel, .section_name = text, .object_name = object},
+  };
+
+  auto result = AggregateGuesses(guesses, strings);
+
+  REQUIRE(result.size() == 2);
+  REQUIRE(result[0].section_name == text);
+  REQUIRE(result[1].section_name == data);
+}
+
+TEST_CASE("ProcessSignatureFile with no signatures", "[objmatch]") {
+  std::vector<sig_object> sigs;
+  auto strings = InternSignatures(sigs);
+
+  auto result = ProcessSignatureFile(sigs, strings, binary_info{}, {});
+
+  REQUIRE(result.empty());
+}
+
+TEST_CASE("UnresolvedRanges merges touching bin entries", "[objmatch]") {
+  std::vector<splat_out> splat{
+      splat_out{.start = 0x0, .vram = 0x80000000, .type = "bin", .name = "header"},
+      splat_out{.start = 0x1000, .vram = 0x80001000, .type = ".text", .name = "sched.o"},
+      splat_out{.start = 0x1400, .vram = 0x80001400, .type = "bin", .name = "0x1400"},
+      splat_out{.start = 0x1800, .vram = 0x80001800, .type = "bin", .name = "0x1800"},
+      splat_out{.start = 0x2000, .vram = 0x80002000, .type = ".text", .name = "env.o"},
+  };
+
+  auto result = UnresolvedRanges(splat, 0x4000);
+
+  std::vector<rom_range> expect{rom_range{.start = 0x0, .end = 0x1000}, rom_range{.start = 0x1400, .end = 0x2000}};
+
+  REQUIRE(result == expect);
+}
+
+TEST_CASE("IntersectRanges narrows bin ranges to explicit windows", "[objmatch]") {
+  std::vector<rom_range> bins{rom_range{.start = 0x0, .end = 0x1000}, rom_range{.start = 0x1400, .end = 0x2000}};
+  std::vector<rom_range> windows{rom_range{.start = 0x800, .end = 0x1800}};
+
+  auto result = IntersectRanges(bins, windows);
+
+  std::vector<rom_range> expect{rom_range{.start = 0x800, .end = 0x1000}, rom_range{.start = 0x1400, .end = 0x1800}};
+
+  REQUIRE(result == expect);
+}
+
+TEST_CASE("ParseRange accepts hex and rejects malformed ranges", "[objmatch]") {
+  REQUIRE(ParseRange("0x1000:4096") == rom_range{.start = 0x1000, .end = 0x1000});
+  REQUIRE_FALSE(ParseRange("0x1000"));
+  REQUIRE_FALSE(ParseRange("0x2000:0x1000"));
+  REQUIRE_FALSE(ParseRange("0x1000:zz"));
+  REQUIRE_FALSE(ParseRange("-1:0x1000"));
+  REQUIRE_FALSE(ParseRange("0: 0x1000"));
+}
+
+TEST_CASE("LoadBinary derives gba and nds load addresses from memory", "[objmatch]") {
+  REQUIRE(RomKind("game.gba") == rom_kind::gba);
+  REQUIRE(RomKind("game.nds") == rom_kind::nds);
+  REQUIRE(RomKind("game.bin") == rom_kind::raw);
+
+  REQUIRE(LoadBinary(std::vector<uint8_t>(0x100), rom_kind::gba).m_HeaderSize == 0x08000000);
+
+  // arm9 code at rom offset 0x4000 runs at 0x02000000
+  std::vector<uint8_t> nds(0x200);
+  nds[0x21] = 0x40;
+  nds[0x2B] = 0x02;
+  REQUIRE(LoadBinary(std::vector<uint8_t>{nds}, rom_kind::nds).m_HeaderSize == 0x02000000 - 0x4000);
+  REQUIRE(LoadBinary(std::move(nds), rom_kind::raw).m_HeaderSize == 0);
+}
+
+TEST_CASE("ProcessSignatureFile finds the objects planted in a synthetic rom", "[objmatch]") {
+  const auto planted = synth::planted_case(synth_options{.objects = 16, .functions_per_object = 4}, 0x40000);
+  REQUIRE(planted.sigs.size() == planted.library.size());
+
+  const auto result = ProcessSignatureFile(planted.sigs, planted.strings, planted.b_info, planted.offsets);
+
+  for (const auto &placement : planted.rom.placements) {
+    REQUIRE(std::ranges::contains(result, placement.text_start, &splat_out::start));
+  }
+}
+
+TEST_CASE("cached chunks are rescanned when the word before them changes", "[objmatch]") {
+  // a leaf function with no stack frame, only found past the jr ra of the function before it
+  const std::vector<uint8_t> leaf{0x3C, 0x01, 0x80, 0x10, 0x24, 0x21, 0x12, 0x34, 0x03, 0xE0, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00};
+  sig_section text{.size = leaf.size(),
+                   .crc_8 = crc32c::Crc32c(leaf.data(), 8),
+                   .crc_all = crc32c::Crc32c(leaf.data(), leaf.size()),
+                   .name = ".text",
+                   .symbols = {sig_symbol{.offset = 0, .size = leaf.size(), .symbol = "leaf"}}};
+  text.symbols[0].crc_8 = text.crc_8;
+  text.symbols[0].crc_all = text.crc_all;
+  std::vector<sig_object> sigs{sig_object{.file = "leaf.o", .sections = {text}}};
+  const auto strings = InternSignatures(sigs);
+  const auto index = BuildSignatureIndex(sigs, strings);
+
+  // the leaf starts one word into the second chunk, the delay slot of the jr ra before it is the chunk's first word
+  const auto leaf_start = result_cache::chunk_size + 4;
+  std::vector<uint8_t> rom(2 * result_cache::chunk_size);
+  std::ranges::copy(leaf, rom.begin() + static_cast<std::ptrdiff_t>(leaf_start));
+
+  const auto cache_dir = std::filesystem::temp_directory_path() / "objmatch_chunk_lead_in_test";
+  std::filesystem::remove_all(cache_dir);
+  const std::string hits_key{"hits"};
+  auto scan = [&sigs, &strings, &index, &cache_dir, &hits_key](std::vector<uint8_t> const &bytes) {
+    const auto b_info = LoadBinary(std::vector<uint8_t>{bytes}, rom_kind::raw);
+    ProcessSignatureFileCached(sigs, strings, index, b_info, LikelyFunctionOffsets(b_info, {}), cache_dir, hits_key);
+    auto cached = result_cache::load(cache_dir, hits_key);
+    REQUIRE(cached);
+    return chunk_hits_yaml::deserialize(*cached);
+  };
+
+  REQUIRE(scan(rom)[1].section_hits.empty());
+
+  // only the last word of the first chunk changes, to a jr ra
+  std::ranges::copy(std::array<uint8_t, 4>{0x03, 0xE0, 0x00, 0x08}, rom.begin() + static_cast<std::ptrdiff_t>(result_cache::chunk_size - 4));
+  const auto chunks = scan(rom);
+  REQUIRE(std::ranges::contains(chunks[1].section_hits, static_cast<uint32_t>(leaf_start), &signature_hit::rom_offset));
+
+  std::filesystem::remove_all(cache_dir);
+}
+
+TEST_CASE("scan_table rows find the same bytes as TestSymbol", "[objmatch]") {
+  // jal with an R_MIPS_26 relocation, then lui/addiu with HI16/LO16 against the same word pair
+  const std::vector<uint8_t> rom{0x27, 0xBD, 0xFF, 0xE0, 0x0C, 0x12, 0x34, 0x56, 0x00, 0x00, 0x00, 0x00,
+                                 0x3C, 0x01, 0x80, 0x10, 0x24, 0x21, 0x12, 0x34, 0x03, 0xE0, 0x00, 0x08};
+  sig_symbol symbol{.offset = 0, .size = rom.size(), .symbol = "f"};
+  symbol.relocations = {sig_relocation{.type = 4, .offset = 4}, sig_relocation{.type = 5, .offset = 12}, sig_relocation{.type = 6, .offset = 16}};
+
+  // what objsig would have hashed, the relocated fields zeroed
+  std::vector<uint8_t> masked = rom;
+  masked[4] &= 0xFC;
+  masked[5] = masked[6] = masked[7] = 0;
+  masked[14] = masked[15] = masked[18] = masked[19] = 0;
+  symbol.crc_8 = crc32c::Crc32c(masked.data(), 8);
+  symbol.crc_all = crc32c::Crc32c(masked.data(), masked.size());
+
+  auto table = scan_tables::compile({scan_tables::symbol_row(symbol, 7, signature_hit{.symbol = 1}),
+                                     scan_tables::symbol_row(symbol, 3, signature_hit{.symbol = 0})});
+
+  REQUIRE(table.keys == std::vector<uint32_t>{3, 7});
+  REQUIRE(table.equal_range(7) == std::pair<uint32_t, uint32_t>{1, 2});
+  REQUIRE(table.equal_range(5).first == table.equal_range(5).second);
+
+  auto relinked = rom;
+  relinked[7] = 0x99;
+  relinked[15] = 0x20;
+  REQUIRE(TestSymbol(symbol, relinked));
+  REQUIRE(table.test(1, relinked));
+
+  auto changed = rom;
+  changed[1] = 0xA0;
+  REQUIRE_FALSE(TestSymbol(symbol, changed));
+  REQUIRE_FALSE(table.test(1, changed));
+  REQUIRE_FALSE(table.test(1, std::span{rom}.first(20)));
+}
+
+TEST_CASE("little endian mips signatures are masked and found through their target", "[objmatch]") {
+  // the scan_table test's function, each word stored little endian as on the ps1 and ps2
+  std::vector<uint8_t> rom{0x27, 0xBD, 0xFF, 0xE0, 0x0C, 0x12, 0x34, 0x56, 0x00, 0x00, 0x00, 0x00,
+                           0x3C, 0x01, 0x80, 0x10, 0x24, 0x21, 0x12, 0x34, 0x03, 0xE0, 0x00, 0x08};
+  std::vector<uint8_t> masked = rom;
+  masked[4] &= 0xFC;
+  masked[5] = masked[6] = masked[7] = 0;
+  masked[14] = masked[15] = masked[18] = masked[19] = 0;
+  for (size_t word = 0; word < rom.size(); word += 4) {
+    std::ranges::reverse(std::span{rom}.subspan(word, 4));
+    std::ranges::reverse(std::span{masked}.subspan(word, 4));
+  }
+
+  sig_symbol symbol{.offset = 0, .size = rom.size(), .symbol = "f"};
+  symbol.relocations = {sig_relocation{.type = 4, .offset = 4}, sig_relocation{.type = 5, .offset = 12}, sig_relocation{.type = 6, .offset = 16}};
+  symbol.crc_8 = crc32c::Crc32c(masked.data(), 8);
+  symbol.crc_all = crc32c::Crc32c(masked.data(), masked.size());
+
+  REQUIRE(scan_tables::mask(4, 4, target_arch::mips_le)->keep == std::array<uint8_t, 4>{0x00, 0x00, 0x00, 0xFC});
+  REQUIRE(scan_tables::mask(5, 12, target_arch::mips_le)->keep == std::array<uint8_t, 4>{0x00, 0x00, 0xFF, 0xFF});
+  REQUIRE_FALSE(scan_tables::mask(2, 0, target_arch::mips_le));
+
+  // relinked, the jal target and the lo16 change
+  auto relinked = rom;
+  relinked[4] = 0x99;
+  relinked[16] = 0x78;
+  REQUIRE(TestSymbol(symbol, relinked, target_arch::mips_le));
+  REQUIRE_FALSE(TestSymbol(symbol, relinked));
+  REQUIRE(scan_tables::compile({scan_tables::symbol_row(symbol, 0, signature_hit{}, target_arch::mips_le)}).test(0, relinked));
+
+  const auto b_info = LoadBinary(std::vector<uint8_t>{relinked}, rom_kind::raw);
+  REQUIRE(LikelyFunctionOffsets(b_info, {}, target_arch::mips_le).contains(0));
+  REQUIRE_FALSE(LikelyFunctionOffsets(b_info, {}).contains(0));
+
+  REQUIRE(targets::detect(EM_MIPS, ELFDATA2LSB) == target_arch::mips_le);
+  REQUIRE(targets::detect(EM_MIPS, ELFDATA2MSB) == target_arch::mips_be);
+  REQUIRE_FALSE(targets::detect(EM_X86_64, ELFDATA2LSB));
+  REQUIRE(targets::parse(targets::name(target_arch::mips_le)) == target_arch::mips_le);
+  REQUIRE(SignatureTarget({sig_object{.arch = target_arch::mips_le}, sig_object{.arch = target_arch::mips_le}}) == target_arch::mips_le);
+  REQUIRE_FALSE(SignatureTarget({sig_object{}, sig_object{.arch = target_arch::mips_le}}));
+}
+
+TEST_CASE("arm and thumb relocations are masked and their functions found", "[objmatch]") {
+  // an arm function with a bl and a literal pool word, then a thumb one whose bl pair is not word aligned
+  std::vector<uint8_t> rom{0x10, 0x40, 0x2D, 0xE9, 0xFE, 0xFF, 0xFF, 0xEB, 0x10, 0x40, 0xBD, 0xE8, 0x1E, 0xFF, 0x2F, 0xE1, 0x34, 0x12, 0x00, 0x08,
+                           0xC0, 0x46, 0x10, 0xB5, 0xC0, 0x46, 0x00, 0xF0, 0x00, 0xF8, 0x70, 0x47, 0x00, 0x00, 0xA0, 0xE1};
+  std::vector<uint8_t> masked{rom.begin(), rom.begin() + 32};
+  masked[4] = masked[5] = masked[6] = 0;
+  masked[7] &= 0x0E;
+  masked[16] = masked[17] = masked[18] = masked[19] = 0;
+  masked[26] = masked[28] = 0;
+  masked[27] &= 0xF8;
+  masked[29] &= 0xE8;
+
+  sig_symbol symbol{.offset = 0, .size = masked.size(), .symbol = "f"};
+  symbol.relocations = {sig_relocation{.type = R_ARM_CALL, .offset = 4}, sig_relocation{.type = R_ARM_ABS32, .offset = 16},
+                        sig_relocation{.type = R_ARM_THM_PC22, .offset = 26}};
+  symbol.crc_8 = crc32c::Crc32c(masked.data(), 8);
+  symbol.crc_all = crc32c::Crc32c(masked.data(), masked.size());
+
+  REQUIRE(scan_tables::mask(R_ARM_CALL, 4, target_arch::arm)->keep == std::array<uint8_t, 4>{0x00, 0x00, 0x00, 0x0E});
+  REQUIRE(scan_tables::mask(R_ARM_ABS32, 16, target_arch::arm)->keep == std::array<uint8_t, 4>{});
+  REQUIRE(scan_tables::mask(R_ARM_THM_PC22, 26, target_arch::arm)->keep == std::array<uint8_t, 4>{0x00, 0xF8, 0x00, 0xE8});
+  REQUIRE_FALSE(scan_tables::mask(R_ARM_V4BX, 0, target_arch::arm));
+
+  // relinked, both calls move and become blx, the pool word points elsewhere
+  auto relinked = rom;
+  relinked[4] = 0x10;
+  relinked[5] = relinked[6] = 0;
+  relinked[7] = 0xFA;
+  relinked[16] = 0x78;
+  relinked[17] = 0x56;
+  relinked[19] = 0x02;
+  relinked[26] = 0x20;
+  relinked[29] = 0xE8;
+  REQUIRE(TestSymbol(symbol, relinked, target_arch::arm));
+  REQUIRE_FALSE(TestSymbol(symbol, relinked));
+  REQUIRE(scan_tables::compile({scan_tables::symbol_row(symbol, 0, signature_hit{}, target_arch::arm)}).test(0, relinked));
+
+  REQUIRE(arm_target::addend(R_ARM_CALL, 0xEBFFFFFE) == static_cast<uint32_t>(-8));
+  REQUIRE(arm_target::addend(R_ARM_THM_PC22, 0xF802F000) == 4);
+  REQUIRE(targets::symbol_offset(target_arch::arm, 0x17, STT_FUNC) == 0x16);
+  REQUIRE(targets::symbol_offset(target_arch::arm, 0x17, STT_OBJECT) == 0x17);
+
+  // push {r4, lr} at 0, thumb push {r4, lr} at 22, past the thumb bx lr at 32
+  const auto offsets = LikelyFunctionOffsets(LoadBinary(std::vector<uint8_t>{relinked}, rom_kind::raw), {}, target_arch::arm);
+  REQUIRE(offsets.contains(0));
+  REQUIRE(offsets.contains(22));
+  REQUIRE(offsets.contains(32));
+  REQUIRE_FALSE(LikelyFunctionOffsets(LoadBinary(std::vector<uint8_t>{relinked}, rom_kind::raw), {}).contains(22));
+
+  REQUIRE(targets::detect(EM_ARM, ELFDATA2LSB) == target_arch::arm);
+  REQUIRE_FALSE(targets::detect(EM_ARM, ELFDATA2MSB));
+  REQUIRE(targets::parse("arm") == target_arch::arm);
+}
+
+TEST_CASE("prefilter keeps every inserted key and rejects most others", "[objmatch]") {
+  REQUIRE_FALSE(prefilter{}.may_contain(0));
+
+  std::vector<uint32_t> keys;
+  for (uint32_t i = 0; i < 4096; i++) keys.push_back(crc32c::Crc32c(reinterpret_cast<const uint8_t *>(&i), sizeof(i)));
+  prefilter filter{keys.size()};
+  for (auto key : keys) filter.insert(key);
+
+  for (auto key : keys) REQUIRE(filter.may_contain(key));
+
+  // 16 bits per key, well under 1% of absent keys get through
+  uint32_t false_positives = 0;
+  for (uint32_t i = 4096; i < 4096 + 100000; i++) false_positives += filter.may_contain(crc32c::Crc32c(reinterpret_cast<const uint8_t *>(&i), sizeof(i))) ? 1 : 0;
+  REQUIRE(false_positives < 1000);
+
+  auto table = scan_tables::compile({scan_tables::symbol_row(sig_symbol{.size = 4, .symbol = "f"}, keys[0], signature_hit{})});
+  REQUIRE(table.filter.may_contain(keys[0]));
+}
+
+TEST_CASE("every supported kernel set agrees with the baseline one", "[objmatch]") {
+  const auto rom = synth::make_rom(synth::make_library(synth_options{.objects = 8}), 0x10000, 1);
+  const auto &baseline = kernels::get(kernel_isa::baseline);
+  // odd sizes and offsets leave partial words and blocks at both ends
+  const auto bytes = std::span{rom.bytes}.subspan(4, rom.bytes.size() - 7);
+
+  std::vector<uint64_t> jr_ra;
+  std::vector<uint64_t> addiu_sp;
+  baseline.scan_words(target_arch::mips_be, bytes, 4, jr_ra, addiu_sp);
+  REQUIRE_FALSE(jr_ra.empty());
+  REQUIRE_FALSE(addiu_sp.empty());
+  auto swapped16 = std::vector<uint8_t>{bytes.begin(), bytes.end()};
+  baseline.swap16(swapped16);
+  auto swapped32 = std::vector<uint8_t>{bytes.begin(), bytes.end()};
+  baseline.swap32(swapped32);
+  REQUIRE(swapped32[0] == bytes[3]);
+  REQUIRE(swapped32.back() == bytes.back());
+
+  // the same code built little endian has the same returns and prologues
+  std::vector<uint64_t> le_jr_ra;
+  std::vector<uint64_t> le_addiu_sp;
+  baseline.scan_words(target_arch::mips_le, swapped32, 4, le_jr_ra, le_addiu_sp);
+  REQUIRE(le_jr_ra == jr_ra);
+  REQUIRE(le_addiu_sp == addiu_sp);
+
+  // arm finds halfword candidates too, every set must find the same ones
+  std::vector<uint64_t> bx_lr;
+  std::vector<uint64_t> push_lr;
+  baseline.scan_words(target_arch::arm, bytes, 4, bx_lr, push_lr);
+
+  // the rom's own words with every 50th changed, a change in a masked out bit does not count
+  std::vector<uint32_t> words;
+  for (size_t word = 0; word + 4 <= bytes.size(); word += 4) {
+    words.push_back(static_cast<uint32_t>(bytes[word]) << 24 | static_cast<uint32_t>(bytes[word + 1]) << 16 |
+                    static_cast<uint32_t>(bytes[word + 2]) << 8 | static_cast<uint32_t>(bytes[word + 3]));
+  }
+  std::vector<uint32_t> keep(words.size(), 0xFFFFFFFF);
+  for (size_t word = 0; word < words.size(); word += 50) words[word] ^= 0x00000100;
+  keep[50] = 0xFFFF0000;
+  const auto mismatches = baseline.mismatched_words(bytes, words, keep);
+  REQUIRE(mismatches == (words.size() + 49) / 50 - 1);
+
+  for (size_t isa = 0; isa < static_cast<size_t>(kernel_isa::count); isa++) {
+    const auto &set = kernels::get(static_cast<kernel_isa>(isa));
+    if (!kernels::supported(set.isa)) continue;
+    INFO(kernels::name(set.isa));
+
+    std::vector<uint64_t> set_jr_ra;
+    std::vector<uint64_t> set_addiu_sp;
+    set.scan_words(target_arch::mips_be, bytes, 4, set_jr_ra, set_addiu_sp);
+    REQUIRE(set_jr_ra == jr_ra);
+    REQUIRE(set_addiu_sp == addiu_sp);
+    set_jr_ra.clear();
+    set_addiu_sp.clear();
+    set.scan_words(target_arch::mips_le, swapped32, 4, set_jr_ra, set_addiu_sp);
+    REQUIRE(set_jr_ra == jr_ra);
+    REQUIRE(set_addiu_sp == addiu_sp);
+    set_jr_ra.clear();
+    set_addiu_sp.clear();
+    set.scan_words(target_arch::arm, bytes, 4, set_jr_ra, set_addiu_sp);
+    REQUIRE(set_jr_ra == bx_lr);
+    REQUIRE(set_addiu_sp == push_lr);
+
+    auto set_swapped16 = std::vector<uint8_t>{bytes.begin(), bytes.end()};
+    set.swap16(set_swapped16);
+    REQUIRE(set_swapped16 == swapped16);
+    auto set_swapped32 = std::vector<uint8_t>{bytes.begin(), bytes.end()};
+    set.swap32(set_swapped32);
+    REQUIRE(set_swapped32 == swapped32);
+    REQUIRE(set.mismatched_words(bytes, words, keep) == mismatches);
+  }
+
+  REQUIRE(kernels::parse("avx2") == kernel_isa::avx2);
+  REQUIRE_FALSE(kernels::parse("neon"));
+  const auto widest = kernels::active().isa;
+  REQUIRE(kernels::select(kernel_isa::baseline));
+  REQUIRE(kernels::active().isa == kernel_isa::baseline);
+  REQUIRE(kernels::select(widest));
+}
+
+TEST_CASE("a crc_all match with a different 64 bit hash is a collision", "[objmatch]") {
+  const std::vector<uint8_t> rom{0x27, 0xBD, 0xFF, 0xE0, 0x0C, 0x12, 0x34, 0x56, 0x00, 0x00, 0x00, 0x00, 0x03, 0xE0, 0x00, 0x08};
+  sig_symbol symbol{.offset = 0, .size = rom.size(), .symbol = "f"};
+  symbol.relocations = {sig_relocation{.type = 4, .offset = 4}};
+
+  std::vector<uint8_t> masked = rom;
+  masked[4] &= 0xFC;
+  masked[5] = masked[6] = masked[7] = 0;
+  symbol.crc_8 = crc32c::Crc32c(masked.data(), 8);
+  symbol.crc_all = crc32c::Crc32c(masked.data(), masked.size());
+  symbol.hash = sig_hash::crc64;
+  symbol.hash_all = hash64::extend(sig_hash::crc64, 0, masked.data(), masked.size());
+  REQUIRE(hash64::extend(sig_hash::crc64, hash64::extend(sig_hash::crc64, 0, masked.data(), 5), &masked[5], masked.size() - 5) == symbol.hash_all);
+
+  REQUIRE(TestSymbol(symbol, rom));
+  REQUIRE(scan_tables::compile({scan_tables::symbol_row(symbol, 0, signature_hit{})}).test(0, rom));
+
+  // what another symbol with the same crc32c but different bytes would have recorded
+  auto collision = symbol;
+  collision.hash_all ^= 1;
+  REQUIRE_FALSE(TestSymbol(collision, rom));
+  REQUIRE_FALSE(scan_tables::compile({scan_tables::symbol_row(collision, 0, signature_hit{})}).test(0, rom));
+
+  // older signatures have no 64 bit hash and only compare crc_all
+  collision.hash = sig_hash::none;
+  REQUIRE(TestSymbol(collision, rom));
+}
+
+TEST_CASE("flirt patterns wildcard relocated bytes and crc the tail", "[objmatch]") {
+  const std::vector<uint8_t> check{'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  REQUIRE(flirt::crc16(check) == 0x906E);
+
+  // jal with an R_MIPS_26 relocation, then 36 plain bytes
+  std::vector<uint8_t> masked{0x27, 0xBD, 0xFF, 0xE0, 0x0C, 0x00, 0x00, 0x00};
+  for (uint8_t byte = 0; byte < 36; byte++) masked.push_back(byte);
+  const std::vector<scan_mask> masks{*scan_tables::mask(4, 4)};
+
+  const auto pattern = flirt::make_pattern(masked, masks);
+
+  // the kept top bits of the jal opcode byte still vary with the target, so the whole word is wildcarded
+  REQUIRE(pattern.pattern.starts_with("27BDFFE0........000102"));
+  REQUIRE(pattern.pattern.size() == flirt_prefix * 2);
+  REQUIRE(pattern.tail_size == masked.size() - flirt_prefix);
+  REQUIRE(pattern.crc16 == flirt::crc16(std::span{masked}.subspan(flirt_prefix)));
+}
+
+TEST_CASE("flirt trie finds the objects planted in a synthetic rom", "[objmatch]") {
+  const auto planted = synth::planted_case(synth_options{.objects = 16, .functions_per_object = 4}, 0x40000);
+  REQUIRE(flirt::has_patterns(planted.sigs));
+
+  const auto trie = flirt::build(planted.sigs);
+  REQUIRE(flirt::deserialize(flirt::serialize(trie), planted.sigs) == trie);
+  // a trie compiled for other signatures is not used
+  REQUIRE_FALSE(flirt::deserialize(flirt::serialize(trie), std::vector<sig_object>{}));
+  // nor one whose root is its own child, or that has nodes no parent reaches
+  auto looped = trie;
+  looped.nodes[0].child_begin = 0;
+  looped.nodes[0].child_end--;
+  REQUIRE_FALSE(flirt::deserialize(flirt::serialize(looped), planted.sigs));
+  auto orphaned = trie;
+  orphaned.nodes[0].child_end = orphaned.nodes[0].child_begin;
+  REQUIRE_FALSE(flirt::deserialize(flirt::serialize(orphaned), planted.sigs));
+
+  const auto result = ProcessSignatureTrie(planted.sigs, planted.strings, trie, planted.b_info, planted.offsets);
+
+  for (const auto &placement : planted.rom.placements) {
+    REQUIRE(std::ranges::contains(result, placement.text_start, &splat_out::start));
+  }
+}
+
+TEST_CASE("keyword is the longest relocation free word run of a pattern", "[objmatch]") {
+  REQUIRE(keyword_scan::keyword("27BDFFE0........AFBF001403E00008") == keyword_run{.first_word = 2, .words = 2});
+  REQUIRE(keyword_scan::keyword("27BDFFE0AFBF0014........03E00008") == keyword_run{.first_word = 0, .words = 2});
+  REQUIRE(keyword_scan::keyword("0000000100000002000000030000000400000005") == keyword_run{.first_word = 0, .words = keyword_max_words});
+  REQUIRE_FALSE(keyword_scan::keyword("27BDFFE0........03E00008........"));
+}
+
+TEST_CASE("keyword scan finds the planted objects without candidate offsets", "[objmatch]") {
+  const auto planted = synth::planted_case(synth_options{.objects = 16, .functions_per_object = 4}, 0x40000);
+  const auto automaton = keyword_scan::build(planted.sigs);
+  REQUIRE(automaton.unanchored.empty());
+
+  const auto result = ProcessSignatureScan(planted.sigs, planted.strings, automaton, planted.b_info, {}, {});
+
+  for (const auto &placement : planted.rom.placements) {
+    REQUIRE(std::ranges::contains(result, placement.text_start, &splat_out::start));
+  }
+}
+
+TEST_CASE("fuzzy matching finds a function with one changed instruction", "[objmatch]") {
+  auto planted = synth::planted_case(synth_options{.objects = 16, .functions_per_object = 4}, 0x40000);
+  const auto &sigs = planted.sigs;
+  const auto &strings = planted.strings;
+  REQUIRE(fuzzy::has_words(sigs));
+
+  // the longest function of the first object, changed outside its anchor window and relocations
+  const auto &text = *std::ranges::find(sigs[0].sections, ".text", &sig_section::name);
+  const auto section = static_cast<uint32_t>(&text - sigs[0].sections.data());
+  const auto &changed = *std::ranges::max_element(text.symbols, {}, &sig_symbol::size);
+  const auto symbol = static_cast<uint32_t>(&changed - text.symbols.data());
+  REQUIRE(changed.anchor_size != 0);
+  uint64_t at = 8;
+  auto usable = [&changed](uint64_t offset) {
+    const bool in_anchor = offset + 4 > changed.anchor_offset && offset < changed.anchor_offset + changed.anchor_size;
+    return !in_anchor && std::ranges::none_of(changed.relocations, [offset](const sig_relocation &rel) { return rel.offset == offset; });
+  };
+  while (!usable(at)) at += 4;
+  REQUIRE(at + 12 <= changed.size);
+  const auto rom_offset = planted.rom.placements[0].text_start + changed.offset;
+  planted.rom.bytes[rom_offset + at + 3] ^= 0x01;
+  synth::reload(planted);
+
+  const auto &b_info = planted.b_info;
+  const auto &offsets = planted.offsets;
+  const auto index = BuildSignatureIndex(sigs, strings);
+  const auto section_hits = FindSectionHits(index, b_info, offsets);
+  const auto matched = MatchedSections(section_hits);
+  const auto symbol_hits = FindSymbolHits(index, b_info, offsets, matched);
+  REQUIRE_FALSE(matched.contains({0, section}));
+
+  const auto hits = fuzzy::best(fuzzy::find_hits(index, sigs, b_info, offsets, matched, symbol_hits, 25), sigs, section_hits, symbol_hits);
+  const fuzzy_hit expect{.hit = signature_hit{.object = 0, .section = section, .symbol = symbol, .rom_offset = static_cast<uint32_t>(rom_offset)},
+                         .mismatches = 1,
+                         .words = static_cast<uint32_t>(changed.size / 4)};
+  REQUIRE(std::ranges::contains(hits, expect));
+
+  const auto result = ProcessSignatureFuzzy(sigs, strings, index, b_info, offsets, 25);
+  REQUIRE(std::ranges::contains(result, planted.rom.placements[0].text_start, &splat_out::start));
+}
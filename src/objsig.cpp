@@ -6,14 +6,54 @@
 #include <yaml-cpp/yaml.h>
 
 #include <algorithm>
+#include <array>
 #include <bit>
 #include <crc32c/crc32c.h>
 #include <cstring>
 #include <filesystem>
+#include <map>
+#include <optional>
 #include <print>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "flirt.h"
+#include "run_stats.h"
+#include "target.h"
+#include "trace.h"
+
 namespace {
+// window sizes tried for the per symbol anchor, smaller is cheaper to hash in objmatch
+constexpr std::array<uint64_t, 2> anchor_sizes{8, 16};
+
+using anchor_window = struct anchor_window {
+  uint64_t offset{};
+  uint64_t size{};
+  uint32_t crc{};
+};
+
+auto window_key(const anchor_window &window) -> uint64_t { return window.size << 32 | window.crc; }
+
+// every word aligned window of the symbol that no relocation touches
+// relocated bytes are masked, so they are the least selective bytes of a function
+auto AnchorWindows(const sig_symbol &sig_sym, const std::span<const uint8_t> &symbol_span) -> std::vector<anchor_window> {
+  std::vector<anchor_window> windows;
+  for (auto size : anchor_sizes) {
+    for (uint64_t offset = 0; offset + size <= symbol_span.size(); offset += sizeof(uint32_t)) {
+      auto touches_relocation = std::ranges::any_of(sig_sym.relocations, [offset, size](const sig_relocation &rel) {
+        return rel.offset < offset + size && rel.offset + sizeof(uint32_t) > offset;
+      });
+      if (touches_relocation) continue;
+
+      windows.push_back(anchor_window{.offset = offset, .size = size, .crc = crc32c::Crc32c(&symbol_span[offset], size)});
+    }
+  }
+
+  return windows;
+}
+
 auto readswap32(const std::span<const uint8_t, 4> &buf) -> uint32_t {
   uint32_t word{};
   std::memcpy(&word, buf.data(), 4);
@@ -22,18 +62,28 @@ auto readswap32(const std::span<const uint8_t, 4> &buf) -> uint32_t {
 }
 }
 
-auto ObjSigAnalyze(const char *path) -> bool {
+auto ObjSigAnalyze(const char *path, sig_hash hash, bool compile_trie, bool keep_words) -> bool {
   const std::filesystem::path fs_path{path};
   if (fs_path.extension() == ".a") {
-    auto temp = ProcessLibrary(fs_path.c_str());
-    auto output = sig_yaml::serialize(temp);
+    sig_arena arena;
+    auto temp = ProcessLibrary(fs_path.c_str(), &arena, hash);
+    if (!keep_words) {
+      for (auto &sig_obj : temp) {
+        for (auto &sig_sec : sig_obj.sections) {
+          for (auto &sig_sym : sig_sec.symbols) sig_sym.words.clear();
+        }
+      }
+    }
+    const auto trie = compile_trie ? flirt::serialize(flirt::build(temp)) : std::vector<uint8_t>{};
+    const phase_timer timer{stat_phase::emit};
+    auto output = sig_yaml::serialize(temp, trie);
     std::println("{}", std::string_view(output));
   }
 
   return true;
 }
 
-auto ProcessLibrary(const char *path) -> std::vector<sig_object> {
+auto ProcessLibrary(const char *path, std::pmr::memory_resource *arena, sig_hash hash) -> std::vector<sig_object> {
   auto archive_file_descriptor = open(path, O_RDONLY | O_CLOEXEC);
 
   // move to main or static?
@@ -41,10 +91,42 @@ auto ProcessLibrary(const char *path) -> std::vector<sig_object> {
   
   auto archive_elf = elf_begin(archive_file_descriptor, ELF_C_READ, nullptr);  // null check
 
+  auto sig_library = ProcessArchive(archive_file_descriptor, archive_elf, arena, hash);
+
+  elf_end(archive_elf);
+  close(archive_file_descriptor);
+
+  return sig_library;
+}
+
+auto ProcessLibrary(std::span<char> archive, std::pmr::memory_resource *arena, sig_hash hash) -> std::vector<sig_object> {
+  if (elf_version(EV_CURRENT) == EV_NONE) std::print("version out of date");
+
+  auto archive_elf = elf_memory(archive.data(), archive.size());
+  if (archive_elf == nullptr) return {};
+
+  // members of an in memory archive have no descriptor
+  auto sig_library = ProcessArchive(-1, archive_elf, arena, hash);
+
+  elf_end(archive_elf);
+
+  return sig_library;
+}
+
+auto ProcessArchive(int archive_file_descriptor, Elf *archive_elf, std::pmr::memory_resource *arena, sig_hash hash)
+    -> std::vector<sig_object> {
   auto sig_library = std::vector<sig_object>();
 
-  std::unordered_map<uint32_t, int> symbol_crcs;
+  // duplicates share crc_all and the 64 bit hash, with no 64 bit hash crc_all alone decides
+  std::map<std::pair<uint32_t, uint64_t>, int> symbol_crcs;
+  std::map<std::pair<uint32_t, uint64_t>, int> section_crcs;
+
+  // anchor selection needs statistics from the whole library
+  // so candidate windows are kept, in symbol order, until every object is processed
+  std::vector<std::vector<anchor_window>> symbol_windows;
+  std::unordered_map<uint64_t, int> window_counts;
 
+  std::optional<phase_timer> parse_timer{std::in_place, stat_phase::archive_parse};
   Elf_Cmd elf_command = ELF_C_READ;
   Elf *object_file_elf = nullptr;
   while ((object_file_elf = elf_begin(archive_file_descriptor, elf_command, archive_elf)) != nullptr) {
@@ -56,6 +138,19 @@ auto ProcessLibrary(const char *path) -> std::vector<sig_object> {
       elf_end(object_file_elf);
       continue;
     }
+    const trace_span member_span{"objsig", archive_header->ar_name};
+
+    // relocations are decoded and masked the way the object's target lays them out
+    GElf_Ehdr elf_header;
+    const auto arch = gelf_getehdr(object_file_elf, &elf_header) == nullptr
+                          ? std::nullopt
+                          : targets::detect(elf_header.e_machine, elf_header.e_ident[EI_DATA]);
+    if (!arch) {
+      std::println(stderr, "Skipping {}, not a mips or little endian arm object", archive_header->ar_name);
+      elf_command = elf_next(object_file_elf);
+      elf_end(object_file_elf);
+      continue;
+    }
 
     /// PROCESS OBJECT START
 
@@ -123,7 +218,7 @@ auto ProcessLibrary(const char *path) -> std::vector<sig_object> {
     auto extended_section_index_table_index = elf_scnshndx(symtab_section);
     auto xndxdata = extended_section_index_table_index == 0 ? nullptr : elf_getdata(elf_getscn(object_file_elf, extended_section_index_table_index), nullptr);
 
-    auto sig_obj = sig_object{.file = object_path.string()};
+    auto sig_obj = sig_object{.file = std::pmr::string{object_path.string(), arena}, .arch = *arch, .sections = std::pmr::vector<sig_section>{arena}};
     for (auto sec_rec : sections) {
       GElf_Shdr section_header;
       gelf_getshdr(sec_rec.section, &section_header);  // error if not returns &section_header?
@@ -139,7 +234,7 @@ auto ProcessLibrary(const char *path) -> std::vector<sig_object> {
 
       auto rel_entry_count = rel_section_header_ptr == nullptr ? 0 : rel_section_header.sh_size / rel_section_header.sh_entsize;
 
-      auto sig_sec = sig_section{.size = section_header.sh_size, .name = std::string(section_name)};
+      auto sig_sec = sig_section{.size = section_header.sh_size, .name = std::pmr::string{section_name, arena}, .symbols = std::pmr::vector<sig_symbol>{arena}};
 
       for (int nSymbol = 0; nSymbol < symbol_count; nSymbol++) {
         GElf_Sym libelf_symbol;
@@ -149,7 +244,7 @@ auto ProcessLibrary(const char *path) -> std::vector<sig_object> {
         auto symbol_name = elf_strptr(object_file_elf, symtab_header.sh_link, libelf_symbol.st_name);
         auto symbol_type = GELF_ST_TYPE(libelf_symbol.st_info);
         auto symbol_size = libelf_symbol.st_size;
-        auto symbol_offset = libelf_symbol.st_value;
+        auto symbol_offset = targets::symbol_offset(*arch, libelf_symbol.st_value, symbol_type);
 
         //|| symbol_type != STT_FUNC
         // the symbol for the section, shares its name
@@ -165,13 +260,16 @@ auto ProcessLibrary(const char *path) -> std::vector<sig_object> {
 
         uint32_t lastHi16Addend = 0;
 
-        auto sig_sym = sig_symbol{.offset = symbol_offset, .size = symbol_size, .symbol = std::string(symbol_name)};
+        auto sig_sym = sig_symbol{.offset = symbol_offset,
+                                  .size = symbol_size,
+                                  .symbol = std::pmr::string{symbol_name, arena},
+                                  .relocations = std::pmr::vector<sig_relocation>{arena}};
 
         for (int relocation_index = 0; relocation_index < rel_entry_count; relocation_index++) {
           GElf_Rel relocation;
           gelf_getrel(relocation_data, relocation_index, &relocation);  // why does this return relocation and take in argument by ptr?
 
-          if (relocation.r_offset < libelf_symbol.st_value || relocation.r_offset >= libelf_symbol.st_value + libelf_symbol.st_size) {
+          if (relocation.r_offset < symbol_offset || relocation.r_offset >= symbol_offset + symbol_size) {
             continue;
           }
 
@@ -210,34 +308,32 @@ auto ProcessLibrary(const char *path) -> std::vector<sig_object> {
           // but only STB_LOCAL seems to ever have an addend that is not 0
           // perhaps this is because most globals, like function refs, will have an addend of 0?
 
-          // possibly could use libelf for this conversion using ELF_T_WORD or something?
-          // the transformation to do here, depends the platform of the elf file
-          // But not the platform I'm running on, right? because IN REGISTER, things will be in the expected order
-          // probably should add comment explaining why alternatives are bad, alignment issues, host platform issues
-          auto opcodeBE = readswap32(opcode);
+          // the transformation to do here depends on the target of the elf file, not the host
+          // bytes are assembled one at a time, so alignment and host byte order do not matter
+          auto word = targets::load(*arch, opcode.data());
 
-          if (relocation_type == R_MIPS_HI16) {
-            addend = (opcodeBE & 0xFFFF) << 16;
+          if (targets::high_half(*arch, relocation_type)) {
+            addend = (word & 0xFFFF) << 16;
             GElf_Rel relocation2;
             // note, index + 1
             gelf_getrel(relocation_data, relocation_index + 1, &relocation2);  // todo guard
 
             // next relocation must be LO16
             auto relocation2_type = GELF_R_TYPE(relocation2.r_info);
-            if (relocation2_type != R_MIPS_LO16) {
+            if (!targets::low_half(*arch, relocation2_type)) {
               //error
             }
 
             const std::span<uint8_t, 4> opcode2(&section_span[relocation2.r_offset], 4);
-            auto opcode2BE = readswap32(opcode2);
+            auto word2 = targets::load(*arch, opcode2.data());
 
-            addend += static_cast<int16_t>(opcode2BE & 0xFFFF);
+            addend += static_cast<int16_t>(word2 & 0xFFFF);
             lastHi16Addend = addend;
 
-          } else if (relocation_type == R_MIPS_LO16) {
+          } else if (targets::low_half(*arch, relocation_type)) {
             addend = lastHi16Addend;
-          } else if (relocation_type == R_MIPS_26) {
-            addend = (opcodeBE & 0x03FFFFFF) << 2;
+          } else {
+            addend = targets::addend(*arch, relocation_type, word);
           }
 
           if (rel_symbol_binding == STB_LOCAL) {
@@ -251,27 +347,20 @@ auto ProcessLibrary(const char *path) -> std::vector<sig_object> {
           // Also, the .text symbol covers the range of all the function data
           // and processing it causes all addends to be wiped
           //  set addend to 0 before crc
-          if (relocation_type == R_MIPS_HI16 || relocation_type == R_MIPS_LO16) {
-            opcode[2] = 0x00;
-            opcode[3] = 0x00;
-          } else if (relocation_type == R_MIPS_26) {
-            opcode[0] &= 0xFC;
-            opcode[1] = 0x00;
-            opcode[2] = 0x00;
-            opcode[3] = 0x00;
-          } else {
+          if (!targets::strip(*arch, opcode.data(), relocation_type)) {
             // Need to log more context
             // printf("# warning unhandled relocation type\n");
+            run_stats::add(stat_counter::unmasked_relocations);
             continue;
             // printf("unk rel %d\n", relType);
             // exit(0);
           }
 
           sig_sym.relocations.push_back(sig_relocation{.type = relocation_type,
-                                                       .offset = relocation.r_offset - libelf_symbol.st_value,
+                                                       .offset = relocation.r_offset - symbol_offset,
                                                        .addend = addend,
                                                        .local = is_local,
-                                                       .name = std::string(rel_symbol_name)});
+                                                       .name = std::pmr::string{rel_symbol_name, arena}});
         }
 
         //// STRIP AND RELCOS END
@@ -283,29 +372,81 @@ auto ProcessLibrary(const char *path) -> std::vector<sig_object> {
         if (section_data != nullptr && section_data->d_buf != nullptr) {
           sig_sym.crc_8 = crc32c::Crc32c(&section_span[symbol_offset], std::min(static_cast<uint64_t>(symbol_size), static_cast<uint64_t>(8)));
           sig_sym.crc_all = crc32c::Crc32c(&section_span[symbol_offset], symbol_size);
+          sig_sym.hash = hash;
+          sig_sym.hash_all = hash64::extend(hash, 0, &section_span[symbol_offset], symbol_size);
+          auto pattern = flirt::make_pattern(section_span.subspan(symbol_offset, symbol_size), scan_tables::symbol_masks(sig_sym, *arch));
+          sig_sym.pattern = std::pmr::string{pattern.pattern, arena};
+          sig_sym.tail_size = pattern.tail_size;
+          sig_sym.crc16 = pattern.crc16;
+          sig_sym.words = std::pmr::vector<uint32_t>{arena};
+          sig_sym.words.reserve(symbol_size / 4);
+          // big endian whatever the target, to fuzzy matching a word is only four masked bytes
+          for (uint64_t word = 0; word + 4 <= symbol_size; word += 4) {
+            sig_sym.words.push_back(readswap32(std::span<const uint8_t, 4>{&section_span[symbol_offset + word], 4}));
+          }
         }
 
-        symbol_crcs[sig_sym.crc_all] += 1;
-        sig_sec.symbols.push_back(sig_sym);
+        auto windows = section_data != nullptr && section_data->d_buf != nullptr
+                           ? AnchorWindows(sig_sym, section_span.subspan(symbol_offset, symbol_size))
+                           : std::vector<anchor_window>{};
+        for (const auto &window : windows) window_counts[window_key(window)] += 1;
+        symbol_windows.push_back(std::move(windows));
+
+        symbol_crcs[{sig_sym.crc_all, sig_sym.hash_all}] += 1;
+        // moved, a copy would leave the arena
+        sig_sec.symbols.push_back(std::move(sig_sym));
       }
 
-      sig_obj.sections.push_back(sig_sec);
+      // relocations of every symbol have been masked in the buffer by now
+      if (section_data != nullptr && section_data->d_buf != nullptr && !section_span.empty()) {
+        sig_sec.crc_8 = crc32c::Crc32c(section_span.data(), std::min(static_cast<uint64_t>(section_span.size()), static_cast<uint64_t>(8)));
+        sig_sec.crc_all = crc32c::Crc32c(section_span.data(), section_span.size());
+        sig_sec.hash = hash;
+        sig_sec.hash_all = hash64::extend(hash, 0, section_span.data(), section_span.size());
+        auto pattern = flirt::make_pattern(section_span, scan_tables::section_masks(sig_sec, *arch));
+        sig_sec.pattern = std::pmr::string{pattern.pattern, arena};
+        sig_sec.tail_size = pattern.tail_size;
+        sig_sec.crc16 = pattern.crc16;
+        section_crcs[{sig_sec.crc_all, sig_sec.hash_all}] += 1;
+      }
+
+      sig_obj.sections.push_back(std::move(sig_sec));
     }
 
-    sig_library.push_back(sig_obj);
+    sig_library.push_back(std::move(sig_obj));
     elf_command = elf_next(object_file_elf);
     elf_end(object_file_elf);
   }
-  close(archive_file_descriptor);
+  parse_timer.reset();
+  const phase_timer anchor_timer{stat_phase::anchor_select};
 
   // remove any symbols with matching CRCs
   // impossible to use the CRC alone to determine which one it is in ROM
   // FLIRT will not have this problem
   // still need them to use for lookups
+  //
+  // the anchor is the window shared by the fewest symbols in the library
+  // common prologues like addiu sp / sw ra make the first 8 bytes a poor prefilter
+  auto windows = symbol_windows.begin();
+  run_stats::add(stat_counter::objects, sig_library.size());
   for (auto &sig_obj : sig_library) {
+    run_stats::add(stat_counter::sections, sig_obj.sections.size());
     for (auto &sig_section : sig_obj.sections) {
+      run_stats::add(stat_counter::symbols, sig_section.symbols.size());
+      sig_section.duplicate_crc = sig_section.crc_all != 0 && section_crcs[{sig_section.crc_all, sig_section.hash_all}] > 1;
+
       for (auto &sig_sym : sig_section.symbols) {
-        sig_sym.duplicate_crc = symbol_crcs[sig_sym.crc_all] > 1;
+        sig_sym.duplicate_crc = symbol_crcs[{sig_sym.crc_all, sig_sym.hash_all}] > 1;
+
+        auto best = std::ranges::min_element(*windows, {}, [&window_counts](const anchor_window &window) {
+          return std::make_tuple(window_counts[window_key(window)], window.size, window.offset);
+        });
+        if (best != windows->end()) {
+          sig_sym.anchor_offset = best->offset;
+          sig_sym.anchor_size = best->size;
+          sig_sym.crc_anchor = best->crc;
+        }
+        ++windows;
       }
     }
   }
@@ -3,10 +3,24 @@
 #include <gelf.h>
 #include <libelf.h>
 
+#include <memory_resource>
+#include <span>
 #include <vector>
 
 #include "signature.h"
 
-auto ProcessLibrary(const char *path) -> std::vector<sig_object>;
+// sections, symbols, relocations and names of the result are allocated from arena
+// symbols keep their masked words, so signatures built in memory can always be fuzzy matched
+// hash is the 64 bit hash recorded next to crc_all, sig_hash::none writes the older crc32c only signatures
+auto ProcessLibrary(const char *path, std::pmr::memory_resource *arena = std::pmr::get_default_resource(), sig_hash hash = sig_hash::crc64)
+    -> std::vector<sig_object>;
+// archive already in memory, it is not copied and must outlive the call
+auto ProcessLibrary(std::span<char> archive, std::pmr::memory_resource *arena = std::pmr::get_default_resource(), sig_hash hash = sig_hash::crc64)
+    -> std::vector<sig_object>;
+// archive_file_descriptor is -1 for elf_memory archives
+auto ProcessArchive(int archive_file_descriptor, Elf *archive_elf, std::pmr::memory_resource *arena = std::pmr::get_default_resource(),
+                    sig_hash hash = sig_hash::crc64) -> std::vector<sig_object>;
 
-auto ObjSigAnalyze(const char *path) -> bool;
+// compile_trie appends the flirt trie of the signatures, objmatch then loads it instead of building its own
+// keep_words writes the masked words of every symbol, which objmatch -z needs, in a larger file
+auto ObjSigAnalyze(const char *path, sig_hash hash = sig_hash::crc64, bool compile_trie = false, bool keep_words = false) -> bool;
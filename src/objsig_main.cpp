@@ -1,24 +1,38 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <optional>
 #include <print>
 #include <span>
 
+#include "hash64.h"
 #include "objsig.h"
+#include "run_stats.h"
+#include "trace.h"
 
 auto main(int argc, const char *argv[]) -> int {
-  const std::span<const char *> args = {argv, 3};
+  const std::span<const char *> args = {argv, static_cast<size_t>(argc)};
 
   if (argc < 2) {
     std::print(
         "objsig - signature file generator for objsym ()\n\n"
         "  Usage: objsig [options]\n\n"
         "  Options:\n"
-        "    -l <lib path>     add a library path\n");
+        "    -l <lib path>     add a library path\n"
+        "    -H <none|crc64>   64 bit hash recorded next to the crc32c (crc64)\n"
+        "    -F                compile the flirt trie into the signature file\n"
+        "    -W                record the masked words of symbols, for objmatch -z\n"
+        "    -t <text|json>    print phase times, match and hardware counters to stderr\n"
+        "    -T <trace path>   write a chrome trace event json of the run\n");
 
     return EXIT_FAILURE;
   }
 
+  const char *libPath = nullptr;
+  sig_hash hash = sig_hash::crc64;
+  bool compile_trie = false;
+  bool keep_words = false;
+  std::optional<stats_format> stats;
   for (int argi = 1; argi < argc; argi++) {
     if (args[argi][0] != '-') {
       std::println("Error: Unexpected '{}' in command line", args[argi]);
@@ -33,12 +47,55 @@ auto main(int argc, const char *argv[]) -> int {
     if (args[argi][1] == 'l') {
       if (argi + 1 >= argc) {
         std::println("Error: No path specified for '-l'");
+        return EXIT_FAILURE;
       }
-      ObjSigAnalyze(args[argi + 1]);
+      // only the first library is analyzed
+      if (libPath == nullptr) libPath = args[argi + 1];
+      argi++;
+    } else if (args[argi][1] == 'H') {
+      if (argi + 1 >= argc) {
+        std::println("Error: No hash specified for '-H'");
+        return EXIT_FAILURE;
+      }
+      const auto kind = hash64::parse(args[argi + 1]);
+      if (!kind) {
+        std::println("Error: Hash '{}' is not none or crc64", args[argi + 1]);
+        return EXIT_FAILURE;
+      }
+      hash = *kind;
+      argi++;
+    } else if (args[argi][1] == 'F') {
+      compile_trie = true;
+    } else if (args[argi][1] == 'W') {
+      keep_words = true;
+    } else if (args[argi][1] == 'T') {
+      if (argi + 1 >= argc) {
+        std::println("Error: No path specified for '-T'");
+        return EXIT_FAILURE;
+      }
+      trace::start(args[argi + 1]);
+      argi++;
+    } else if (args[argi][1] == 't') {
+      if (argi + 1 >= argc) {
+        std::println("Error: No format specified for '-t'");
+        return EXIT_FAILURE;
+      }
+      stats = run_stats::parse_format(args[argi + 1]);
+      if (!stats) {
+        std::println("Error: Stats format '{}' is not text or json", args[argi + 1]);
+        return EXIT_FAILURE;
+      }
+      perf_counters::enable();
       argi++;
-      break;
     }
   }
 
+  if (libPath != nullptr) ObjSigAnalyze(libPath, hash, compile_trie, keep_words);
+  if (stats) std::print(stderr, "{}", run_stats::report(*stats));
+  if (!trace::finish()) {
+    std::println("Error: Could not write the trace");
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,297 @@
+#include "oracle.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <random>
+#include <span>
+#include <utility>
+
+#include "flirt.h"
+#include "keyword_scan.h"
+#include "matcher.h"
+
+namespace {
+auto Describe(splat_out const &entry) -> std::string {
+  return std::format("{{start: 0x{:x}, vram: 0x{:x}, type: {}, name: {}}}", entry.start, entry.vram, entry.type, entry.name);
+}
+
+auto Read32(std::vector<uint8_t> const &bytes, uint64_t offset) -> uint32_t {
+  return static_cast<uint32_t>(bytes[offset]) << 24 | static_cast<uint32_t>(bytes[offset + 1]) << 16 | static_cast<uint32_t>(bytes[offset + 2]) << 8 |
+         static_cast<uint32_t>(bytes[offset + 3]);
+}
+
+auto Write32(std::vector<uint8_t> &bytes, uint64_t offset, uint32_t value) -> void {
+  for (int byte = 0; byte < 4; byte++) bytes[offset + byte] = static_cast<uint8_t>(value >> (24 - byte * 8));
+}
+
+auto Mutate(std::vector<synth_object> const &library, synth_rom &rom, uint32_t seed) -> void {
+  std::mt19937 rng{seed ^ 0x9E3779B9};
+  std::uniform_int_distribution<uint32_t> roll{0, 3};
+
+  for (size_t object = 0; object < library.size(); object++) {
+    const auto &obj = library[object];
+    const auto mutation = roll(rng);
+    if (mutation > 1) continue;
+
+    uint64_t function_start = rom.placements[object].text_start;
+    for (const auto &function : obj.functions) {
+      if (mutation == 0 && function.words.size() > 5) {
+        // one unrelocated body word, the prologue and epilogue are left alone so offsets stay candidates
+        std::uniform_int_distribution<size_t> word{2, function.words.size() - 4};
+        const auto at = word(rng);
+        if (std::ranges::none_of(function.relocations, [at](const synth_relocation &rel) { return rel.offset / 4 == at; })) {
+          const auto offset = function_start + at * 4;
+          Write32(rom.bytes, offset, Read32(rom.bytes, offset) ^ 0x00010000);
+          break;
+        }
+      } else if (mutation == 1) {
+        for (const auto &rel : function.relocations) {
+          const auto offset = function_start + rel.offset;
+          const auto word = Read32(rom.bytes, offset);
+          const uint32_t field = rel.type == 4 ? 0x03FFFFFF : 0xFFFF;
+          Write32(rom.bytes, offset, (word & ~field) | (static_cast<uint32_t>(rng()) & field));
+        }
+      }
+      function_start += function.words.size() * 4;
+    }
+  }
+}
+
+// a name no other run of the oracle uses
+auto ScratchPath(uint32_t seed, std::string_view what) -> std::filesystem::path {
+  return std::filesystem::temp_directory_path() / std::format("objmatch_oracle_{}_{}_{}", getpid(), seed, what);
+}
+
+auto Cached(oracle_case const &test, int runs) -> std::vector<splat_out> {
+  const auto dir = ScratchPath(test.seed, "cache");
+  std::filesystem::remove_all(dir);
+
+  const auto index = BuildSignatureIndex(test.sigs, test.strings);
+  std::vector<splat_out> result;
+  for (int run = 0; run < runs; run++) {
+    result = ProcessSignatureFileCached(test.sigs, test.strings, index, test.b_info, test.offsets, dir, "oracle");
+  }
+
+  std::filesystem::remove_all(dir);
+  return result;
+}
+
+auto MatchArchiveFile(oracle_case const &test) -> std::vector<splat_out> {
+  const auto path = ScratchPath(test.seed, "lib.a");
+  {
+    std::ofstream file{path, std::ios::binary};
+    file.write(test.archive.data(), static_cast<std::streamsize>(test.archive.size()));
+  }
+
+  const std::vector<char> rom{test.rom.bytes.begin(), test.rom.bytes.end()};
+  auto archive_file_descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  auto result = matcher(test.splat, rom, archive_file_descriptor, test.paths, "synth");
+  close(archive_file_descriptor);
+
+  std::filesystem::remove(path);
+  return result;
+}
+
+// a necessary condition for a masked compare to pass, cheap enough to run at every offset
+auto PatternMatches(std::string_view pattern, std::span<const uint8_t> rom) -> bool {
+  if (rom.size() < pattern.size() / 2) return false;
+  for (size_t byte = 0; byte < pattern.size() / 2; byte++) {
+    const auto value = flirt::pattern_byte(pattern, byte);
+    if (value && *value != rom[byte]) return false;
+  }
+
+  return true;
+}
+
+template <typename F>
+auto Timed(F &&fn, std::chrono::nanoseconds &elapsed) {
+  const auto start = std::chrono::steady_clock::now();
+  auto result = fn();
+  elapsed = std::chrono::steady_clock::now() - start;
+  return result;
+}
+}  // namespace
+
+namespace oracle {
+auto make_case(uint32_t seed, synth_options options, uint64_t rom_size) -> oracle_case {
+  options.seed = seed;
+  oracle_case test{synth::planted_case(options, rom_size)};
+  test.seed = seed;
+  Mutate(test.library, test.rom, seed);
+  synth::reload(test);
+
+  test.splat = synth::bin_splat(test.rom);
+  test.paths = synth::file_paths(test.library);
+  auto archive = test.archive;
+  test.patterns = unique_section_patterns(archive_to_section_patterns(std::span{archive}));
+
+  return test;
+}
+
+auto reference_section_hits(std::vector<sig_object> const &sigFile, binary_info const &b_info, std::set<uint32_t> const &offsets)
+    -> std::vector<signature_hit> {
+  std::vector<signature_hit> hits;
+  for (auto rom_offset : offsets) {
+    const std::span<const uint8_t> rom_span(&b_info.m_Binary[rom_offset], b_info.m_Binary.size() - rom_offset);
+    for (uint32_t object = 0; object < sigFile.size(); object++) {
+      const auto &sections = sigFile[object].sections;
+      for (uint32_t section = 0; section < sections.size(); section++) {
+        const auto &sig_section = sections[section];
+        if (sig_section.name != ".text" || sig_section.crc_all == 0 || sig_section.duplicate_crc) continue;
+        if (TestSection(sig_section, rom_span, sigFile[object].arch)) hits.push_back(signature_hit{.object = object, .section = section, .rom_offset = rom_offset});
+      }
+    }
+  }
+
+  return hits;
+}
+
+auto reference_symbol_hits(std::vector<sig_object> const &sigFile, binary_info const &b_info, std::set<uint32_t> const &offsets,
+                           std::set<std::pair<uint32_t, uint32_t>> const &skip_sections) -> std::vector<signature_hit> {
+  std::vector<signature_hit> hits;
+  for (auto rom_offset : offsets) {
+    const std::span<const uint8_t> rom_span(&b_info.m_Binary[rom_offset], b_info.m_Binary.size() - rom_offset);
+    for (uint32_t object = 0; object < sigFile.size(); object++) {
+      const auto &sections = sigFile[object].sections;
+      for (uint32_t section = 0; section < sections.size(); section++) {
+        const auto &sig_section = sections[section];
+        if (sig_section.name != ".text" || skip_sections.contains({object, section})) continue;
+
+        for (uint32_t symbol = 0; symbol < sig_section.symbols.size(); symbol++) {
+          const auto &sig_sym = sig_section.symbols[symbol];
+          if (sig_sym.duplicate_crc || !TestSymbol(sig_sym, rom_span, sigFile[object].arch)) continue;
+          hits.push_back(signature_hit{.object = object, .section = section, .symbol = symbol, .rom_offset = rom_offset});
+        }
+      }
+    }
+  }
+
+  return hits;
+}
+
+auto reference_scan(oracle_case const &test) -> std::vector<splat_out> {
+  const auto section_hits = reference_section_hits(test.sigs, test.b_info, test.offsets);
+  const auto symbol_hits = reference_symbol_hits(test.sigs, test.b_info, test.offsets, MatchedSections(section_hits));
+
+  // guessing only reads the symbol map of the index
+  return GuessSections(test.sigs, test.strings, BuildSignatureIndex(test.sigs, test.strings), test.b_info, section_hits, symbol_hits);
+}
+
+auto reference_exhaustive_scan(oracle_case const &test) -> std::vector<splat_out> {
+  using candidate = struct candidate {
+    signature_hit hit;
+    std::string_view pattern;
+    bool section{};
+    bool anchored{};
+  };
+  // by first pattern byte, 0x100 for a wildcard, so a rom byte only visits the signatures it can start
+  std::array<std::vector<candidate>, 0x101> candidates;
+  auto add = [&candidates](candidate found) {
+    found.anchored = keyword_scan::keyword(found.pattern).has_value();
+    const auto first = found.pattern.empty() ? std::nullopt : flirt::pattern_byte(found.pattern, 0);
+    candidates[first ? size_t{*first} : size_t{0x100}].push_back(found);
+  };
+  flirt::for_each_signature(
+      test.sigs, [&add](sig_section const &section, signature_hit hit) { add(candidate{.hit = hit, .pattern = section.pattern, .section = true}); },
+      [&add](sig_symbol const &symbol, signature_hit hit) { add(candidate{.hit = hit, .pattern = symbol.pattern}); });
+
+  const auto &rom = test.b_info.m_Binary;
+  const bool halfwords = std::ranges::any_of(test.sigs, [](const sig_object &sig_obj) { return targets::halfwords(sig_obj.arch); });
+  std::vector<signature_hit> section_hits;
+  std::vector<signature_hit> symbol_hits;
+  for (uint64_t rom_offset = 0; rom_offset < rom.size(); rom_offset += halfwords ? 2 : 4) {
+    const auto rom_span = std::span{rom}.subspan(rom_offset);
+    for (const auto bucket : {size_t{rom[rom_offset]}, size_t{0x100}}) {
+      for (auto [hit, pattern, section, anchored] : candidates[bucket]) {
+        if (!anchored && !test.offsets.contains(static_cast<uint32_t>(rom_offset))) continue;
+        if (!PatternMatches(pattern, rom_span)) continue;
+
+        const auto &sig_obj = test.sigs[hit.object];
+        const auto &sig_section = sig_obj.sections[hit.section];
+        hit.rom_offset = static_cast<uint32_t>(rom_offset);
+        if (section && TestSection(sig_section, rom_span, sig_obj.arch)) section_hits.push_back(hit);
+        if (!section && TestSymbol(sig_section.symbols[hit.symbol], rom_span, sig_obj.arch)) symbol_hits.push_back(hit);
+      }
+    }
+  }
+
+  // same as reference_symbol_hits, symbols of sections that matched whole are not looked for
+  const auto matched = MatchedSections(section_hits);
+  std::erase_if(symbol_hits, [&matched](const signature_hit &hit) { return matched.contains({hit.object, hit.section}); });
+
+  return GuessSections(test.sigs, test.strings, BuildSignatureIndex(test.sigs, test.strings), test.b_info, section_hits, symbol_hits);
+}
+
+auto reference_match(oracle_case const &test) -> std::vector<splat_out> {
+  const std::span<const char> rom{reinterpret_cast<const char *>(test.rom.bytes.data()), test.rom.bytes.size()};
+  return matcher(test.splat, rom, test.patterns, test.paths, "synth");
+}
+
+auto engines() -> std::vector<oracle_engine> const & {
+  static const std::vector<oracle_engine> all{
+      oracle_engine{.name = "signature index",
+                    .family = oracle_family::objmatch,
+                    .run = [](oracle_case const &test) {
+                      return ProcessSignatureIndex(test.sigs, test.strings, BuildSignatureIndex(test.sigs, test.strings), test.b_info, test.offsets);
+                    }},
+      oracle_engine{.name = "flirt trie",
+                    .family = oracle_family::objmatch,
+                    .run = [](oracle_case const &test) {
+                      return ProcessSignatureTrie(test.sigs, test.strings, flirt::build(test.sigs), test.b_info, test.offsets);
+                    }},
+      oracle_engine{.name = "keyword scan",
+                    .family = oracle_family::objmatch_exhaustive,
+                    .run = [](oracle_case const &test) {
+                      return ProcessSignatureScan(test.sigs, test.strings, keyword_scan::build(test.sigs), test.b_info, {}, test.offsets);
+                    }},
+      oracle_engine{.name = "result cache, cold", .family = oracle_family::objmatch, .run = [](oracle_case const &test) { return Cached(test, 1); }},
+      // the second run reuses every chunk, the time covers both
+      oracle_engine{.name = "result cache, warm", .family = oracle_family::objmatch, .run = [](oracle_case const &test) { return Cached(test, 2); }},
+      oracle_engine{.name = "matcher, archive file", .family = oracle_family::matcher, .run = MatchArchiveFile},
+  };
+
+  return all;
+}
+
+auto compare(std::vector<splat_out> const &expect, std::vector<splat_out> const &actual) -> std::vector<std::string> {
+  std::vector<std::string> differences;
+  for (size_t entry = 0; entry < std::max(expect.size(), actual.size()); entry++) {
+    if (entry >= actual.size()) {
+      differences.push_back(std::format("{}: missing {}", entry, Describe(expect[entry])));
+    } else if (entry >= expect.size()) {
+      differences.push_back(std::format("{}: extra {}", entry, Describe(actual[entry])));
+    } else if (expect[entry] != actual[entry]) {
+      differences.push_back(std::format("{}: expected {}, got {}", entry, Describe(expect[entry]), Describe(actual[entry])));
+    }
+  }
+
+  return differences;
+}
+
+auto run(oracle_case const &test) -> std::vector<oracle_result> {
+  // by family
+  std::array<std::chrono::nanoseconds, 3> reference_times{};
+  const std::array references{
+      Timed([&test] { return reference_scan(test); }, reference_times[std::to_underlying(oracle_family::objmatch)]),
+      Timed([&test] { return reference_exhaustive_scan(test); }, reference_times[std::to_underlying(oracle_family::objmatch_exhaustive)]),
+      Timed([&test] { return reference_match(test); }, reference_times[std::to_underlying(oracle_family::matcher)]),
+  };
+
+  std::vector<oracle_result> results;
+  for (const auto &engine : engines()) {
+    const auto family = std::to_underlying(engine.family);
+    oracle_result result{.engine = engine.name, .seed = test.seed, .reference_time = reference_times[family]};
+    const auto actual = Timed([&engine, &test] { return engine.run(test); }, result.engine_time);
+    result.differences = compare(references[family], actual);
+    results.push_back(std::move(result));
+  }
+
+  return results;
+}
+}  // namespace oracle
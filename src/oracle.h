@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "file_path.h"
+#include "objmatch.h"
+#include "section_pattern.h"
+#include "signature.h"
+#include "signature_hit.h"
+#include "splat_out.h"
+#include "string_table.h"
+#include "synth.h"
+
+// differential testing of the matching engines against brute force references
+// on synthetic roms, any engine whose splat output differs from its reference is wrong
+
+// one synthetic rom with everything the engines take as input
+using oracle_case = struct oracle_case : synth_case {
+  uint32_t seed{};
+  std::vector<splat_out> splat;
+  std::vector<file_path> paths;
+  std::vector<section_pattern> patterns;
+};
+
+// objmatch engines are held to the heuristic offsets, exhaustive ones to every offset a function can start at
+enum class oracle_family : uint8_t { objmatch, objmatch_exhaustive, matcher };
+
+using oracle_engine = struct oracle_engine {
+  std::string name;
+  oracle_family family{};
+  std::function<std::vector<splat_out>(oracle_case const &)> run;
+};
+
+using oracle_result = struct oracle_result {
+  std::string engine;
+  uint32_t seed{};
+  // empty when the engine agreed with the reference
+  std::vector<std::string> differences;
+  std::chrono::nanoseconds reference_time{};
+  std::chrono::nanoseconds engine_time{};
+};
+
+namespace oracle {
+// planted objects, then a quarter of them get a changed instruction so they stop matching
+// and a quarter get different link addresses in their relocated fields so they still match
+auto make_case(uint32_t seed, synth_options options, uint64_t rom_size) -> oracle_case;
+
+// every offset against every unique .text section and symbol, no index
+auto reference_section_hits(std::vector<sig_object> const &sigFile, binary_info const &b_info, std::set<uint32_t> const &offsets)
+    -> std::vector<signature_hit>;
+auto reference_symbol_hits(std::vector<sig_object> const &sigFile, binary_info const &b_info, std::set<uint32_t> const &offsets,
+                           std::set<std::pair<uint32_t, uint32_t>> const &skip_sections) -> std::vector<signature_hit>;
+auto reference_scan(oracle_case const &test) -> std::vector<splat_out>;
+// every signature at every word aligned offset, and every halfword one for targets with halfword instructions
+// signatures without a keyword are only tried at the heuristic offsets, like keyword_scan::find_hits does
+auto reference_exhaustive_scan(oracle_case const &test) -> std::vector<splat_out>;
+// matcher as it is, patterns tried in order for every splat entry
+auto reference_match(oracle_case const &test) -> std::vector<splat_out>;
+
+// everything that must agree with a reference, new engines are added here
+auto engines() -> std::vector<oracle_engine> const &;
+
+// entry by entry, one line per difference
+auto compare(std::vector<splat_out> const &expect, std::vector<splat_out> const &actual) -> std::vector<std::string>;
+
+auto run(oracle_case const &test) -> std::vector<oracle_result>;
+}  // namespace oracle
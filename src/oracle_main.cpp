@@ -0,0 +1,73 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <print>
+#include <span>
+#include <string>
+
+#include "oracle.h"
+
+// the long running form of oracle_tests, new seeds until a difference or the iteration count
+auto main(int argc, const char *argv[]) -> int {
+  const std::span<const char *> args = {argv, static_cast<size_t>(argc)};
+
+  uint64_t iterations = 0;
+  uint32_t seed = 1;
+  synth_options options{.objects = 128, .frameless_percent = 10};
+  uint64_t rom_size = 0x1000000;
+  for (int argi = 1; argi < argc; argi++) {
+    if (args[argi][0] != '-' || strlen(&args[argi][1]) != 1 || args[argi][1] == 'h' || argi + 1 >= argc) {
+      std::print(
+          "oracle - compares the objmatch and matcher engines against brute force references\n\n"
+          "  Usage: oracle [options]\n\n"
+          "  Options:\n"
+          "    -n <count>        iterations, 0 runs until a difference (0)\n"
+          "    -s <seed>         first seed (1)\n"
+          "    -o <count>        objects per library (128)\n"
+          "    -r <bytes>        rom size (0x1000000)\n");
+      return EXIT_FAILURE;
+    }
+
+    const auto value = std::strtoull(args[argi + 1], nullptr, 0);
+    switch (args[argi][1]) {
+      case 'n': iterations = value; break;
+      case 's': seed = static_cast<uint32_t>(value); break;
+      case 'o': options.objects = static_cast<uint32_t>(value); break;
+      case 'r': rom_size = value; break;
+      default:
+        std::println("Error: Invalid switch '{}'", args[argi]);
+        return EXIT_FAILURE;
+    }
+    argi++;
+  }
+
+  using totals = struct totals {
+    std::chrono::nanoseconds reference{};
+    std::chrono::nanoseconds engine{};
+  };
+  std::map<std::string, totals> times;
+
+  bool failed = false;
+  for (uint64_t iteration = 0; !failed && (iterations == 0 || iteration < iterations); iteration++, seed++) {
+    const auto test = oracle::make_case(seed, options, rom_size);
+    for (const auto &result : oracle::run(test)) {
+      times[result.engine].reference += result.reference_time;
+      times[result.engine].engine += result.engine_time;
+      if (result.differences.empty()) continue;
+
+      failed = true;
+      std::println("seed {}, {} differs from the reference:", result.seed, result.engine);
+      for (const auto &difference : result.differences) std::println("  {}", difference);
+    }
+
+    std::println("seed {} {}", seed, failed ? "failed" : "ok");
+    for (const auto &[engine, time] : times) {
+      const auto speedup = time.engine.count() > 0 ? static_cast<double>(time.reference.count()) / static_cast<double>(time.engine.count()) : 0.0;
+      std::println("  {:<24} {:>10.3f}ms {:>8.2f}x", engine, std::chrono::duration<double, std::milli>(time.engine).count(), speedup);
+    }
+  }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,28 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <string>
+
+#include "oracle.h"
+
+TEST_CASE("every engine agrees with the reference", "[oracle]") {
+  const auto seed = GENERATE(range(1U, 5U));
+  const auto test = oracle::make_case(seed, synth_options{.objects = 24, .functions_per_object = 4, .frameless_percent = 10}, 0x80000);
+
+  for (const auto &result : oracle::run(test)) {
+    INFO("seed " << seed << ", " << result.engine);
+    for (const auto &difference : result.differences) UNSCOPED_INFO(difference);
+    CHECK(result.differences.empty());
+  }
+}
+
+TEST_CASE("compare reports entries by position", "[oracle]") {
+  std::vector<splat_out> expect{splat_out{.start = 0x1000, .vram = 0x1000, .type = ".text", .name = "a.o"},
+                                splat_out{.start = 0x2000, .vram = 0x2000, .type = ".text", .name = "b.o"}};
+  std::vector<splat_out> actual{splat_out{.start = 0x1000, .vram = 0x1000, .type = ".text", .name = "c.o"}};
+
+  auto differences = oracle::compare(expect, actual);
+
+  REQUIRE(differences.size() == 2);
+  REQUIRE(differences[0].starts_with("0: expected"));
+  REQUIRE(differences[1].starts_with("1: missing"));
+}
@@ -0,0 +1,104 @@
+#include "perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <mutex>
+
+namespace {
+constexpr std::array<uint64_t, static_cast<size_t>(perf_event::count)> event_configs{
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    // documented as usually last level cache misses
+    PERF_COUNT_HW_CACHE_MISSES,
+};
+
+bool counting = false;
+
+std::mutex reason_mutex;
+std::string reason;
+
+// perf events count the thread that opened them, so every thread gets its own group
+using perf_group = struct perf_group {
+  perf_group() {
+    for (size_t event = 0; event < fds.size(); event++) {
+      perf_event_attr attr{};
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = event_configs[event];
+      attr.disabled = event == 0 ? 1 : 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      fds[event] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, event == 0 ? -1 : fds[0], PERF_FLAG_FD_CLOEXEC));
+      if (fds[event] < 0) {
+        const std::lock_guard lock{reason_mutex};
+        if (reason.empty()) reason = std::format("perf_event_open failed: {}", std::strerror(errno));
+        close_all();
+        return;
+      }
+    }
+
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+  perf_group(const perf_group &) = delete;
+  auto operator=(const perf_group &) -> perf_group & = delete;
+  ~perf_group() { close_all(); }
+
+  auto read() const -> std::optional<perf_sample> {
+    if (fds[0] < 0) return std::nullopt;
+
+    struct {
+      uint64_t nr;
+      uint64_t time_enabled;
+      uint64_t time_running;
+      perf_sample values;
+    } group{};
+    if (::read(fds[0], &group, sizeof(group)) != static_cast<ssize_t>(sizeof(group)) || group.time_running == 0) return std::nullopt;
+
+    // more events than hardware counters are multiplexed, scale to the whole enabled time
+    perf_sample sample{};
+    for (size_t event = 0; event < sample.size(); event++) {
+      sample[event] = static_cast<uint64_t>(static_cast<double>(group.values[event]) * group.time_enabled / group.time_running);
+    }
+
+    return sample;
+  }
+
+ private:
+  auto close_all() -> void {
+    for (auto &fd : fds) {
+      if (fd >= 0) close(fd);
+      fd = -1;
+    }
+  }
+
+  std::array<int, static_cast<size_t>(perf_event::count)> fds{-1, -1, -1, -1};
+};
+}  // namespace
+
+namespace perf_counters {
+auto enable() -> void { counting = true; }
+
+auto enabled() -> bool { return counting; }
+
+auto read() -> std::optional<perf_sample> {
+  if (!counting) return std::nullopt;
+
+  thread_local const perf_group group;
+  return group.read();
+}
+
+auto unavailable_reason() -> std::string {
+  const std::lock_guard lock{reason_mutex};
+  return reason;
+}
+}  // namespace perf_counters
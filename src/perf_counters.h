@@ -0,0 +1,24 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// hardware counters from perf_event_open, read around each phase when -t is given
+// containers and locked down kernels often refuse them, the report then says why
+enum class perf_event : uint8_t { cycles, instructions, branch_misses, llc_misses, count };
+
+using perf_sample = std::array<uint64_t, static_cast<size_t>(perf_event::count)>;
+
+namespace perf_counters {
+// call before any worker thread starts
+auto enable() -> void;
+auto enabled() -> bool;
+
+// running totals for the calling thread, the group is opened on first use
+// nullopt when the counters are not available
+auto read() -> std::optional<perf_sample>;
+// empty while counters work or have not been tried
+auto unavailable_reason() -> std::string;
+}  // namespace perf_counters
@@ -0,0 +1,39 @@
+#include "prefilter.h"
+
+#include <algorithm>
+
+namespace {
+// odd constants from the parquet split block bloom filter, each picks the bit of one word
+constexpr std::array<uint32_t, 8> salt{0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                       0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+// keys are crc32c values, one multiply spreads them over a block index and a bit pattern
+auto Spread(uint32_t key) -> uint64_t { return key * 0x9E3779B97F4A7C15ULL; }
+
+auto Mask(uint32_t bits) -> prefilter::block {
+  prefilter::block mask{};
+  for (size_t word = 0; word < mask.words.size(); word++) mask.words[word] = 1U << ((bits * salt[word]) >> 27);
+  return mask;
+}
+}  // namespace
+
+prefilter::prefilter(size_t keys) : blocks(std::max<size_t>(1, (keys * 16 + 255) / 256)) {}
+
+auto prefilter::insert(uint32_t key) -> void {
+  const auto hash = Spread(key);
+  auto &target = blocks[((hash >> 32) * blocks.size()) >> 32];
+  const auto mask = Mask(static_cast<uint32_t>(hash));
+  for (size_t word = 0; word < mask.words.size(); word++) target.words[word] |= mask.words[word];
+}
+
+auto prefilter::may_contain(uint32_t key) const -> bool {
+  if (blocks.empty()) return false;
+
+  const auto hash = Spread(key);
+  const auto &target = blocks[((hash >> 32) * blocks.size()) >> 32];
+  const auto mask = Mask(static_cast<uint32_t>(hash));
+  // no early exit, the eight words compile to a few vector ops
+  uint32_t missing = 0;
+  for (size_t word = 0; word < mask.words.size(); word++) missing |= mask.words[word] & ~target.words[word];
+  return missing == 0;
+}
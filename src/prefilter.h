@@ -0,0 +1,26 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// split block bloom filter over prefix hashes (crc_8, crc_anchor)
+// a key sets one bit in each word of a single 32 byte block, so a probe reads one cache line
+// and most candidate offsets, which match nothing, are rejected without touching a scan_table
+// sized at 16 bits per key, a false positive is a wasted table lookup, never a missed match
+using prefilter = struct prefilter {
+  using block = struct alignas(32) block {
+    std::array<uint32_t, 8> words;
+  };
+
+  prefilter() = default;
+  explicit prefilter(size_t keys);
+
+  auto insert(uint32_t key) -> void;
+  // false only if key was never inserted, an empty filter contains nothing
+  auto may_contain(uint32_t key) const -> bool;
+
+ private:
+  std::vector<block> blocks;
+};
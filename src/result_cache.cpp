@@ -0,0 +1,140 @@
+#include "result_cache.h"
+
+#include <crc32c/crc32c.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <ryml.hpp>
+#include <ryml_std.hpp>
+
+namespace {
+// crc32c alone is too collision prone to trust a cached result with
+// so it is paired with a 64 bit multiplicative hash over words
+auto word_hash(uint64_t hash, std::span<const char> bytes) -> uint64_t {
+  constexpr uint64_t prime{0x100000001B3};
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t)) {
+    uint64_t word{};
+    std::memcpy(&word, &bytes[i], sizeof(uint64_t));
+    hash = (hash ^ word) * prime;
+  }
+  for (; i < bytes.size(); i++) hash = (hash ^ static_cast<uint8_t>(bytes[i])) * prime;
+
+  return hash;
+}
+
+auto hits_to_yaml(ryml::NodeRef node, const std::vector<signature_hit> &hits) -> void {
+  for (const auto &hit : hits) {
+    auto hit_yaml = node.append_child();
+    hit_yaml |= ryml::MAP;
+    hit_yaml |= c4::yml::_WIP_STYLE_FLOW_SL;
+    hit_yaml["object"] << hit.object;
+    hit_yaml["section"] << hit.section;
+    hit_yaml["symbol"] << hit.symbol;
+    hit_yaml["rom_offset"] << hit.rom_offset;
+  }
+}
+
+auto hits_from_yaml(ryml::ConstNodeRef node) -> std::vector<signature_hit> {
+  std::vector<signature_hit> hits;
+  hits.reserve(node.num_children());
+  std::transform(node.begin(), node.end(), std::back_inserter(hits), [](auto hit_yaml) -> signature_hit {
+    signature_hit hit{};
+    hit_yaml["object"] >> hit.object;
+    hit_yaml["section"] >> hit.section;
+    hit_yaml["symbol"] >> hit.symbol;
+    hit_yaml["rom_offset"] >> hit.rom_offset;
+    return hit;
+  });
+
+  return hits;
+}
+}  // namespace
+
+namespace result_cache {
+auto key(std::initializer_list<std::span<const char>> parts) -> std::string {
+  const std::span<const char> version_bytes{reinterpret_cast<const char *>(&version), sizeof(version)};
+  uint32_t crc = crc32c::Extend(0, reinterpret_cast<const uint8_t *>(version_bytes.data()), version_bytes.size());
+  uint64_t hash = word_hash(0xCBF29CE484222325, version_bytes);
+  for (const auto &part : parts) {
+    // sizes are hashed too, so moving bytes between parts changes the key
+    const uint64_t size{part.size()};
+    const std::span<const char> size_bytes{reinterpret_cast<const char *>(&size), sizeof(size)};
+    crc = crc32c::Extend(crc, reinterpret_cast<const uint8_t *>(size_bytes.data()), size_bytes.size());
+    crc = crc32c::Extend(crc, reinterpret_cast<const uint8_t *>(part.data()), part.size());
+    hash = word_hash(word_hash(hash, size_bytes), part);
+  }
+
+  return std::format("{:08x}{:016x}", crc, hash);
+}
+
+auto load(const std::filesystem::path &dir, const std::string &key) -> std::optional<std::vector<char>> {
+  const auto path = dir / key;
+  std::error_code error;
+  const auto file_size = std::filesystem::file_size(path, error);
+  if (error) return std::nullopt;
+
+  std::vector<char> bytes(file_size);
+  std::ifstream file{path, std::ios::binary};
+  file.read(bytes.data(), static_cast<std::streamsize>(file_size));
+  if (!file) return std::nullopt;
+
+  return bytes;
+}
+
+// written to a temporary name and renamed, so a concurrent run never reads a partial entry
+auto store(const std::filesystem::path &dir, const std::string &key, std::span<const char> bytes) -> void {
+  std::error_code error;
+  std::filesystem::create_directories(dir, error);
+  if (error) return;
+
+  const auto temp_path = dir / std::format("{}.{}.tmp", key, getpid());
+  {
+    std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!file) return;
+  }
+  std::filesystem::rename(temp_path, dir / key, error);
+}
+}  // namespace result_cache
+
+namespace chunk_hits_yaml {
+auto deserialize(std::vector<char> &bytes) -> std::vector<chunk_hits> {
+  ryml::Tree tree{ryml::parse_in_place(ryml::to_substr(bytes))};  // mutable (csubstr) overload
+
+  auto root{tree.crootref()};
+
+  std::vector<chunk_hits> chunks;
+  chunks.reserve(root.num_children());
+  std::transform(root.begin(), root.end(), std::back_inserter(chunks), [](auto chunk_yaml) -> chunk_hits {
+    chunk_hits chunk{};
+    chunk_yaml["start"] >> chunk.start;
+    chunk_yaml["crc"] >> chunk.crc;
+    chunk.section_hits = hits_from_yaml(chunk_yaml["section_hits"]);
+    chunk.symbol_hits = hits_from_yaml(chunk_yaml["symbol_hits"]);
+    return chunk;
+  });
+
+  return chunks;
+}
+
+auto serialize(const std::vector<chunk_hits> &chunks) -> std::vector<char> {
+  ryml::Tree tree;
+  auto root = tree.rootref();
+  root |= ryml::SEQ;
+
+  for (const auto &chunk : chunks) {
+    auto chunk_yaml = root.append_child();
+    chunk_yaml |= ryml::MAP;
+    chunk_yaml["start"] << chunk.start;
+    chunk_yaml["crc"] << chunk.crc;
+    hits_to_yaml(chunk_yaml.append_child({ryml::SEQ, "section_hits"}), chunk.section_hits);
+    hits_to_yaml(chunk_yaml.append_child({ryml::SEQ, "symbol_hits"}), chunk.symbol_hits);
+  }
+
+  return ryml::emitrs_yaml<std::vector<char>>(tree);
+}
+}  // namespace chunk_hits_yaml
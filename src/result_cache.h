@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "signature_hit.h"
+
+// hits found in one fixed size chunk of a rom
+// crc is of the chunk bytes and the lead in before them, so unchanged chunks can reuse their hits
+using chunk_hits = struct chunk_hits {
+  uint64_t start{};
+  uint32_t crc{};
+  std::vector<signature_hit> section_hits;
+  std::vector<signature_hit> symbol_hits;
+
+  auto operator==(const chunk_hits &x) const -> bool = default;
+};
+
+namespace result_cache {
+// chunk size used for partial reuse
+constexpr uint64_t chunk_size{0x10000};
+// bytes before a chunk that decide its candidate offsets, a jr ra and its delay slot start a function in the next chunk
+constexpr uint64_t chunk_lead_in{8};
+
+// part of every key, bump it when a change to the matchers changes their results for the same inputs
+// entries written by older builds then miss instead of being served
+constexpr uint32_t version{1};
+
+// content hash of everything a result depends on and of version, usable as a file name
+auto key(std::initializer_list<std::span<const char>> parts) -> std::string;
+
+auto load(const std::filesystem::path &dir, const std::string &key) -> std::optional<std::vector<char>>;
+auto store(const std::filesystem::path &dir, const std::string &key, std::span<const char> bytes) -> void;
+}  // namespace result_cache
+
+namespace chunk_hits_yaml {
+auto deserialize(std::vector<char> &bytes) -> std::vector<chunk_hits>;
+auto serialize(const std::vector<chunk_hits> &chunks) -> std::vector<char>;
+}  // namespace chunk_hits_yaml
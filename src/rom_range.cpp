@@ -0,0 +1,32 @@
+#include "rom_range.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+
+namespace {
+auto ParseOffset(std::string_view text) -> std::optional<uint64_t> {
+  // strtoull skips spaces and wraps a leading minus around, only digits may start an offset
+  if (text.empty() || std::isdigit(static_cast<unsigned char>(text.front())) == 0) return std::nullopt;
+
+  const std::string terminated{text};
+  char *end = nullptr;
+  errno = 0;
+  const auto value = std::strtoull(terminated.c_str(), &end, 0);
+  if (errno == ERANGE || end != terminated.c_str() + terminated.size()) return std::nullopt;
+
+  return value;
+}
+}  // namespace
+
+auto ParseRange(std::string_view range) -> std::optional<rom_range> {
+  const auto separator = range.find(':');
+  if (separator == std::string_view::npos) return std::nullopt;
+
+  const auto start = ParseOffset(range.substr(0, separator));
+  const auto end = ParseOffset(range.substr(separator + 1));
+  if (!start || !end || *start > *end) return std::nullopt;
+
+  return rom_range{.start = *start, .end = *end};
+}
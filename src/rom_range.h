@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// half open [start, end) window of rom offsets
+using rom_range = struct rom_range {
+  uint64_t start{};
+  uint64_t end{};
+
+  auto operator==(const rom_range &x) const -> bool = default;
+};
+
+// start:end, either side decimal or 0x prefixed hex, nullopt for anything else or a reversed range
+auto ParseRange(std::string_view range) -> std::optional<rom_range>;
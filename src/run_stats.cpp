@@ -0,0 +1,139 @@
+#include "run_stats.h"
+
+#include <sys/resource.h>
+
+#include <array>
+#include <atomic>
+#include <format>
+#include <iterator>
+
+#include "trace.h"
+
+namespace {
+constexpr std::array<std::string_view, static_cast<size_t>(stat_phase::count)> phase_names{
+    "rom_load",      "byte_swap",    "range_resolve", "candidate_scan", "signature_load", "index_build",
+    "section_match", "symbol_match", "guess_merge",   "archive_parse",  "anchor_select", "emit",
+};
+
+constexpr std::array<std::string_view, static_cast<size_t>(stat_counter::count)> counter_names{
+    "jr_ra_candidates",     "addiu_sp_candidates",  "keyword_candidates",  "prefilter_rejections", "crc_8_hits",
+    "crc_all_checks",       "section_hits",         "anchor_hits",         "symbol_checks",        "symbol_hits",
+    "trie_leaves",          "crc16_hits",           "fuzzy_checks",        "fuzzy_hits",           "hash_rejections",
+    "duplicate_rejections", "ambiguous_rejections", "conflicting_guesses", "confirmed_matches",    "objects",
+    "sections",             "symbols",              "unmasked_relocations",
+};
+
+// objmatch -a parses the archive on a worker thread, so the totals are shared
+std::array<std::atomic<uint64_t>, static_cast<size_t>(stat_phase::count)> phase_ns{};
+std::array<std::atomic<uint64_t>, static_cast<size_t>(stat_counter::count)> counters{};
+
+constexpr std::array<std::string_view, static_cast<size_t>(perf_event::count)> perf_event_names{
+    "cycles", "instructions", "branch_misses", "llc_misses",
+};
+std::array<std::array<std::atomic<uint64_t>, static_cast<size_t>(perf_event::count)>, static_cast<size_t>(stat_phase::count)> phase_perf{};
+
+auto peak_rss_kib() -> uint64_t {
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  // linux reports kilobytes
+  return static_cast<uint64_t>(usage.ru_maxrss);
+}
+}  // namespace
+
+namespace run_stats {
+auto add(stat_counter counter, uint64_t n) -> void { counters[static_cast<size_t>(counter)].fetch_add(n, std::memory_order_relaxed); }
+
+auto add(stat_phase phase, std::chrono::nanoseconds elapsed) -> void {
+  phase_ns[static_cast<size_t>(phase)].fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+}
+
+auto name(stat_phase phase) -> std::string_view { return phase_names[static_cast<size_t>(phase)]; }
+
+auto parse_format(std::string_view format) -> std::optional<stats_format> {
+  if (format == "text") return stats_format::text;
+  if (format == "json") return stats_format::json;
+  return std::nullopt;
+}
+
+auto report(stats_format format) -> std::string {
+  std::string out;
+  auto it = std::back_inserter(out);
+
+  if (format == stats_format::json) {
+    out += "{\"phases_ms\": {";
+    for (size_t phase = 0; phase < phase_names.size(); phase++) {
+      std::format_to(it, "{}\"{}\": {:.3f}", phase == 0 ? "" : ", ", phase_names[phase], static_cast<double>(phase_ns[phase].load()) / 1e6);
+    }
+    out += "}, \"counters\": {";
+    for (size_t counter = 0; counter < counter_names.size(); counter++) {
+      std::format_to(it, "{}\"{}\": {}", counter == 0 ? "" : ", ", counter_names[counter], counters[counter].load());
+    }
+    std::format_to(it, "}}, \"peak_rss_kib\": {}", peak_rss_kib());
+    if (perf_counters::enabled()) {
+      if (const auto reason = perf_counters::unavailable_reason(); !reason.empty()) {
+        out += ", \"hardware_unavailable\": \"";
+        out += reason;
+        out += '"';
+      } else {
+        out += ", \"hardware\": {";
+        for (size_t phase = 0; phase < phase_names.size(); phase++) {
+          std::format_to(it, "{}\"{}\": {{", phase == 0 ? "" : ", ", phase_names[phase]);
+          for (size_t event = 0; event < perf_event_names.size(); event++) {
+            std::format_to(it, "{}\"{}\": {}", event == 0 ? "" : ", ", perf_event_names[event], phase_perf[phase][event].load());
+          }
+          out += '}';
+        }
+        out += '}';
+      }
+    }
+    out += "}\n";
+    return out;
+  }
+
+  out += "phase                       ms\n";
+  for (size_t phase = 0; phase < phase_names.size(); phase++) {
+    std::format_to(it, "  {:<20} {:>10.3f}\n", phase_names[phase], static_cast<double>(phase_ns[phase].load()) / 1e6);
+  }
+  out += "counter\n";
+  for (size_t counter = 0; counter < counter_names.size(); counter++) {
+    std::format_to(it, "  {:<20} {:>10}\n", counter_names[counter], counters[counter].load());
+  }
+  std::format_to(it, "peak rss {} KiB\n", peak_rss_kib());
+
+  if (perf_counters::enabled()) {
+    if (const auto reason = perf_counters::unavailable_reason(); !reason.empty()) {
+      std::format_to(it, "hardware counters unavailable, {}\n", reason);
+    } else {
+      out += "hardware                cycles instructions    ipc branch_misses   llc_misses\n";
+      for (size_t phase = 0; phase < phase_names.size(); phase++) {
+        const auto &perf = phase_perf[phase];
+        const auto cycles = perf[static_cast<size_t>(perf_event::cycles)].load();
+        if (cycles == 0) continue;
+        const auto instructions = perf[static_cast<size_t>(perf_event::instructions)].load();
+        std::format_to(it, "  {:<16} {:>12} {:>12} {:>6.2f} {:>13} {:>12}\n", phase_names[phase], cycles, instructions,
+                       static_cast<double>(instructions) / static_cast<double>(cycles), perf[static_cast<size_t>(perf_event::branch_misses)].load(),
+                       perf[static_cast<size_t>(perf_event::llc_misses)].load());
+      }
+    }
+  }
+
+  return out;
+}
+}  // namespace run_stats
+
+phase_timer::phase_timer(stat_phase phase) : phase{phase}, perf_start{perf_counters::read()}, start{std::chrono::steady_clock::now()} {}
+
+phase_timer::~phase_timer() {
+  const auto end = std::chrono::steady_clock::now();
+  run_stats::add(phase, end - start);
+  if (perf_start) {
+    if (const auto perf_end = perf_counters::read()) {
+      auto &perf = phase_perf[static_cast<size_t>(phase)];
+      for (size_t event = 0; event < perf.size(); event++) {
+        // scaled multiplexed totals can step backwards by a little
+        if ((*perf_end)[event] > (*perf_start)[event]) perf[event].fetch_add((*perf_end)[event] - (*perf_start)[event], std::memory_order_relaxed);
+      }
+    }
+  }
+  if (trace::enabled()) trace::record("phase", run_stats::name(phase), trace::to_us(start), trace::to_us(end), std::nullopt);
+}
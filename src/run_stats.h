@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "perf_counters.h"
+
+// where a run spends its time, and how many candidates each filter lets through
+// collection is always on, it is a relaxed atomic add per event
+// the report is only printed with -t
+enum class stat_phase : uint8_t {
+  rom_load,
+  byte_swap,
+  range_resolve,
+  candidate_scan,
+  signature_load,
+  index_build,
+  section_match,
+  symbol_match,
+  guess_merge,
+  archive_parse,
+  anchor_select,
+  emit,
+  count
+};
+
+enum class stat_counter : uint8_t {
+  // likely function offsets, by the heuristic that found them
+  jr_ra_candidates,
+  addiu_sp_candidates,
+  // signature starts implied by keyword matches of the exhaustive scan
+  keyword_candidates,
+  // prefix hashes no signature has, rejected by a scan_table prefilter before its lookup
+  prefilter_rejections,
+  // whole .text sections, crc_8 index hits then masked compares of the whole section
+  crc_8_hits,
+  crc_all_checks,
+  section_hits,
+  // single symbols, anchor window hits then masked compares of the symbol
+  anchor_hits,
+  symbol_checks,
+  symbol_hits,
+  // flirt trie walks, leaves reached then leaves whose tail crc16 matched
+  trie_leaves,
+  crc16_hits,
+  // anchor hits that failed the full compare, scored by differing words, then those under the fuzzy threshold
+  fuzzy_checks,
+  fuzzy_hits,
+  // crc_all matched but the 64 bit hash did not, a crc32c collision
+  hash_rejections,
+  // signatures or matches dropped because they could not be told apart
+  duplicate_rejections,
+  ambiguous_rejections,
+  conflicting_guesses,
+  confirmed_matches,
+  objects,
+  sections,
+  symbols,
+  // relocations of types the object's target does not mask, their symbols keep link time bytes
+  unmasked_relocations,
+  count
+};
+
+enum class stats_format : uint8_t { text, json };
+
+namespace run_stats {
+auto add(stat_counter counter, uint64_t n = 1) -> void;
+auto add(stat_phase phase, std::chrono::nanoseconds elapsed) -> void;
+
+auto name(stat_phase phase) -> std::string_view;
+auto parse_format(std::string_view format) -> std::optional<stats_format>;
+// every phase and counter, plus the peak rss of the process
+// and hardware counters per phase when perf_counters are enabled
+auto report(stats_format format) -> std::string;
+}  // namespace run_stats
+
+// adds the time until it is destroyed to a phase, and to the trace when -T is given
+using phase_timer = struct phase_timer {
+  explicit phase_timer(stat_phase phase);
+  phase_timer(const phase_timer &) = delete;
+  auto operator=(const phase_timer &) -> phase_timer & = delete;
+  ~phase_timer();
+
+ private:
+  stat_phase phase;
+  std::optional<perf_sample> perf_start;
+  std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,155 @@
+#include "scan_table.h"
+
+#include <crc32c/crc32c.h>
+
+#include <algorithm>
+
+#include "run_stats.h"
+
+namespace {
+// hash of bytes with the masks applied, extended piecewise so the rom is never copied
+// masks are sorted by offset and do not overlap
+template <typename T, typename Extend>
+auto MaskedHash(std::span<const uint8_t> bytes, std::span<const scan_mask> masks, Extend extend) -> T {
+  T state = 0;
+  size_t pos = 0;
+  for (const auto &mask : masks) {
+    if (mask.offset >= bytes.size()) break;
+
+    state = extend(state, bytes.data() + pos, mask.offset - pos);
+    const auto length = std::min<size_t>(mask.keep.size(), bytes.size() - mask.offset);
+    std::array<uint8_t, 4> word{};
+    for (size_t byte = 0; byte < length; byte++) word[byte] = bytes[mask.offset + byte] & mask.keep[byte];
+    state = extend(state, word.data(), length);
+    pos = mask.offset + length;
+  }
+
+  return extend(state, bytes.data() + pos, bytes.size() - pos);
+}
+
+auto MaskedCrc(std::span<const uint8_t> bytes, std::span<const scan_mask> masks) -> uint32_t {
+  return MaskedHash<uint32_t>(bytes, masks, crc32c::Extend);
+}
+
+// a word relocated twice is masked by both, relocated fields are whole instructions or pool words so nothing else overlaps
+auto Normalize(std::vector<scan_mask> masks) -> std::vector<scan_mask> {
+  std::ranges::stable_sort(masks, {}, &scan_mask::offset);
+  std::vector<scan_mask> merged;
+  for (const auto &mask : masks) {
+    if (!merged.empty() && merged.back().offset == mask.offset) {
+      for (size_t byte = 0; byte < mask.keep.size(); byte++) merged.back().keep[byte] &= mask.keep[byte];
+      continue;
+    }
+    merged.push_back(mask);
+  }
+
+  return merged;
+}
+}  // namespace
+
+auto scan_table::equal_range(uint32_t key) const -> std::pair<uint32_t, uint32_t> {
+  const auto [first, last] = std::ranges::equal_range(keys, key);
+  return {static_cast<uint32_t>(first - keys.begin()), static_cast<uint32_t>(last - keys.begin())};
+}
+
+auto scan_table::test(uint32_t row, std::span<const uint8_t> buffer) const -> bool {
+  const auto size = sizes[row];
+  if (buffer.size() < size) return false;
+
+  const std::span<const scan_mask> row_masks{masks.begin() + mask_begin[row], masks.begin() + mask_begin[row + 1]};
+  const auto bytes = buffer.first(size);
+  if (MaskedCrc(bytes.first(std::min<uint32_t>(size, 8)), row_masks) != crc_8[row]) return false;
+  if (MaskedCrc(bytes, row_masks) != crc_all[row]) return false;
+  if (hash[row] == sig_hash::none) return true;
+
+  const auto kind = hash[row];
+  const auto extend = [kind](uint64_t state, const uint8_t *data, size_t size) { return hash64::extend(kind, state, data, size); };
+  if (MaskedHash<uint64_t>(bytes, row_masks, extend) == hash_all[row]) return true;
+  run_stats::add(stat_counter::hash_rejections);
+  return false;
+}
+
+namespace scan_tables {
+auto mask(uint64_t type, uint64_t offset, target_arch arch) -> std::optional<scan_mask> {
+  // R_MIPS_26 keeps the opcode, R_MIPS_HI16 and R_MIPS_LO16 keep opcode and registers
+  const auto keep = targets::keep(arch, type);
+  if (std::ranges::all_of(keep, [](uint8_t byte) { return byte == 0xFF; })) return std::nullopt;
+
+  return scan_mask{.offset = static_cast<uint32_t>(offset), .keep = keep};
+}
+
+auto section_masks(sig_section const &section, target_arch arch) -> std::vector<scan_mask> {
+  std::vector<scan_mask> masks;
+  // objsig only masks relocations that fall inside a symbol
+  for (const auto &symbol : section.symbols) {
+    for (const auto &rel : symbol.relocations) {
+      if (auto masked = mask(rel.type, symbol.offset + rel.offset, arch)) masks.push_back(*masked);
+    }
+  }
+
+  return Normalize(std::move(masks));
+}
+
+auto symbol_masks(sig_symbol const &symbol, target_arch arch) -> std::vector<scan_mask> {
+  std::vector<scan_mask> masks;
+  for (const auto &rel : symbol.relocations) {
+    if (auto masked = mask(rel.type, rel.offset, arch)) masks.push_back(*masked);
+  }
+
+  return Normalize(std::move(masks));
+}
+
+auto section_row(sig_section const &section, uint32_t key, signature_hit hit, target_arch arch) -> scan_row {
+  scan_row row{.key = key,
+               .crc_8 = section.crc_8,
+               .crc_all = section.crc_all,
+               .hash = section.hash,
+               .hash_all = section.hash_all,
+               .size = static_cast<uint32_t>(section.size),
+               .hit = hit};
+  row.masks = section_masks(section, arch);
+
+  return row;
+}
+
+auto symbol_row(sig_symbol const &symbol, uint32_t key, signature_hit hit, target_arch arch) -> scan_row {
+  scan_row row{.key = key,
+               .crc_8 = symbol.crc_8,
+               .crc_all = symbol.crc_all,
+               .hash = symbol.hash,
+               .hash_all = symbol.hash_all,
+               .size = static_cast<uint32_t>(symbol.size),
+               .hit = hit};
+  row.masks = symbol_masks(symbol, arch);
+
+  return row;
+}
+
+auto compile(std::vector<scan_row> rows) -> scan_table {
+  std::ranges::stable_sort(rows, {}, &scan_row::key);
+
+  scan_table table{.filter = prefilter{rows.size()}};
+  table.keys.reserve(rows.size());
+  table.crc_8.reserve(rows.size());
+  table.crc_all.reserve(rows.size());
+  table.hash.reserve(rows.size());
+  table.hash_all.reserve(rows.size());
+  table.sizes.reserve(rows.size());
+  table.mask_begin.reserve(rows.size() + 1);
+  table.hits.reserve(rows.size());
+  for (const auto &row : rows) {
+    table.keys.push_back(row.key);
+    table.filter.insert(row.key);
+    table.crc_8.push_back(row.crc_8);
+    table.crc_all.push_back(row.crc_all);
+    table.hash.push_back(row.hash);
+    table.hash_all.push_back(row.hash_all);
+    table.sizes.push_back(row.size);
+    table.masks.insert(table.masks.end(), row.masks.begin(), row.masks.end());
+    table.mask_begin.push_back(static_cast<uint32_t>(table.masks.size()));
+    table.hits.push_back(row.hit);
+  }
+
+  return table;
+}
+}  // namespace scan_tables
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "prefilter.h"
+#include "signature.h"
+#include "signature_hit.h"
+#include "target.h"
+
+// bytes of a relocated word that survive masking, in rom byte order
+using scan_mask = struct scan_mask {
+  uint32_t offset{};
+  std::array<uint8_t, 4> keep{};
+};
+
+// sections or symbols compiled for the candidate loop, one row each
+// struct of arrays sorted by key, a lookup binary searches the keys and reads the other arrays
+// only for the rows it found, names and the sig_* objects are only touched for confirmed hits
+using scan_table = struct scan_table {
+  // prefix hash a candidate is looked up by, crc_8 or crc_anchor
+  std::vector<uint32_t> keys;
+  // every key, checked before the binary search
+  prefilter filter;
+  std::vector<uint32_t> crc_8;
+  std::vector<uint32_t> crc_all;
+  // only read for rows whose crc_all matched
+  std::vector<sig_hash> hash;
+  std::vector<uint64_t> hash_all;
+  std::vector<uint32_t> sizes;
+  // masks of row r are masks[mask_begin[r], mask_begin[r + 1])
+  std::vector<uint32_t> mask_begin{0};
+  std::vector<scan_mask> masks;
+  // where the row came from, rom_offset unset
+  std::vector<signature_hit> hits;
+
+  auto size() const -> uint32_t { return static_cast<uint32_t>(keys.size()); }
+  // rows [first, last) with this key
+  auto equal_range(uint32_t key) const -> std::pair<uint32_t, uint32_t>;
+  // same result as TestSection or TestSymbol of the signature the row was built from
+  auto test(uint32_t row, std::span<const uint8_t> buffer) const -> bool;
+};
+
+// a row before the table is compiled
+using scan_row = struct scan_row {
+  uint32_t key{};
+  uint32_t crc_8{};
+  uint32_t crc_all{};
+  sig_hash hash{};
+  uint64_t hash_all{};
+  uint32_t size{};
+  std::vector<scan_mask> masks;
+  signature_hit hit;
+};
+
+namespace scan_tables {
+// the mask of a relocation, nullopt for types the signatures do not mask
+// arch is that of the signature's object, a table can mix targets since the masks are bytes
+auto mask(uint64_t type, uint64_t offset, target_arch arch = target_arch::mips_be) -> std::optional<scan_mask>;
+
+// every mask of a signature, sorted by offset and merged where relocations share a word
+auto section_masks(sig_section const &section, target_arch arch = target_arch::mips_be) -> std::vector<scan_mask>;
+auto symbol_masks(sig_symbol const &symbol, target_arch arch = target_arch::mips_be) -> std::vector<scan_mask>;
+
+auto section_row(sig_section const &section, uint32_t key, signature_hit hit, target_arch arch = target_arch::mips_be) -> scan_row;
+auto symbol_row(sig_symbol const &symbol, uint32_t key, signature_hit hit, target_arch arch = target_arch::mips_be) -> scan_row;
+
+// sorts by key, rows with equal keys keep their order
+auto compile(std::vector<scan_row> rows) -> scan_table;
+}  // namespace scan_tables
@@ -41,6 +41,10 @@ auto serialize(const std::vector<section_pattern> &patterns) -> std::vector<char
     pattern_yaml |= ryml::MAP;
     pattern_yaml["object"] << pattern.object;
     pattern_yaml["section"] << pattern.section;
+    if (pattern.arch != target_arch::mips_be) {
+      const auto arch = targets::name(pattern.arch);
+      pattern_yaml["arch"] << ryml::csubstr{arch.data(), arch.size()};
+    }
     pattern_yaml["size"] << std::format("0x{:x}", pattern.size);
     pattern_yaml["crc_8"] << std::format("0x{:x}", pattern.crc_8);
     pattern_yaml["crc_all"] << std::format("0x{:x}", pattern.crc_all);
@@ -2,6 +2,8 @@
 #include <cstdint>
 #include <string>
 
+#include "target.h"
+
 using sec_relocation = struct sec_relocation {
   uint64_t type{};
   uint64_t offset{};
@@ -14,6 +16,8 @@ using sec_relocation = struct sec_relocation {
 using section_pattern = struct section_pattern {
   std::string object;
   std::string section;
+  // relocations are masked the way this target lays them out
+  target_arch arch{};
   uint64_t size{};
   uint32_t crc_8{};
   uint32_t crc_all{};
@@ -0,0 +1,157 @@
+#include "serve_protocol.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <ryml.hpp>
+#include <ryml_std.hpp>
+
+namespace {
+// frames are bounded so a bad length can not make the server allocate the world
+constexpr uint32_t max_payload{64 * 1024 * 1024};
+
+// a peer that hung up is an error return, not a SIGPIPE that kills the server
+auto write_all(int fd, std::span<const char> bytes) -> bool {
+  while (!bytes.empty()) {
+    const auto written = ::send(fd, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return false;
+    bytes = bytes.subspan(static_cast<size_t>(written));
+  }
+
+  return true;
+}
+
+auto read_all(int fd, std::span<char> bytes) -> bool {
+  while (!bytes.empty()) {
+    const auto got = ::read(fd, bytes.data(), bytes.size());
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) return false;
+    bytes = bytes.subspan(static_cast<size_t>(got));
+  }
+
+  return true;
+}
+
+auto socket_address(const std::string &path) -> std::optional<sockaddr_un> {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    errno = ENAMETOOLONG;
+    return std::nullopt;
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  return address;
+}
+}  // namespace
+
+namespace serve_protocol {
+auto write_frame(int fd, frame_status status, std::span<const char> payload) -> bool {
+  if (payload.size() > max_payload) return false;
+
+  std::array<char, sizeof(uint32_t) + 1> header{};
+  const auto size = static_cast<uint32_t>(payload.size());
+  std::memcpy(header.data(), &size, sizeof(size));
+  header[sizeof(uint32_t)] = static_cast<char>(status);
+
+  return write_all(fd, header) && write_all(fd, payload);
+}
+
+auto read_frame(int fd) -> std::optional<std::pair<frame_status, std::vector<char>>> {
+  std::array<char, sizeof(uint32_t) + 1> header{};
+  if (!read_all(fd, header)) return std::nullopt;
+
+  uint32_t size{};
+  std::memcpy(&size, header.data(), sizeof(size));
+  const auto status = static_cast<frame_status>(header[sizeof(uint32_t)]);
+  if (size > max_payload || (status != frame_status::ok && status != frame_status::error)) return std::nullopt;
+
+  std::vector<char> payload(size);
+  if (!read_all(fd, payload)) return std::nullopt;
+
+  return std::pair{status, std::move(payload)};
+}
+
+auto listen_socket(const std::string &path) -> int {
+  const auto address = socket_address(path);
+  if (!address) return -1;
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+
+  // a socket file left by an earlier server would make bind fail
+  ::unlink(path.c_str());
+  if (::bind(fd, reinterpret_cast<const sockaddr *>(&*address), sizeof(*address)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+    const int error = errno;
+    ::close(fd);
+    errno = error;
+    return -1;
+  }
+
+  return fd;
+}
+
+auto connect_socket(const std::string &path) -> int {
+  const auto address = socket_address(path);
+  if (!address) return -1;
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+
+  if (::connect(fd, reinterpret_cast<const sockaddr *>(&*address), sizeof(*address)) != 0) {
+    const int error = errno;
+    ::close(fd);
+    errno = error;
+    return -1;
+  }
+
+  return fd;
+}
+}  // namespace serve_protocol
+
+namespace scan_request_yaml {
+auto deserialize(std::vector<char> &bytes) -> scan_request {
+  ryml::Tree tree{ryml::parse_in_place(ryml::to_substr(bytes))};  // mutable (csubstr) overload
+  const auto root = tree.crootref();
+
+  scan_request request;
+  root["rom_path"] >> request.rom_path;
+  if (root.has_child("splat_path")) root["splat_path"] >> request.splat_path;
+  if (root.has_child("ranges")) {
+    for (const auto range_yaml : root["ranges"]) {
+      rom_range range{};
+      range_yaml["start"] >> range.start;
+      range_yaml["end"] >> range.end;
+      request.ranges.push_back(range);
+    }
+  }
+
+  return request;
+}
+
+auto serialize(const scan_request &request) -> std::vector<char> {
+  ryml::Tree tree;
+  auto root = tree.rootref();
+  root |= ryml::MAP;
+  root["rom_path"] << request.rom_path;
+  if (!request.splat_path.empty()) root["splat_path"] << request.splat_path;
+  if (!request.ranges.empty()) {
+    auto ranges_yaml = root["ranges"];
+    ranges_yaml |= ryml::SEQ;
+    for (const auto &range : request.ranges) {
+      auto range_yaml = ranges_yaml.append_child();
+      range_yaml |= ryml::MAP;
+      range_yaml |= c4::yml::_WIP_STYLE_FLOW_SL;
+      range_yaml["start"] << range.start;
+      range_yaml["end"] << range.end;
+    }
+  }
+
+  return ryml::emitrs_yaml<std::vector<char>>(tree);
+}
+}  // namespace scan_request_yaml
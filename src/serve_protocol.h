@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rom_range.h"
+
+// objmatch -s keeps a signature index warm and answers scans over a unix socket
+// every message is one frame: [uint32 payload length][uint8 status][payload]
+enum class frame_status : uint8_t { ok, error };
+
+// a scan as objmatch would run it from the command line, paths are absolute
+using scan_request = struct scan_request {
+  std::string rom_path;
+  std::string splat_path;
+  std::vector<rom_range> ranges;
+
+  auto operator==(const scan_request &x) const -> bool = default;
+};
+
+namespace serve_protocol {
+auto write_frame(int fd, frame_status status, std::span<const char> payload) -> bool;
+auto read_frame(int fd) -> std::optional<std::pair<frame_status, std::vector<char>>>;
+
+// returns the listening / connected socket, or -1 with errno set
+auto listen_socket(const std::string &path) -> int;
+auto connect_socket(const std::string &path) -> int;
+}  // namespace serve_protocol
+
+namespace scan_request_yaml {
+auto deserialize(std::vector<char> &bytes) -> scan_request;
+auto serialize(const scan_request &request) -> std::vector<char>;
+}  // namespace scan_request_yaml
@@ -4,25 +4,147 @@
 #include <print>
 #include <ryml.hpp>
 #include <ryml_std.hpp>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace sig_yaml {
-auto deserialize(std::vector<char> &bytes) -> std::vector<sig_object> {
+namespace {
+auto Name(ryml::ConstNodeRef node, std::pmr::memory_resource *arena) -> std::pmr::string {
+  const auto val = node.val();
+  return {val.data(), val.size(), arena};
+}
+
+auto Yaml(std::pmr::string const &str) -> ryml::csubstr { return {str.data(), str.size()}; }
+
+// older signature files have no 64 bit hash, and a hash this build does not know is ignored
+auto ReadHash(ryml::ConstNodeRef node, sig_hash &hash, uint64_t &hash_all) -> void {
+  if (!node.has_child("hash") || !node.has_child("hash_all")) return;
+  const auto val = node["hash"].val();
+  const auto kind = hash64::parse({val.data(), val.size()});
+  if (!kind || *kind == sig_hash::none) return;
+  hash = *kind;
+  node["hash_all"] >> hash_all;
+}
+
+auto WriteHash(ryml::NodeRef node, sig_hash hash, uint64_t hash_all) -> void {
+  if (hash == sig_hash::none) return;
+  const auto name = hash64::name(hash);
+  node["hash"] << ryml::csubstr{name.data(), name.size()};
+  node["hash_all"] << hash_all;
+}
+
+// older signature files are all big endian mips, the default that is never written
+auto WriteArch(ryml::NodeRef node, target_arch arch) -> void {
+  if (arch == target_arch::mips_be) return;
+  const auto name = targets::name(arch);
+  node["arch"] << ryml::csubstr{name.data(), name.size()};
+}
+
+// older signature files have no flirt pattern
+auto ReadPattern(ryml::ConstNodeRef node, std::pmr::memory_resource *arena, std::pmr::string &pattern, uint16_t &tail_size, uint16_t &crc16)
+    -> void {
+  if (!node.has_child("pattern")) return;
+  pattern = Name(node["pattern"], arena);
+  node["tail_size"] >> tail_size;
+  node["crc16"] >> crc16;
+}
+
+auto WritePattern(ryml::NodeRef node, std::pmr::string const &pattern, uint16_t tail_size, uint16_t crc16) -> void {
+  if (pattern.empty()) return;
+  node["pattern"] << Yaml(pattern);
+  node["tail_size"] << tail_size;
+  node["crc16"] << crc16;
+}
+
+// upper case, like the patterns flirt writes
+constexpr std::string_view hex_digits{"0123456789ABCDEF"};
+
+auto Hex(std::span<const uint8_t> bytes) -> std::string {
+  std::string hex;
+  hex.reserve(bytes.size() * 2);
+  for (auto byte : bytes) {
+    hex += hex_digits[byte >> 4];
+    hex += hex_digits[byte & 0xF];
+  }
+  return hex;
+}
+
+auto Unhex(ryml::csubstr hex) -> std::vector<uint8_t> {
+  std::vector<uint8_t> bytes;
+  bytes.reserve(hex.size() / 2);
+  for (size_t pos = 0; pos + 1 < hex.size(); pos += 2) {
+    const auto high = hex_digits.find(hex[pos]);
+    const auto low = hex_digits.find(hex[pos + 1]);
+    // malformed, the caller treats it as missing
+    if (high == std::string_view::npos || low == std::string_view::npos) return {};
+    bytes.push_back(static_cast<uint8_t>(high << 4 | low));
+  }
+  return bytes;
+}
+
+auto ReadWords(ryml::ConstNodeRef node, std::pmr::vector<uint32_t> &words) -> void {
+  if (!node.has_child("words")) return;
+  const auto bytes = Unhex(node["words"].val());
+  words.reserve(bytes.size() / 4);
+  for (size_t byte = 0; byte + 3 < bytes.size(); byte += 4) {
+    words.push_back(static_cast<uint32_t>(bytes[byte]) << 24 | static_cast<uint32_t>(bytes[byte + 1]) << 16 |
+                    static_cast<uint32_t>(bytes[byte + 2]) << 8 | static_cast<uint32_t>(bytes[byte + 3]));
+  }
+}
+
+auto WriteWords(ryml::NodeRef node, std::pmr::vector<uint32_t> const &words) -> void {
+  if (words.empty()) return;
+  std::vector<uint8_t> bytes;
+  bytes.reserve(words.size() * 4);
+  for (auto word : words) {
+    for (int shift = 24; shift >= 0; shift -= 8) bytes.push_back(static_cast<uint8_t>(word >> shift));
+  }
+  node["words"] << Hex(bytes);
+}
+}  // namespace
+
+auto deserialize(std::vector<char> &bytes, std::pmr::memory_resource *arena, std::vector<uint8_t> *flirt) -> std::vector<sig_object> {
   ryml::Tree tree{ryml::parse_in_place(ryml::to_substr(bytes))};  // mutable (csubstr) overload
 
   auto root{tree.crootref()};
 
+  // every level is sized before it is filled, so the arena is not left holding outgrown vectors
   std::vector<sig_object> sig_objs;
-  std::transform(root.begin(), root.end(), std::back_inserter(sig_objs), [](auto obj_yaml) -> sig_object {
+  sig_objs.reserve(root.num_children());
+  for (auto obj_yaml : root) {
+    // the compiled flirt trie follows the objects
+    if (!obj_yaml.has_child("file")) {
+      if (flirt != nullptr && obj_yaml.has_child("flirt")) *flirt = Unhex(obj_yaml["flirt"].val());
+      continue;
+    }
+
+    // an object for a target this build does not know can not be masked, it is left out
+    auto arch = target_arch::mips_be;
+    if (obj_yaml.has_child("arch")) {
+      const auto val = obj_yaml["arch"].val();
+      const auto parsed = targets::parse({val.data(), val.size()});
+      if (!parsed) {
+        const auto file = obj_yaml["file"].val();
+        std::println(stderr, "Skipping {}, unknown arch {}", std::string_view(file.data(), file.size()), std::string_view(val.data(), val.size()));
+        continue;
+      }
+      arch = *parsed;
+    }
+
     auto sections{obj_yaml["sections"]};
-    std::vector<sig_section> sig_sections;
-    std::transform(sections.begin(), sections.end(), std::back_inserter(sig_sections), [](auto obj_yaml_section) -> sig_section {
+    std::pmr::vector<sig_section> sig_sections{arena};
+    sig_sections.reserve(sections.num_children());
+    for (auto obj_yaml_section : sections) {
       auto symbols{obj_yaml_section["symbols"]};
-      std::vector<sig_symbol> sig_symbols;
-      std::transform(symbols.begin(), symbols.end(), std::back_inserter(sig_symbols), [](auto obj_yaml_symbol) -> sig_symbol {
+      std::pmr::vector<sig_symbol> sig_symbols{arena};
+      sig_symbols.reserve(symbols.num_children());
+      for (auto obj_yaml_symbol : symbols) {
         auto relocations{obj_yaml_symbol["relocations"]};
-        std::vector<sig_relocation> sig_relocations;
-        std::transform(relocations.begin(), relocations.end(), std::back_inserter(sig_relocations), [](auto obj_yaml_relocation) -> sig_relocation {
+        std::pmr::vector<sig_relocation> sig_relocations{arena};
+        sig_relocations.reserve(relocations.num_children());
+        for (auto obj_yaml_relocation : relocations) {
           uint64_t type{};
           obj_yaml_relocation["type"] >> type;
           uint64_t offset{};
@@ -31,11 +153,10 @@ auto deserialize(std::vector<char> &bytes) -> std::vector<sig_object> {
           obj_yaml_relocation["addend"] >> addend;
           bool local{};
           obj_yaml_relocation["local"] >> local;
-          std::string name;
-          obj_yaml_relocation["name"] >> name;
 
-          return sig_relocation{.type = type, .offset = offset, .addend = addend, .local = local, .name{name}};
-        });
+          sig_relocations.push_back(
+              sig_relocation{.type = type, .offset = offset, .addend = addend, .local = local, .name = Name(obj_yaml_relocation["name"], arena)});
+        }
 
         uint64_t offset{};
         obj_yaml_symbol["offset"] >> offset;
@@ -45,32 +166,80 @@ auto deserialize(std::vector<char> &bytes) -> std::vector<sig_object> {
         obj_yaml_symbol["crc_8"] >> crc_8;
         uint32_t crc_all{};
         obj_yaml_symbol["crc_all"] >> crc_all;
+        // older signature files have no anchor
+        uint64_t anchor_offset{};
+        if (obj_yaml_symbol.has_child("anchor_offset")) obj_yaml_symbol["anchor_offset"] >> anchor_offset;
+        uint64_t anchor_size{};
+        if (obj_yaml_symbol.has_child("anchor_size")) obj_yaml_symbol["anchor_size"] >> anchor_size;
+        uint32_t crc_anchor{};
+        if (obj_yaml_symbol.has_child("crc_anchor")) obj_yaml_symbol["crc_anchor"] >> crc_anchor;
+        sig_hash hash{};
+        uint64_t hash_all{};
+        ReadHash(obj_yaml_symbol, hash, hash_all);
         bool duplicate_crc{};
         obj_yaml_symbol["duplicate_crc"] >> duplicate_crc;
-        std::string symbol{};
-        obj_yaml_symbol["symbol"] >> symbol;
+        std::pmr::string pattern{arena};
+        uint16_t tail_size{};
+        uint16_t crc16{};
+        ReadPattern(obj_yaml_symbol, arena, pattern, tail_size, crc16);
+        std::pmr::vector<uint32_t> words{arena};
+        ReadWords(obj_yaml_symbol, words);
 
-        return sig_symbol{
-            .offset = offset, .size = size, .crc_8 = crc_8, .crc_all = crc_all, .duplicate_crc = duplicate_crc, .symbol{symbol}, .relocations{sig_relocations}};
-      });
+        sig_symbols.push_back(sig_symbol{.offset = offset,
+                                         .size = size,
+                                         .crc_8 = crc_8,
+                                         .crc_all = crc_all,
+                                         .hash = hash,
+                                         .hash_all = hash_all,
+                                         .anchor_offset = anchor_offset,
+                                         .anchor_size = anchor_size,
+                                         .crc_anchor = crc_anchor,
+                                         .duplicate_crc = duplicate_crc,
+                                         .pattern = std::move(pattern),
+                                         .tail_size = tail_size,
+                                         .crc16 = crc16,
+                                         .words = std::move(words),
+                                         .symbol = Name(obj_yaml_symbol["symbol"], arena),
+                                         .relocations = std::move(sig_relocations)});
+      }
 
       uint64_t size{};
       obj_yaml_section["size"] >> size;
-      std::string name;
-      obj_yaml_section["name"] >> name;
+      // older signature files have no section hashes
+      uint32_t crc_8{};
+      if (obj_yaml_section.has_child("crc_8")) obj_yaml_section["crc_8"] >> crc_8;
+      uint32_t crc_all{};
+      if (obj_yaml_section.has_child("crc_all")) obj_yaml_section["crc_all"] >> crc_all;
+      sig_hash hash{};
+      uint64_t hash_all{};
+      ReadHash(obj_yaml_section, hash, hash_all);
+      bool duplicate_crc{};
+      if (obj_yaml_section.has_child("duplicate_crc")) obj_yaml_section["duplicate_crc"] >> duplicate_crc;
+      std::pmr::string pattern{arena};
+      uint16_t tail_size{};
+      uint16_t crc16{};
+      ReadPattern(obj_yaml_section, arena, pattern, tail_size, crc16);
 
-      return sig_section{.size = size, .name{name}, .symbols{sig_symbols}};
-    });
+      sig_sections.push_back(sig_section{.size = size,
+                                         .crc_8 = crc_8,
+                                         .crc_all = crc_all,
+                                         .hash = hash,
+                                         .hash_all = hash_all,
+                                         .duplicate_crc = duplicate_crc,
+                                         .pattern = std::move(pattern),
+                                         .tail_size = tail_size,
+                                         .crc16 = crc16,
+                                         .name = Name(obj_yaml_section["name"], arena),
+                                         .symbols = std::move(sig_symbols)});
+    }
 
-    std::string file;
-    obj_yaml["file"] >> file;
-    return sig_object{.file{file}, .sections{sig_sections}};
-  });
+    sig_objs.push_back(sig_object{.file = Name(obj_yaml["file"], arena), .arch = arch, .sections = std::move(sig_sections)});
+  }
 
   return sig_objs;
 }
 
-auto serialize(const std::vector<sig_object> &sig_objs) -> std::vector<char> {
+auto serialize(const std::vector<sig_object> &sig_objs, std::span<const uint8_t> flirt) -> std::vector<char> {
   ryml::Tree tree;
   auto root = tree.rootref();
   root |= ryml::SEQ;
@@ -78,14 +247,20 @@ auto serialize(const std::vector<sig_object> &sig_objs) -> std::vector<char> {
   for (const auto &sig_obj : sig_objs) {
     auto obj_yaml = root.append_child();
     obj_yaml |= ryml::MAP;
-    obj_yaml["file"] << sig_obj.file;
+    obj_yaml["file"] << Yaml(sig_obj.file);
+    WriteArch(obj_yaml, sig_obj.arch);
 
     auto obj_yaml_sections = obj_yaml.append_child({ryml::SEQ, "sections"});
     for (const auto &sig_section : sig_obj.sections) {
       auto obj_yaml_section = obj_yaml_sections.append_child();
       obj_yaml_section |= ryml::MAP;
       obj_yaml_section["size"] << sig_section.size;
-      obj_yaml_section["name"] << sig_section.name;
+      obj_yaml_section["crc_8"] << sig_section.crc_8;
+      obj_yaml_section["crc_all"] << sig_section.crc_all;
+      WriteHash(obj_yaml_section, sig_section.hash, sig_section.hash_all);
+      obj_yaml_section["duplicate_crc"] << std::format("{:s}", sig_section.duplicate_crc);
+      WritePattern(obj_yaml_section, sig_section.pattern, sig_section.tail_size, sig_section.crc16);
+      obj_yaml_section["name"] << Yaml(sig_section.name);
 
       auto obj_yaml_symbols = obj_yaml_section.append_child({ryml::SEQ, "symbols"});
       for (const auto &sig_symbol : sig_section.symbols) {
@@ -95,8 +270,14 @@ auto serialize(const std::vector<sig_object> &sig_objs) -> std::vector<char> {
         obj_yaml_symbol["size"] << sig_symbol.size;
         obj_yaml_symbol["crc_8"] << sig_symbol.crc_8;
         obj_yaml_symbol["crc_all"] << sig_symbol.crc_all;
+        WriteHash(obj_yaml_symbol, sig_symbol.hash, sig_symbol.hash_all);
+        obj_yaml_symbol["anchor_offset"] << sig_symbol.anchor_offset;
+        obj_yaml_symbol["anchor_size"] << sig_symbol.anchor_size;
+        obj_yaml_symbol["crc_anchor"] << sig_symbol.crc_anchor;
         obj_yaml_symbol["duplicate_crc"] << std::format("{:s}", sig_symbol.duplicate_crc);
-        obj_yaml_symbol["symbol"] << sig_symbol.symbol;
+        WritePattern(obj_yaml_symbol, sig_symbol.pattern, sig_symbol.tail_size, sig_symbol.crc16);
+        WriteWords(obj_yaml_symbol, sig_symbol.words);
+        obj_yaml_symbol["symbol"] << Yaml(sig_symbol.symbol);
 
         auto obj_yaml_relocations = obj_yaml_symbol.append_child({ryml::SEQ, "relocations"});
         for (const auto &sig_reloc : sig_symbol.relocations) {
@@ -107,12 +288,18 @@ auto serialize(const std::vector<sig_object> &sig_objs) -> std::vector<char> {
           obj_yaml_relocation["offset"] << sig_reloc.offset;
           obj_yaml_relocation["addend"] << sig_reloc.addend;
           obj_yaml_relocation["local"] << std::format("{:s}", sig_reloc.local);
-          obj_yaml_relocation["name"] << sig_reloc.name;
+          obj_yaml_relocation["name"] << Yaml(sig_reloc.name);
         }
       }
     }
   }
 
+  if (!flirt.empty()) {
+    auto flirt_yaml = root.append_child();
+    flirt_yaml |= ryml::MAP;
+    flirt_yaml["flirt"] << Hex(flirt);
+  }
+
   return ryml::emitrs_yaml<std::vector<char>>(tree);
 }
 }  // namespace sig_yaml
\ No newline at end of file
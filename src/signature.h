@@ -1,15 +1,28 @@
 #pragma once
 
 #include <cstdint>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <vector>
 
+#include "hash64.h"
+#include "string_table.h"
+#include "target.h"
+
+// names and containers are std::pmr so a whole load can live in one monotonic arena
+// build members with the arena and move them into place, a copy falls back to the default resource
+// the arena must outlive the objects, freeing it drops a few large buffers instead of every name
+using sig_arena = std::pmr::monotonic_buffer_resource;
+
 using sig_relocation = struct sig_relocation {
   uint64_t type{};
   uint64_t offset{};
   uint32_t addend{};
   bool local{};
-  std::string name;
+  std::pmr::string name;
+  // ids are filled by interning after load, they are not serialized
+  string_id name_id{};
 
   auto operator==(const sig_relocation &x) const -> bool  = default;
 };
@@ -19,24 +32,53 @@ using sig_symbol = struct sig_symbol {
   uint64_t size{};
   uint32_t crc_8{};
   uint32_t crc_all{};
+  // checked after crc_all, hash_all is 0 when hash is none
+  sig_hash hash{};
+  uint64_t hash_all{};
+  // most selective relocation free window, chosen by objsig from library wide statistics
+  // anchor_size of 0 means no such window exists and crc_8 is the only prefilter
+  uint64_t anchor_offset{};
+  uint64_t anchor_size{};
+  uint32_t crc_anchor{};
   bool duplicate_crc{};
-  std::string symbol;
-  std::vector<sig_relocation> relocations;
+  // flirt pattern and tail crc16, see flirt.h, empty in signatures written before them
+  std::pmr::string pattern;
+  uint16_t tail_size{};
+  uint16_t crc16{};
+  // masked words, what fuzzy matching scores candidates against, read big endian whatever the target
+  // objsig only writes them with -W, they are empty in most signature files
+  std::pmr::vector<uint32_t> words;
+  std::pmr::string symbol;
+  std::pmr::vector<sig_relocation> relocations;
+  string_id symbol_id{};
 
   auto operator==(const sig_symbol &x) const -> bool  = default;
 };
 
 using sig_section = struct sig_section {
   uint64_t size{};
-  std::string name;
-  std::vector<sig_symbol> symbols;
+  // whole section hashes, with the relocations of its symbols masked
+  uint32_t crc_8{};
+  uint32_t crc_all{};
+  sig_hash hash{};
+  uint64_t hash_all{};
+  bool duplicate_crc{};
+  std::pmr::string pattern;
+  uint16_t tail_size{};
+  uint16_t crc16{};
+  std::pmr::string name;
+  std::pmr::vector<sig_symbol> symbols;
+  string_id name_id{};
 
   auto operator==(const sig_section &x) const -> bool  = default;
 };
 
 using sig_object = struct sig_object {
-  std::string file;
-  std::vector<sig_section> sections;
+  std::pmr::string file;
+  // from the elf header, relocations are masked and decoded the way this target lays them out
+  target_arch arch{};
+  std::pmr::vector<sig_section> sections;
+  string_id file_id{};
 
   auto operator==(const sig_object &x) const -> bool  = default;
 };
@@ -44,6 +86,10 @@ using sig_object = struct sig_object {
 //not all users of these types need serialization
 //should this be moved?
 namespace sig_yaml {
-    auto deserialize(std::vector<char> &bytes) -> std::vector<sig_object>;
-    auto serialize(const std::vector<sig_object> &sig_obj) -> std::vector<char>;
+    // nested members are allocated from arena
+    // flirt receives the trie objsig -F compiled into the file, it is left empty when there is none
+    auto deserialize(std::vector<char> &bytes, std::pmr::memory_resource *arena = std::pmr::get_default_resource(),
+                     std::vector<uint8_t> *flirt = nullptr) -> std::vector<sig_object>;
+    // a non empty flirt is written after the objects, older objmatch builds can not read such a file
+    auto serialize(const std::vector<sig_object> &sig_obj, std::span<const uint8_t> flirt = {}) -> std::vector<char>;
 }
\ No newline at end of file
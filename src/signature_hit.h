@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+// position of a section or symbol in the signature file and where it was found
+// symbol is unused for whole section hits
+using signature_hit = struct signature_hit {
+  uint32_t object{};
+  uint32_t section{};
+  uint32_t symbol{};
+  uint32_t rom_offset{};
+
+  auto operator==(const signature_hit &x) const -> bool = default;
+};
@@ -0,0 +1,22 @@
+#include "string_table.h"
+
+string_table::string_table() { intern(""); }
+
+auto string_table::intern(std::string_view str) -> string_id {
+  if (auto found = ids.find(str); found != ids.end()) return found->second;
+
+  const auto id = static_cast<string_id>(strings.size());
+  const auto &stored = strings.emplace_back(str);
+  ids.emplace(stored, id);
+
+  return id;
+}
+
+// unknown strings map to the empty string
+auto string_table::find(std::string_view str) const -> string_id {
+  if (auto found = ids.find(str); found != ids.end()) return found->second;
+
+  return 0;
+}
+
+auto string_table::operator[](string_id id) const -> const std::string & { return strings[id]; }
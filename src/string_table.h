@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using string_id = uint32_t;
+
+// interns names once, so matching can hash and compare integers
+// id 0 is always the empty string, so default initialized ids are valid
+using string_table = struct string_table {
+  string_table();
+
+  auto intern(std::string_view str) -> string_id;
+  auto find(std::string_view str) const -> string_id;
+  auto operator[](string_id id) const -> const std::string &;
+
+ private:
+  // deque so the views used as keys stay valid as strings are added
+  std::deque<std::string> strings;
+  std::unordered_map<std::string_view, string_id> ids;
+};
@@ -0,0 +1,375 @@
+#include "synth.h"
+
+#include <elf.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "objsig.h"
+
+namespace {
+constexpr uint32_t text_section{1};
+constexpr uint32_t rel_text_section{2};
+constexpr uint32_t data_section{3};
+constexpr uint32_t symtab_section{4};
+constexpr uint32_t strtab_section{5};
+constexpr uint32_t shstrtab_section{6};
+constexpr uint32_t section_count{7};
+
+// stack frame setup and teardown, what LikelyFunctionOffsets looks for
+constexpr uint32_t addiu_sp_down{0x27BDFFE0};
+constexpr uint32_t sw_ra{0xAFBF0014};
+constexpr uint32_t lw_ra{0x8FBF0014};
+constexpr uint32_t jr_ra{0x03E00008};
+constexpr uint32_t addiu_sp_up{0x27BD0020};
+constexpr uint32_t jal{0x0C000000};
+constexpr uint32_t lui_at{0x3C010000};
+constexpr uint32_t addiu_at_at{0x24210000};
+
+auto put16(std::vector<char> &out, uint16_t value) -> void {
+  out.push_back(static_cast<char>(value >> 8));
+  out.push_back(static_cast<char>(value));
+}
+
+auto put32(std::vector<char> &out, uint32_t value) -> void {
+  put16(out, static_cast<uint16_t>(value >> 16));
+  put16(out, static_cast<uint16_t>(value));
+}
+
+auto put32(std::vector<uint8_t> &out, uint64_t offset, uint32_t value) -> void {
+  for (int byte = 0; byte < 4; byte++) out[offset + byte] = static_cast<uint8_t>(value >> (24 - byte * 8));
+}
+
+auto align(std::vector<char> &out, size_t alignment) -> void {
+  while (out.size() % alignment != 0) out.push_back(0);
+}
+
+auto add_string(std::vector<char> &table, std::string_view str) -> uint32_t {
+  const auto offset = static_cast<uint32_t>(table.size());
+  table.insert(table.end(), str.begin(), str.end());
+  table.push_back(0);
+  return offset;
+}
+
+// random register to register arithmetic, never a jump and never touching sp or ra
+auto body_word(std::mt19937 &rng) -> uint32_t {
+  std::uniform_int_distribution<uint32_t> reg{2, 25};
+  std::uniform_int_distribution<uint32_t> op{0, 3};
+  std::uniform_int_distribution<uint32_t> imm{0, 0x7FFF};
+  switch (op(rng)) {
+    case 0: return reg(rng) << 21 | reg(rng) << 16 | reg(rng) << 11 | 0x21;                // addu
+    case 1: return reg(rng) << 21 | reg(rng) << 16 | reg(rng) << 11 | 0x25;                // or
+    case 2: return 0x24000000 | reg(rng) << 21 | reg(rng) << 16 | imm(rng);                // addiu
+    default: return 0x8C000000 | 29 << 21 | reg(rng) << 16 | (imm(rng) & 0x7C);            // lw from the frame
+  }
+}
+
+auto function_bytes(synth_function const &function) -> uint32_t { return static_cast<uint32_t>(function.words.size() * sizeof(uint32_t)); }
+
+auto text_bytes(synth_object const &object) -> uint32_t {
+  uint32_t size = 0;
+  for (const auto &function : object.functions) size += function_bytes(function);
+  return size;
+}
+
+auto write_object(synth_object const &object) -> std::vector<char> {
+  std::vector<char> shstrtab{0};
+  std::array<uint32_t, section_count> names{};
+  names[text_section] = add_string(shstrtab, ".text");
+  names[rel_text_section] = add_string(shstrtab, ".rel.text");
+  names[data_section] = add_string(shstrtab, ".data");
+  names[symtab_section] = add_string(shstrtab, ".symtab");
+  names[strtab_section] = add_string(shstrtab, ".strtab");
+  names[shstrtab_section] = add_string(shstrtab, ".shstrtab");
+
+  // locals first: null, the two section symbols
+  // then globals: functions, the data symbol, undefined externs
+  std::vector<char> strtab{0};
+  std::vector<char> symtab;
+  auto add_symbol = [&symtab](uint32_t name, uint32_t value, uint32_t size, uint8_t info, uint16_t shndx) {
+    put32(symtab, name);
+    put32(symtab, value);
+    put32(symtab, size);
+    symtab.push_back(static_cast<char>(info));
+    symtab.push_back(0);
+    put16(symtab, shndx);
+  };
+  add_symbol(0, 0, 0, 0, 0);
+  add_symbol(0, 0, 0, ELF32_ST_INFO(STB_LOCAL, STT_SECTION), text_section);
+  add_symbol(0, 0, 0, ELF32_ST_INFO(STB_LOCAL, STT_SECTION), data_section);
+  constexpr uint32_t first_global{3};
+
+  std::vector<uint32_t> extern_symbols(object.externs.size());
+  uint32_t symbol_count = first_global;
+  uint32_t offset = 0;
+  for (const auto &function : object.functions) {
+    const auto name = add_string(strtab, function.name);
+    add_symbol(name, offset, function_bytes(function), ELF32_ST_INFO(STB_GLOBAL, STT_FUNC), text_section);
+    // a function of this object referenced by itself resolves to its own symbol
+    if (auto found = std::ranges::find(object.externs, function.name); found != object.externs.end()) {
+      extern_symbols[found - object.externs.begin()] = symbol_count;
+    }
+    symbol_count++;
+    offset += function_bytes(function);
+  }
+  for (size_t ext = 0; ext < object.externs.size(); ext++) {
+    if (extern_symbols[ext] != 0) continue;
+    const bool own_data = ext == 0;
+    const auto name = add_string(strtab, object.externs[ext]);
+    if (own_data) {
+      add_symbol(name, 0, static_cast<uint32_t>(object.data.size() * sizeof(uint32_t)), ELF32_ST_INFO(STB_GLOBAL, STT_OBJECT), data_section);
+    } else {
+      add_symbol(name, 0, 0, ELF32_ST_INFO(STB_GLOBAL, STT_NOTYPE), SHN_UNDEF);
+    }
+    extern_symbols[ext] = symbol_count++;
+  }
+
+  std::vector<char> text;
+  std::vector<char> rel_text;
+  offset = 0;
+  for (const auto &function : object.functions) {
+    for (const auto word : function.words) put32(text, word);
+    for (const auto &rel : function.relocations) {
+      put32(rel_text, offset + rel.offset);
+      put32(rel_text, extern_symbols[rel.symbol] << 8 | rel.type);
+    }
+    offset += function_bytes(function);
+  }
+  std::vector<char> data;
+  for (const auto word : object.data) put32(data, word);
+
+  // header, section contents, then the section header table
+  std::vector<char> out(sizeof(Elf32_Ehdr));
+  std::array<Elf32_Shdr, section_count> headers{};
+  auto place = [&out, &headers](uint32_t section, std::vector<char> const &bytes, uint32_t alignment) {
+    align(out, alignment);
+    headers[section].sh_offset = static_cast<Elf32_Off>(out.size());
+    headers[section].sh_size = static_cast<Elf32_Word>(bytes.size());
+    headers[section].sh_addralign = alignment;
+    out.insert(out.end(), bytes.begin(), bytes.end());
+  };
+  place(text_section, text, 16);
+  place(rel_text_section, rel_text, 4);
+  place(data_section, data, 16);
+  place(symtab_section, symtab, 4);
+  place(strtab_section, strtab, 1);
+  place(shstrtab_section, shstrtab, 1);
+  align(out, 4);
+  const auto section_headers = static_cast<uint32_t>(out.size());
+
+  headers[text_section].sh_type = SHT_PROGBITS;
+  headers[text_section].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+  headers[rel_text_section].sh_type = SHT_REL;
+  headers[rel_text_section].sh_link = symtab_section;
+  headers[rel_text_section].sh_info = text_section;
+  headers[rel_text_section].sh_entsize = sizeof(Elf32_Rel);
+  headers[data_section].sh_type = SHT_PROGBITS;
+  headers[data_section].sh_flags = SHF_ALLOC | SHF_WRITE;
+  headers[symtab_section].sh_type = SHT_SYMTAB;
+  headers[symtab_section].sh_link = strtab_section;
+  headers[symtab_section].sh_info = first_global;
+  headers[symtab_section].sh_entsize = sizeof(Elf32_Sym);
+  headers[strtab_section].sh_type = SHT_STRTAB;
+  headers[shstrtab_section].sh_type = SHT_STRTAB;
+
+  for (uint32_t section = 0; section < section_count; section++) {
+    const auto &header = headers[section];
+    put32(out, section == 0 ? 0 : names[section]);
+    put32(out, header.sh_type);
+    put32(out, header.sh_flags);
+    put32(out, 0);
+    put32(out, header.sh_offset);
+    put32(out, header.sh_size);
+    put32(out, header.sh_link);
+    put32(out, header.sh_info);
+    put32(out, header.sh_addralign);
+    put32(out, header.sh_entsize);
+  }
+
+  std::vector<char> ehdr;
+  ehdr.insert(ehdr.end(), {ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS32, ELFDATA2MSB, EV_CURRENT});
+  ehdr.resize(EI_NIDENT);
+  put16(ehdr, ET_REL);
+  put16(ehdr, EM_MIPS);
+  put32(ehdr, EV_CURRENT);
+  put32(ehdr, 0);  // entry
+  put32(ehdr, 0);  // program headers
+  put32(ehdr, section_headers);
+  put32(ehdr, 0);  // flags
+  put16(ehdr, sizeof(Elf32_Ehdr));
+  put16(ehdr, 0);
+  put16(ehdr, 0);
+  put16(ehdr, sizeof(Elf32_Shdr));
+  put16(ehdr, section_count);
+  put16(ehdr, shstrtab_section);
+  std::ranges::copy(ehdr, out.begin());
+
+  return out;
+}
+}  // namespace
+
+namespace synth {
+auto make_library(synth_options const &options) -> std::vector<synth_object> {
+  std::mt19937 rng{options.seed};
+  std::uniform_int_distribution<uint32_t> body_size{options.min_body, std::max(options.min_body, options.max_body)};
+  std::uniform_int_distribution<uint32_t> percent{0, 99};
+  std::uniform_int_distribution<uint32_t> any_object{0, std::max(options.objects, 1U) - 1};
+  std::uniform_int_distribution<uint32_t> any_function{0, std::max(options.functions_per_object, 1U) - 1};
+
+  std::vector<synth_object> library(options.objects);
+  for (uint32_t object = 0; object < options.objects; object++) {
+    auto &obj = library[object];
+    obj.name = std::format("synth{:04}.o", object);
+    // extern 0 is always the object's own data symbol
+    obj.externs.push_back(std::format("synth{:04}_data", object));
+    for (uint32_t word = 0, words = 4 + percent(rng) % 16; word < words; word++) obj.data.push_back(static_cast<uint32_t>(rng()));
+
+    for (uint32_t function = 0; function < options.functions_per_object; function++) {
+      synth_function func{.name = std::format("synth{:04}_{:02}", object, function)};
+      // no roll without frameless functions, so libraries of the same seed stay the same
+      const bool frameless = options.frameless_percent != 0 && percent(rng) < options.frameless_percent;
+      if (!frameless) func.words = {addiu_sp_down, sw_ra};
+
+      for (uint32_t body = 0, bodies = body_size(rng); body < bodies; body++) {
+        const auto roll = percent(rng);
+        if (roll < 8) {
+          // call into any function of the library
+          const auto callee = std::format("synth{:04}_{:02}", any_object(rng), any_function(rng));
+          auto ext = std::ranges::find(obj.externs, callee);
+          if (ext == obj.externs.end()) ext = obj.externs.insert(obj.externs.end(), callee);
+          func.relocations.push_back(synth_relocation{.offset = static_cast<uint32_t>(func.words.size() * 4), .type = R_MIPS_26,
+                                                      .symbol = static_cast<uint32_t>(ext - obj.externs.begin())});
+          func.words.push_back(jal);
+          func.words.push_back(0);  // delay slot
+        } else if (roll < 12) {
+          // address of the object's data
+          func.relocations.push_back(synth_relocation{.offset = static_cast<uint32_t>(func.words.size() * 4), .type = R_MIPS_HI16, .symbol = 0});
+          func.words.push_back(lui_at);
+          func.relocations.push_back(synth_relocation{.offset = static_cast<uint32_t>(func.words.size() * 4), .type = R_MIPS_LO16, .symbol = 0});
+          func.words.push_back(addiu_at_at);
+        } else {
+          func.words.push_back(body_word(rng));
+        }
+      }
+
+      if (frameless) {
+        func.words.insert(func.words.end(), {jr_ra, 0});
+      } else {
+        func.words.insert(func.words.end(), {lw_ra, jr_ra, addiu_sp_up});
+      }
+      obj.functions.push_back(std::move(func));
+    }
+  }
+
+  return library;
+}
+
+auto write_archive(std::vector<synth_object> const &library) -> std::vector<char> {
+  std::vector<char> out{'!', '<', 'a', 'r', 'c', 'h', '>', '\n'};
+  for (const auto &object : library) {
+    const auto member = write_object(object);
+    if (object.name.size() > 15) throw std::invalid_argument{std::format("'{}' needs a long name table", object.name)};
+
+    // gnu ar names end in '/', every field is space padded
+    const auto header = std::format("{:<16}{:<12}{:<6}{:<6}{:<8}{:<10}`\n", object.name + "/", 0, 0, 0, 644, member.size());
+    out.insert(out.end(), header.begin(), header.end());
+    out.insert(out.end(), member.begin(), member.end());
+    if (out.size() % 2 != 0) out.push_back('\n');
+  }
+
+  return out;
+}
+
+auto make_rom(std::vector<synth_object> const &library, uint64_t rom_size, uint32_t seed) -> synth_rom {
+  std::mt19937 rng{seed};
+  std::uniform_int_distribution<uint32_t> gap_words{0, 64};
+
+  synth_rom rom{.bytes = std::vector<uint8_t>(rom_size)};
+  // filler is the same arithmetic as function bodies, so it looks like code to the scanners
+  for (uint64_t offset = 0; offset + 4 <= rom_size; offset += 4) put32(rom.bytes, offset, body_word(rng));
+
+  // the first 0x1000 bytes stand in for a rom header and boot code
+  uint64_t offset = 0x1000;
+  std::unordered_map<std::string, uint64_t> addresses;
+  for (const auto &object : library) {
+    offset += gap_words(rng) * 4;
+    auto placement = synth_placement{.text_start = offset, .data_start = offset + text_bytes(object)};
+    offset = placement.data_start + object.data.size() * 4;
+    if (offset > rom_size) throw std::invalid_argument{std::format("rom of 0x{:x} bytes is too small for the library", rom_size)};
+
+    uint64_t function_start = placement.text_start;
+    for (const auto &function : object.functions) {
+      addresses[function.name] = function_start;
+      function_start += function_bytes(function);
+    }
+    addresses[object.externs[0]] = placement.data_start;
+    rom.placements.push_back(placement);
+  }
+
+  for (size_t object = 0; object < library.size(); object++) {
+    const auto &obj = library[object];
+    const auto &placement = rom.placements[object];
+
+    uint64_t function_start = placement.text_start;
+    for (const auto &function : obj.functions) {
+      for (size_t word = 0; word < function.words.size(); word++) put32(rom.bytes, function_start + word * 4, function.words[word]);
+
+      // what the linker would have filled in
+      for (const auto &rel : function.relocations) {
+        const auto address = static_cast<uint32_t>(addresses.at(obj.externs[rel.symbol]));
+        const auto at = function_start + rel.offset;
+        const auto word = function.words[rel.offset / 4];
+        if (rel.type == R_MIPS_26) put32(rom.bytes, at, word | ((address >> 2) & 0x03FFFFFF));
+        if (rel.type == R_MIPS_HI16) put32(rom.bytes, at, word | (((address + 0x8000) >> 16) & 0xFFFF));
+        if (rel.type == R_MIPS_LO16) put32(rom.bytes, at, word | (address & 0xFFFF));
+      }
+      function_start += function_bytes(function);
+    }
+    for (size_t word = 0; word < obj.data.size(); word++) put32(rom.bytes, placement.data_start + word * 4, obj.data[word]);
+  }
+
+  return rom;
+}
+
+auto bin_splat(synth_rom const &rom) -> std::vector<splat_out> {
+  std::vector<splat_out> splat{splat_out{.start = 0, .vram = 0, .type = "bin", .name = "header"}};
+  for (const auto &placement : rom.placements) {
+    splat.push_back(splat_out{.start = placement.text_start, .vram = placement.text_start, .type = "bin", .name = std::format("0x{:x}", placement.text_start)});
+  }
+
+  return splat;
+}
+
+auto file_paths(std::vector<synth_object> const &library) -> std::vector<file_path> {
+  std::vector<file_path> paths;
+  paths.reserve(library.size());
+  for (const auto &object : library) paths.push_back(file_path{.file = object.name, .path = "synth"});
+
+  return paths;
+}
+
+auto planted_case(synth_options const &options, uint64_t rom_size) -> synth_case {
+  synth_case planted{.library = make_library(options)};
+  planted.rom = make_rom(planted.library, rom_size, options.seed);
+  planted.archive = write_archive(planted.library);
+
+  // libelf may convert the archive in place
+  auto archive = planted.archive;
+  planted.sigs = ProcessLibrary(std::span{archive});
+  planted.strings = InternSignatures(planted.sigs);
+  reload(planted);
+
+  return planted;
+}
+
+auto reload(synth_case &planted) -> void {
+  planted.b_info = LoadBinary(std::vector<uint8_t>{planted.rom.bytes}, rom_kind::raw);
+  planted.offsets = LikelyFunctionOffsets(planted.b_info, {});
+}
+}  // namespace synth
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "file_path.h"
+#include "objmatch.h"
+#include "signature.h"
+#include "splat_out.h"
+#include "string_table.h"
+
+// synthetic big endian mips libraries and roms with those libraries linked in
+// lets benchmarks and tests run at scale without a mips cross toolchain
+
+using synth_relocation = struct synth_relocation {
+  uint32_t offset{};
+  uint8_t type{};
+  // index into synth_object::externs
+  uint32_t symbol{};
+};
+
+using synth_function = struct synth_function {
+  std::string name;
+  // instruction words with relocated fields left 0, as an assembler emits them
+  std::vector<uint32_t> words;
+  std::vector<synth_relocation> relocations;
+};
+
+using synth_object = struct synth_object {
+  std::string name;
+  std::vector<synth_function> functions;
+  std::vector<uint32_t> data;
+  // names referenced by relocations, functions of other objects and this object's data symbol
+  std::vector<std::string> externs;
+};
+
+using synth_options = struct synth_options {
+  uint32_t objects{64};
+  uint32_t functions_per_object{8};
+  // body instructions per function, between the prologue and epilogue
+  uint32_t min_body{8};
+  uint32_t max_body{64};
+  // percent of functions without a stack frame, they end in jr ra with a nop and have no prologue for the heuristics
+  uint32_t frameless_percent{};
+  uint32_t seed{1};
+};
+
+// where an object ended up in a rom
+using synth_placement = struct synth_placement {
+  uint64_t text_start{};
+  uint64_t data_start{};
+};
+
+using synth_rom = struct synth_rom {
+  std::vector<uint8_t> bytes;
+  // by object, in library order
+  std::vector<synth_placement> placements;
+};
+
+// a library planted in a rom, and what objsig and objmatch derive from the two
+using synth_case = struct synth_case {
+  std::vector<synth_object> library;
+  synth_rom rom;
+  std::vector<char> archive;
+  std::vector<sig_object> sigs;
+  string_table strings;
+  binary_info b_info;
+  std::set<uint32_t> offsets;
+};
+
+namespace synth {
+auto make_library(synth_options const &options) -> std::vector<synth_object>;
+
+// an ar archive of ELF32 big endian mips relocatable objects, what objsig reads
+auto write_archive(std::vector<synth_object> const &library) -> std::vector<char>;
+
+// objects are linked at random gaps of filler words, vram equals rom offset
+// so the header size objmatch derives for rom_kind::raw is right
+auto make_rom(std::vector<synth_object> const &library, uint64_t rom_size, uint32_t seed) -> synth_rom;
+
+// a splat config with every object still a bin entry, and the object paths matcher expects
+auto bin_splat(synth_rom const &rom) -> std::vector<splat_out>;
+auto file_paths(std::vector<synth_object> const &library) -> std::vector<file_path>;
+
+// make_library, make_rom with the options' seed and write_archive
+// then signatures of the archive and the rom loaded as a plain .bin with its likely function offsets
+auto planted_case(synth_options const &options, uint64_t rom_size) -> synth_case;
+// b_info and offsets again, after the rom bytes were changed
+auto reload(synth_case &planted) -> void;
+}  // namespace synth
@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <print>
+#include <span>
+#include <string>
+
+#include "splat_out.h"
+#include "synth.h"
+
+namespace {
+template <typename T>
+auto Write(std::string const &path, std::vector<T> const &bytes) -> bool {
+  std::ofstream file{path, std::ios::binary};
+  file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  return file.good();
+}
+}  // namespace
+
+auto main(int argc, const char *argv[]) -> int {
+  const std::span<const char *> args = {argv, static_cast<size_t>(argc)};
+
+  if (argc < 2) {
+    std::print(
+        "synth - synthetic mips rom and library generator for objmatch benchmarks\n\n"
+        "  Usage: synth <out prefix> [options]\n"
+        "  Writes <prefix>.bin, <prefix>.a and <prefix>.yaml (splat bin entries)\n\n"
+        "  Options:\n"
+        "    -o <count>        objects in the library (64)\n"
+        "    -f <count>        functions per object (8)\n"
+        "    -b <words>        largest function body in instructions (64)\n"
+        "    -r <bytes>        rom size (0x800000)\n"
+        "    -s <seed>         random seed (1)\n");
+
+    return EXIT_FAILURE;
+  }
+
+  synth_options options;
+  uint64_t rom_size = 0x800000;
+  for (int argi = 2; argi < argc; argi++) {
+    if (args[argi][0] != '-' || strlen(&args[argi][1]) != 1) {
+      std::println("Error: Invalid switch '{}'", args[argi]);
+      return EXIT_FAILURE;
+    }
+    if (argi + 1 >= argc) {
+      std::println("Error: No value specified for '{}'", args[argi]);
+      return EXIT_FAILURE;
+    }
+
+    const auto value = std::strtoull(args[argi + 1], nullptr, 0);
+    switch (args[argi][1]) {
+      case 'o': options.objects = static_cast<uint32_t>(value); break;
+      case 'f': options.functions_per_object = static_cast<uint32_t>(value); break;
+      case 'b': options.max_body = static_cast<uint32_t>(value); break;
+      case 'r': rom_size = value; break;
+      case 's': options.seed = static_cast<uint32_t>(value); break;
+      default:
+        std::println("Error: Invalid switch '{}'", args[argi]);
+        return EXIT_FAILURE;
+    }
+    argi++;
+  }
+
+  const std::string prefix = args[1];
+  const auto library = synth::make_library(options);
+  const auto rom = synth::make_rom(library, rom_size, options.seed);
+
+  if (!Write(prefix + ".bin", rom.bytes) || !Write(prefix + ".a", synth::write_archive(library)) ||
+      !Write(prefix + ".yaml", splat_yaml::serialize(synth::bin_splat(rom)))) {
+    std::println("Error: Could not write '{}'", prefix);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+#include "target.h"
+
+#include <algorithm>
+
+namespace {
+constexpr std::array<std::string_view, static_cast<size_t>(target_arch::count)> names{"mips", "mipsel", "arm"};
+}  // namespace
+
+namespace targets {
+auto detect(uint16_t e_machine, uint8_t ei_data) -> std::optional<target_arch> {
+  // big endian arm is not used by the consoles
+  if (e_machine == EM_ARM) return ei_data == ELFDATA2LSB ? std::optional{target_arch::arm} : std::nullopt;
+  if (e_machine != EM_MIPS) return std::nullopt;
+  if (ei_data == ELFDATA2MSB) return target_arch::mips_be;
+  if (ei_data == ELFDATA2LSB) return target_arch::mips_le;
+  return std::nullopt;
+}
+
+auto load(target_arch arch, const uint8_t *bytes) -> uint32_t {
+  return visit(arch, [bytes](auto target) { return decltype(target)::load(bytes); });
+}
+
+auto keep(target_arch arch, uint64_t type) -> std::array<uint8_t, 4> {
+  return visit(arch, [type](auto target) { return decltype(target)::keep(type); });
+}
+
+auto strip(target_arch arch, uint8_t *bytes, uint64_t type) -> bool {
+  return visit(arch, [bytes, type](auto target) {
+    using target_t = decltype(target);
+    if (target_t::field(type) == 0) return false;
+    strip_relocation<target_t>(bytes, type);
+    return true;
+  });
+}
+
+auto high_half(target_arch arch, uint64_t type) -> bool {
+  return visit(arch, [type](auto target) { return decltype(target)::high_half(type); });
+}
+
+auto low_half(target_arch arch, uint64_t type) -> bool {
+  return visit(arch, [type](auto target) { return decltype(target)::low_half(type); });
+}
+
+auto addend(target_arch arch, uint64_t type, uint32_t word) -> uint32_t {
+  return visit(arch, [type, word](auto target) { return decltype(target)::addend(type, word); });
+}
+
+auto symbol_offset(target_arch arch, uint64_t value, uint8_t type) -> uint64_t {
+  return visit(arch, [value, type](auto target) { return decltype(target)::symbol_offset(value, type); });
+}
+
+auto halfwords(target_arch arch) -> bool {
+  return visit(arch, [](auto target) { return decltype(target)::halfwords; });
+}
+
+auto name(target_arch arch) -> std::string_view { return names.at(static_cast<size_t>(arch)); }
+
+auto parse(std::string_view name) -> std::optional<target_arch> {
+  const auto found = std::ranges::find(names, name);
+  if (found == names.end()) return std::nullopt;
+  return static_cast<target_arch>(found - names.begin());
+}
+}  // namespace targets
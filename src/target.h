@@ -0,0 +1,186 @@
+#pragma once
+
+#include <elf.h>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+// what a signature was built for, read from the elf header of each object
+// roms carry no header, they take the target of the signatures matched against them
+enum class target_arch : uint8_t { mips_be, mips_le, arm, count };
+
+enum class byte_order : uint8_t { big, little };
+
+// everything the matcher needs to know about an instruction set, resolved at compile time
+// the loops over rom words take a target as a template parameter and are instantiated once per target,
+// so byte order and relocation layout are constants in them, the runtime choice is one targets::visit outside the loop
+template <byte_order Order>
+struct word_io {
+  static constexpr auto load(const uint8_t *bytes) -> uint32_t {
+    if constexpr (Order == byte_order::big) {
+      return static_cast<uint32_t>(bytes[0]) << 24 | static_cast<uint32_t>(bytes[1]) << 16 | static_cast<uint32_t>(bytes[2]) << 8 | bytes[3];
+    } else {
+      return static_cast<uint32_t>(bytes[3]) << 24 | static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[1]) << 8 | bytes[0];
+    }
+  }
+
+  static constexpr auto store(uint8_t *bytes, uint32_t word) -> void {
+    for (size_t byte = 0; byte < 4; byte++) {
+      const auto shift = Order == byte_order::big ? (3 - byte) * 8 : byte * 8;
+      bytes[byte] = static_cast<uint8_t>(word >> shift);
+    }
+  }
+
+  // the bytes of a relocated word that survive masking, in memory order
+  static constexpr auto keep_bytes(uint32_t field) -> std::array<uint8_t, 4> {
+    std::array<uint8_t, 4> bytes{};
+    store(bytes.data(), ~field);
+    return bytes;
+  }
+};
+
+template <byte_order Order>
+struct mips_target : word_io<Order> {
+  static constexpr target_arch arch = Order == byte_order::big ? target_arch::mips_be : target_arch::mips_le;
+  // every instruction is a word
+  static constexpr bool halfwords = false;
+
+  // bits of an instruction the linker rewrites for a relocation, 0 for types signatures do not mask
+  static constexpr auto field(uint64_t type) -> uint32_t {
+    switch (type) {
+      case R_MIPS_26: return 0x03FFFFFF;
+      case R_MIPS_HI16:
+      case R_MIPS_LO16: return 0x0000FFFF;
+      default: return 0;
+    }
+  }
+
+  static constexpr auto keep(uint64_t type) -> std::array<uint8_t, 4> { return word_io<Order>::keep_bytes(field(type)); }
+
+  // hi16 is paired with the lo16 after it, their addend is only known together
+  static constexpr auto high_half(uint64_t type) -> bool { return type == R_MIPS_HI16; }
+  static constexpr auto low_half(uint64_t type) -> bool { return type == R_MIPS_LO16; }
+
+  // the addend the object stored in the field of a type that is not half of a pair
+  static constexpr auto addend(uint64_t type, uint32_t word) -> uint32_t { return type == R_MIPS_26 ? (word & 0x03FFFFFF) << 2 : 0; }
+
+  // symbol plus addend, from the linked word at address place, nullopt for halves and unmasked types
+  static constexpr auto address(uint64_t type, uint32_t word, uint32_t place) -> std::optional<uint32_t> {
+    if (type != R_MIPS_26) return std::nullopt;
+    return (place & 0xF0000000) + ((word & 0x03FFFFFF) << 2);
+  }
+
+  static constexpr auto symbol_offset(uint64_t value, uint8_t /*type*/) -> uint64_t { return value; }
+
+  // bit 0 set when the word is a jr ra
+  static constexpr auto returns(uint32_t word) -> uint32_t { return word == 0x03E00008 ? 1 : 0; }
+  // bit 0 set for addiu sp, sp with the sign bit of the immediate set
+  static constexpr auto frame_setups(uint32_t word) -> uint32_t { return (word & 0xFFFF8000) == 0x27BD8000 ? 1 : 0; }
+  // a function starts past the delay slot of the previous one's jr ra
+  static constexpr auto after_return(const uint8_t * /*at*/) -> uint64_t { return 8; }
+};
+
+using mips_be_target = mips_target<byte_order::big>;
+using mips_le_target = mips_target<byte_order::little>;
+
+// little endian arm with thumb interworking, gba and nds code
+// thumb instructions are halfwords, so candidates are found at both halves of a word
+struct arm_target : word_io<byte_order::little> {
+  static constexpr target_arch arch = target_arch::arm;
+  static constexpr bool halfwords = true;
+
+  static constexpr auto field(uint64_t type) -> uint32_t {
+    switch (type) {
+      // literal pool words and data pointers
+      case R_ARM_ABS32: return 0xFFFFFFFF;
+      case R_ARM_PC24:
+      case R_ARM_JUMP24: return 0x00FFFFFF;
+      // the linker may turn a bl into a blx, which rewrites the condition and the h bit
+      case R_ARM_CALL: return 0xF1FFFFFF;
+      // R_ARM_THM_CALL, a bl pair of halfwords, the second one's bit 12 tells bl from blx
+      case R_ARM_THM_PC22: return 0x17FF07FF;
+      default: return 0;
+    }
+  }
+
+  static constexpr auto keep(uint64_t type) -> std::array<uint8_t, 4> { return keep_bytes(field(type)); }
+
+  static constexpr auto high_half(uint64_t /*type*/) -> bool { return false; }
+  static constexpr auto low_half(uint64_t /*type*/) -> bool { return false; }
+
+  static constexpr auto addend(uint64_t type, uint32_t word) -> uint32_t {
+    switch (type) {
+      case R_ARM_ABS32: return word;
+      case R_ARM_PC24:
+      case R_ARM_JUMP24:
+      case R_ARM_CALL: return static_cast<uint32_t>(static_cast<int32_t>(word << 8) >> 6);
+      case R_ARM_THM_PC22: {
+        const auto offset = (word & 0x7FF) << 12 | (word >> 16 & 0x7FF) << 1;
+        return static_cast<uint32_t>(static_cast<int32_t>(offset << 9) >> 9);
+      }
+      default: return 0;
+    }
+  }
+
+  // branches store symbol plus addend relative to place
+  static constexpr auto address(uint64_t type, uint32_t word, uint32_t place) -> std::optional<uint32_t> {
+    if (type == R_ARM_ABS32) return word;
+    if (field(type) == 0) return std::nullopt;
+    return place + addend(type, word);
+  }
+
+  // thumb function symbols have bit 0 set
+  static constexpr auto symbol_offset(uint64_t value, uint8_t type) -> uint64_t { return type == STT_FUNC ? value & ~uint64_t{1} : value; }
+
+  // bit 0 for a bx lr at the word, as arm or as thumb, bit 1 for a thumb bx lr in its upper half
+  static constexpr auto returns(uint32_t word) -> uint32_t {
+    return static_cast<uint32_t>(word == 0xE12FFF1E || (word & 0xFFFF) == 0x4770) | static_cast<uint32_t>((word >> 16) == 0x4770) << 1;
+  }
+  // the same for push {.., lr}, stmfd sp! in arm
+  static constexpr auto frame_setups(uint32_t word) -> uint32_t {
+    return static_cast<uint32_t>((word & 0xFFFF4000) == 0xE92D4000 || (word & 0xFF00) == 0xB500) |
+           static_cast<uint32_t>((word & 0xFF000000) == 0xB5000000) << 1;
+  }
+  // no delay slot, only the size of the return
+  static constexpr auto after_return(const uint8_t *at) -> uint64_t { return (at[0] | at[1] << 8) == 0x4770 ? 2 : 4; }
+};
+
+namespace targets {
+// zeroes the bits the linker rewrote, Target is a constant so this is a load, an and and a store
+template <typename Target>
+auto strip_relocation(uint8_t *bytes, uint64_t type) -> void {
+  Target::store(bytes, Target::load(bytes) & ~Target::field(type));
+}
+
+// calls f with the target of arch as a value, dispatch once and run the loop inside f
+template <typename F>
+auto visit(target_arch arch, F &&f) -> decltype(auto) {
+  switch (arch) {
+    case target_arch::mips_le: return std::forward<F>(f)(mips_le_target{});
+    case target_arch::arm: return std::forward<F>(f)(arm_target{});
+    case target_arch::mips_be:
+    case target_arch::count: break;
+  }
+  return std::forward<F>(f)(mips_be_target{});
+}
+
+// nullopt for machines the signatures can not describe
+auto detect(uint16_t e_machine, uint8_t ei_data) -> std::optional<target_arch>;
+
+// for the cold paths, objsig and the followers of a confirmed hit
+auto load(target_arch arch, const uint8_t *bytes) -> uint32_t;
+auto keep(target_arch arch, uint64_t type) -> std::array<uint8_t, 4>;
+// false, and the word is left alone, for types signatures do not mask
+auto strip(target_arch arch, uint8_t *bytes, uint64_t type) -> bool;
+auto high_half(target_arch arch, uint64_t type) -> bool;
+auto low_half(target_arch arch, uint64_t type) -> bool;
+auto addend(target_arch arch, uint64_t type, uint32_t word) -> uint32_t;
+auto symbol_offset(target_arch arch, uint64_t value, uint8_t type) -> uint64_t;
+auto halfwords(target_arch arch) -> bool;
+
+auto name(target_arch arch) -> std::string_view;
+auto parse(std::string_view name) -> std::optional<target_arch>;
+}  // namespace targets
@@ -0,0 +1,112 @@
+#include "trace.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+using trace_event = struct trace_event {
+  std::string category;
+  std::string name;
+  double begin_us{};
+  double end_us{};
+  uint32_t tid{};
+  std::optional<uint64_t> arg;
+};
+
+// set before any worker thread starts, so it is read without synchronization
+bool tracing = false;
+std::filesystem::path trace_path;
+const auto epoch = std::chrono::steady_clock::now();
+
+std::mutex events_mutex;
+std::vector<trace_event> events;
+// small stable ids read better in the viewer than native thread ids
+std::unordered_map<std::thread::id, uint32_t> thread_ids;
+
+auto append_escaped(std::string &out, std::string_view text) -> void {
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      std::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<unsigned>(c));
+    } else {
+      out += c;
+    }
+  }
+}
+}  // namespace
+
+namespace trace {
+auto start(const std::filesystem::path &path) -> void {
+  trace_path = path;
+  tracing = true;
+  // the thread that starts tracing is shown as main
+  const std::lock_guard lock{events_mutex};
+  thread_ids.try_emplace(std::this_thread::get_id(), 0);
+}
+
+auto enabled() -> bool { return tracing; }
+
+auto to_us(std::chrono::steady_clock::time_point time) -> double { return std::chrono::duration<double, std::micro>(time - epoch).count(); }
+
+auto record(std::string_view category, std::string_view name, double begin_us, double end_us, std::optional<uint64_t> arg) -> void {
+  const std::lock_guard lock{events_mutex};
+  const auto [thread, inserted] = thread_ids.try_emplace(std::this_thread::get_id(), static_cast<uint32_t>(thread_ids.size()));
+  events.push_back(trace_event{.category = std::string{category},
+                               .name = std::string{name},
+                               .begin_us = begin_us,
+                               .end_us = end_us,
+                               .tid = thread->second,
+                               .arg = arg});
+}
+
+auto finish() -> bool {
+  if (!tracing) return true;
+
+  const std::lock_guard lock{events_mutex};
+  std::string out{"{\"traceEvents\": [\n"};
+  const auto pid = getpid();
+  for (uint32_t tid = 0; tid < thread_ids.size(); tid++) {
+    std::format_to(std::back_inserter(out), "{{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": {}, \"tid\": {}, \"args\": {{\"name\": \"{}\"}}}},\n", pid,
+                   tid, tid == 0 ? "main" : std::format("worker {}", tid));
+  }
+  for (const auto &event : events) {
+    out += "{\"ph\": \"X\", \"cat\": \"";
+    append_escaped(out, event.category);
+    out += "\", \"name\": \"";
+    append_escaped(out, event.name);
+    std::format_to(std::back_inserter(out), "\", \"pid\": {}, \"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}", pid, event.tid, event.begin_us,
+                   event.end_us - event.begin_us);
+    if (event.arg) std::format_to(std::back_inserter(out), ", \"args\": {{\"value\": \"0x{:x}\"}}", *event.arg);
+    out += "},\n";
+  }
+  // the format allows a trailing comma, but not every viewer does
+  if (out.ends_with(",\n")) out.erase(out.size() - 2, 1);
+  out += "]}\n";
+
+  std::ofstream file{trace_path, std::ios::binary};
+  file.write(out.data(), static_cast<std::streamsize>(out.size()));
+  return static_cast<bool>(file);
+}
+}  // namespace trace
+
+trace_span::trace_span(std::string_view category, std::string_view name, std::optional<uint64_t> arg) : active{trace::enabled()} {
+  if (!active) return;
+  this->category = category;
+  this->name = name;
+  this->arg = arg;
+  begin = std::chrono::steady_clock::now();
+}
+
+trace_span::~trace_span() {
+  if (active) trace::record(category, name, trace::to_us(begin), trace::to_us(std::chrono::steady_clock::now()), arg);
+}
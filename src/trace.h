@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// chrome trace event json for -T, loads in perfetto or chrome://tracing
+// spans cost one check of enabled() when tracing is off
+namespace trace {
+// starts collecting, the file is written by finish
+auto start(const std::filesystem::path &path) -> void;
+auto enabled() -> bool;
+auto finish() -> bool;
+
+// microseconds since the process started collecting
+auto to_us(std::chrono::steady_clock::time_point time) -> double;
+auto record(std::string_view category, std::string_view name, double begin_us, double end_us, std::optional<uint64_t> arg) -> void;
+}  // namespace trace
+
+// one complete event from construction to destruction on the current thread
+// arg shows up in the event details, for example the first rom offset of a batch
+using trace_span = struct trace_span {
+  trace_span(std::string_view category, std::string_view name, std::optional<uint64_t> arg = std::nullopt);
+  trace_span(const trace_span &) = delete;
+  auto operator=(const trace_span &) -> trace_span & = delete;
+  ~trace_span();
+
+ private:
+  bool active{};
+  std::string category;
+  std::string name;
+  std::optional<uint64_t> arg;
+  std::chrono::steady_clock::time_point begin;
+};
@@ -1,9 +1,17 @@
 #include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <print>
 #include <vector>
 #include <string_view>
 #include "signature.h"
 #include "section_pattern.h"
+#include "result_cache.h"
+#include "rom_range.h"
+#include "run_stats.h"
+#include "serve_protocol.h"
+#include "trace.h"
 
 TEST_CASE("Deserialize yaml", "[yaml]") {
   std::string yaml{
@@ -43,6 +51,156 @@ TEST_CASE("Deserialize yaml", "[yaml]") {
   REQUIRE(result == expect);
 }
 
+TEST_CASE("Deserialize yaml into an arena", "[yaml]") {
+  std::string yaml{
+      "- file: a_file_name_too_long_for_sso.o\n"
+      "  sections:\n"
+      "    - size: 128\n"
+      "      name: .text\n"
+      "      symbols:\n"
+      "        - offset: 0\n"
+      "          size: 64\n"
+      "          crc_8: 32\n"
+      "          crc_all: 16\n"
+      "          duplicate_crc: false\n"
+      "          symbol: somefunction\n"
+      "          relocations:\n"
+      "            - type: 5\n"
+      "              offset: 2\n"
+      "              addend: 0\n"
+      "              local: true\n"
+      "              name: .rodata\n"};
+  std::vector<char> yaml_bytes{yaml.begin(), yaml.end()};
+
+  sig_arena arena;
+  auto result = sig_yaml::deserialize(yaml_bytes, &arena);
+
+  REQUIRE(result.size() == 1);
+  const auto &section = result[0].sections[0];
+  REQUIRE(result[0].file.get_allocator().resource() == &arena);
+  REQUIRE(result[0].sections.get_allocator().resource() == &arena);
+  REQUIRE(section.symbols.get_allocator().resource() == &arena);
+  REQUIRE(section.symbols[0].relocations.get_allocator().resource() == &arena);
+  REQUIRE(section.symbols[0].relocations[0].name == ".rodata");
+
+  // a copy owns its memory again
+  auto copy = result;
+  REQUIRE(copy[0].sections.get_allocator().resource() == std::pmr::get_default_resource());
+  REQUIRE(copy == result);
+}
+
+TEST_CASE("Deserialize yaml with anchor", "[yaml]") {
+  std::string yaml{
+      "- file: blah.o\n"
+      "  sections:\n"
+      "    - size: 128\n"
+      "      name: .text\n"
+      "      symbols:\n"
+      "        - offset: 0\n"
+      "          size: 64\n"
+      "          crc_8: 32\n"
+      "          crc_all: 16\n"
+      "          anchor_offset: 8\n"
+      "          anchor_size: 16\n"
+      "          crc_anchor: 4\n"
+      "          duplicate_crc: false\n"
+      "          symbol: somefunction\n"
+      "          relocations: []\n"};
+  std::vector<char> yaml_bytes{yaml.begin(), yaml.end()};
+
+  auto result = sig_yaml::deserialize(yaml_bytes);
+
+  REQUIRE(result.size() == 1);
+  const auto &symbol = result[0].sections[0].symbols[0];
+  REQUIRE(symbol.anchor_offset == 8);
+  REQUIRE(symbol.anchor_size == 16);
+  REQUIRE(symbol.crc_anchor == 4);
+}
+
+TEST_CASE("Round trip yaml with a 64 bit hash", "[yaml]") {
+  std::vector<sig_object> sig_objs{sig_object{
+      .file{"blah.o"},
+      .sections{sig_section{.size = 64,
+                            .crc_all = 16,
+                            .hash = sig_hash::crc64,
+                            .hash_all = 0xFEDCBA9876543210,
+                            .name{".text"},
+                            .symbols{sig_symbol{.offset = 0,
+                                                .size = 64,
+                                                .crc_8 = 32,
+                                                .crc_all = 16,
+                                                .hash = sig_hash::crc64,
+                                                .hash_all = 0x0123456789ABCDEF,
+                                                .symbol{"somefunction"}}}}}}};
+
+  auto yaml_bytes = sig_yaml::serialize(sig_objs);
+  const std::string_view yaml{yaml_bytes.data(), yaml_bytes.size()};
+  REQUIRE(yaml.find("hash: crc64") != std::string_view::npos);
+
+  REQUIRE(sig_yaml::deserialize(yaml_bytes) == sig_objs);
+}
+
+TEST_CASE("Round trip yaml with flirt patterns and a compiled trie", "[yaml]") {
+  std::vector<sig_object> sig_objs{sig_object{
+      .file{"blah.o"},
+      .sections{sig_section{.size = 64,
+                            .crc_all = 16,
+                            .pattern{"27BDFFE0........"},
+                            .tail_size = 0,
+                            .crc16 = 0xFFFF,
+                            .name{".text"},
+                            .symbols{sig_symbol{.offset = 0,
+                                                .size = 64,
+                                                .crc_8 = 32,
+                                                .crc_all = 16,
+                                                .pattern{"27BDFFE0........"},
+                                                .tail_size = 0,
+                                                .crc16 = 0xFFFF,
+                                                .symbol{"somefunction"}}}}}}};
+  const std::vector<uint8_t> trie{'O', 'M', 'F', 'T', 0x00, 0xFF};
+
+  auto yaml_bytes = sig_yaml::serialize(sig_objs, trie);
+  const std::string_view yaml{yaml_bytes.data(), yaml_bytes.size()};
+  REQUIRE(yaml.find("pattern: 27BDFFE0........") != std::string_view::npos);
+  REQUIRE(yaml.find("flirt: 4F4D465400FF") != std::string_view::npos);
+
+  std::vector<uint8_t> result_trie;
+  REQUIRE(sig_yaml::deserialize(yaml_bytes, std::pmr::get_default_resource(), &result_trie) == sig_objs);
+  REQUIRE(result_trie == trie);
+}
+
+TEST_CASE("Round trip yaml with the masked words of a symbol", "[yaml]") {
+  std::vector<sig_object> sig_objs{sig_object{
+      .file{"blah.o"},
+      .sections{sig_section{.size = 8,
+                            .name{".text"},
+                            .symbols{sig_symbol{.offset = 0,
+                                                .size = 8,
+                                                .crc_8 = 32,
+                                                .crc_all = 16,
+                                                .words{0x27BDFFE0, 0x03E00008},
+                                                .symbol{"somefunction"}}}}}}};
+
+  auto yaml_bytes = sig_yaml::serialize(sig_objs);
+  const std::string_view yaml{yaml_bytes.data(), yaml_bytes.size()};
+  REQUIRE(yaml.find("words: 27BDFFE003E00008") != std::string_view::npos);
+
+  REQUIRE(sig_yaml::deserialize(yaml_bytes) == sig_objs);
+}
+
+TEST_CASE("Round trip yaml of a little endian object", "[yaml]") {
+  std::vector<sig_object> sig_objs{sig_object{.file{"blah.o"}, .arch = target_arch::mips_le, .sections{sig_section{.size = 8, .name{".text"}}}},
+                                   sig_object{.file{"other.o"}, .sections{sig_section{.size = 4, .name{".text"}}}}};
+
+  auto yaml_bytes = sig_yaml::serialize(sig_objs);
+  const std::string_view yaml{yaml_bytes.data(), yaml_bytes.size()};
+  REQUIRE(yaml.find("arch: mipsel") != std::string_view::npos);
+  // big endian is the default and is left out
+  REQUIRE(yaml.find("arch: mips\n") == std::string_view::npos);
+
+  REQUIRE(sig_yaml::deserialize(yaml_bytes) == sig_objs);
+}
+
 TEST_CASE("Serialize yaml", "[yaml]") {
   std::vector<sig_object> sig_objs{sig_object{
       .file{"blah.o"},
@@ -52,6 +210,9 @@ TEST_CASE("Serialize yaml", "[yaml]") {
                                                 .size = 64,
                                                 .crc_8 = 32,
                                                 .crc_all = 16,
+                                                .anchor_offset = 8,
+                                                .anchor_size = 16,
+                                                .crc_anchor = 4,
                                                 .duplicate_crc = false,
                                                 .symbol{"somefunction"},
                                                 .relocations{sig_relocation{.type = 5, .offset = 2, .addend = 0, .local = true, .name{".rodata"}}}}}}}}};
@@ -62,12 +223,18 @@ TEST_CASE("Serialize yaml", "[yaml]") {
       "- file: blah.o\n"
       "  sections:\n"
       "    - size: 128\n"
+      "      crc_8: 0\n"
+      "      crc_all: 0\n"
+      "      duplicate_crc: false\n"
       "      name: .text\n"
       "      symbols:\n"
       "        - offset: 0\n"
       "          size: 64\n"
       "          crc_8: 32\n"
       "          crc_all: 16\n"
+      "          anchor_offset: 8\n"
+      "          anchor_size: 16\n"
+      "          crc_anchor: 4\n"
       "          duplicate_crc: false\n"
       "          symbol: somefunction\n"
       "          relocations:\n"
@@ -112,3 +279,75 @@ TEST_CASE("Serialize section_pattern yaml", "[yaml]") {
 }
 
 
+TEST_CASE("Round trip chunk_hits yaml", "[yaml]") {
+  std::vector<chunk_hits> chunks{
+      chunk_hits{.start = 0, .crc = 0x1234, .section_hits{signature_hit{.object = 1, .section = 0, .symbol = 0, .rom_offset = 0x1000}}, .symbol_hits{}},
+      chunk_hits{.start = 0x10000,
+                 .crc = 0x5678,
+                 .section_hits{},
+                 .symbol_hits{signature_hit{.object = 2, .section = 1, .symbol = 3, .rom_offset = 0x10040}}}};
+
+  auto bytes = chunk_hits_yaml::serialize(chunks);
+  auto result = chunk_hits_yaml::deserialize(bytes);
+
+  REQUIRE(result == chunks);
+}
+
+TEST_CASE("Cache keys depend on part boundaries", "[yaml]") {
+  std::string ab{"ab"};
+  std::string a{"a"};
+  std::string b{"b"};
+
+  REQUIRE(result_cache::key({ab}) == result_cache::key({ab}));
+  REQUIRE(result_cache::key({ab}) != result_cache::key({a, b}));
+}
+
+TEST_CASE("Round trip scan_request yaml", "[yaml]") {
+  scan_request request{.rom_path = "/roms/game.z64",
+                       .splat_path = "/roms/game.yaml",
+                       .ranges{rom_range{.start = 0x1000, .end = 0x2000}, rom_range{.start = 0x8000, .end = 0x9000}}};
+
+  auto bytes = scan_request_yaml::serialize(request);
+  auto result = scan_request_yaml::deserialize(bytes);
+
+  REQUIRE(result == request);
+}
+
+TEST_CASE("Stats report lists every phase and counter", "[yaml]") {
+  run_stats::add(stat_counter::crc_8_hits, 3);
+  run_stats::add(stat_phase::emit, std::chrono::milliseconds{2});
+
+  const auto json = run_stats::report(stats_format::json);
+
+  REQUIRE(json.starts_with("{\"phases_ms\": {\"rom_load\": "));
+  REQUIRE(json.find("\"crc_8_hits\": 3") != std::string::npos);
+  REQUIRE(json.find("\"emit\": 2.000") != std::string::npos);
+  REQUIRE(json.find("\"peak_rss_kib\": ") != std::string::npos);
+  REQUIRE(run_stats::parse_format("xml") == std::nullopt);
+}
+
+TEST_CASE("Trace spans are written as chrome trace events", "[yaml]") {
+  const auto path = std::filesystem::temp_directory_path() / "objmatch_trace_test.json";
+  trace::start(path);
+  { const trace_span span{"test", "quoted \"member\".o", 0x10000}; }
+
+  REQUIRE(trace::finish());
+
+  std::ifstream file{path};
+  const std::string json{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  std::filesystem::remove(path);
+
+  REQUIRE(json.starts_with("{\"traceEvents\": ["));
+  REQUIRE(json.find("\"name\": \"quoted \\\"member\\\".o\"") != std::string::npos);
+  REQUIRE(json.find("\"args\": {\"value\": \"0x10000\"}") != std::string::npos);
+  REQUIRE(json.ends_with("]}\n"));
+}
+
+TEST_CASE("Hardware counters either count or say why not", "[yaml]") {
+  REQUIRE_FALSE(perf_counters::read());
+
+  perf_counters::enable();
+  const auto sample = perf_counters::read();
+
+  REQUIRE(sample.has_value() == perf_counters::unavailable_reason().empty());
+}